@@ -102,6 +102,7 @@ testScripts = [
     'mempool_reorg.py',
     'mempool_limit.py',
     'httpbasics.py',
+    'httpworkqueue.py',
     'multi_rpc.py',
     'zapwallettxes.py',
     'proxy_test.py',
@@ -7,6 +7,7 @@ from test_framework.test_framework import DynamicTestFramework
 from test_framework.util import *
 
 import threading
+import time
 
 class LongpollThread(threading.Thread):
     def __init__(self, node):
@@ -64,6 +65,59 @@ class GetBlockTemplateLPTest(DynamicTestFramework):
         thr.join(60 + 20)
         assert(not thr.is_alive())
 
+        # Start over from an empty mempool. The template is rebuilt for new transactions
+        # only once it is 5 seconds old, so move the clock forward instead of waiting.
+        self.nodes[0].generate(1)
+        self.sync_all()
+        mocktime = int(time.time())
+        self.nodes[0].setmocktime(mocktime)
+
+        # Test 5: templates are reused and can be requested relative to an earlier one
+        templat = self.nodes[0].getblocktemplate()
+        templateid = templat['templateid']
+        assert_equal(templat['transactions'], [])
+        templat2 = self.nodes[0].getblocktemplate()
+        assert_equal(templat2['templateid'], templateid)
+        assert('basetemplateid' not in templat2)
+
+        txid = self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 1)
+        mocktime += 10
+        self.nodes[0].setmocktime(mocktime)
+        templat2 = self.nodes[0].getblocktemplate({'basetemplateid': templateid})
+        assert(templat2['templateid'] != templateid)
+        assert_equal(templat2['basetemplateid'], templateid)
+        assert_equal(templat2['removedtransactions'], [])
+        assert_equal([tx['hash'] for tx in templat2['transactions']], [txid])
+
+        # a template that is unknown or on another tip gets the full list
+        templat3 = self.nodes[0].getblocktemplate({'basetemplateid': templateid + 1000})
+        assert('basetemplateid' not in templat3)
+        assert_equal([tx['hash'] for tx in templat3['transactions']], [txid])
+        self.nodes[0].generate(1)
+        self.sync_all()
+        templat3 = self.nodes[0].getblocktemplate({'basetemplateid': templat2['templateid']})
+        assert('basetemplateid' not in templat3)
+        assert_equal(templat3['transactions'], [])
+
+        # Test 6: a long-poll wakes up on a significant fee increase, well before the one minute check
+        self.nodes[0].settxfee(Decimal("0.01"))
+        self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 1)
+        mocktime += 10
+        self.nodes[0].setmocktime(mocktime)
+        thr = LongpollThread(self.nodes[0])
+        assert_equal(len(self.nodes[0].getblocktemplate()['transactions']), 1)
+        thr.start()
+        # about 1% of the template's fees is not enough
+        self.nodes[0].settxfee(Decimal("0.0001"))
+        self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 1)
+        thr.join(5)
+        assert(thr.is_alive())
+        # as much again is
+        self.nodes[0].settxfee(Decimal("0.01"))
+        self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 1)
+        thr.join(5)
+        assert(not thr.is_alive())
+
 if __name__ == '__main__':
     GetBlockTemplateLPTest().main()
 
@@ -0,0 +1,93 @@
+#!/usr/bin/env python2
+# Copyright (c) 2016-2017 Duality Blockchain Solutions Ltd
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test -rpcworkqueuewait and the counters of gethttpstats
+#
+
+from test_framework.test_framework import DynamicTestFramework
+from test_framework.util import *
+import json
+import threading
+
+try:
+    import http.client as httplib
+except ImportError:
+    import httplib
+try:
+    import urllib.parse as urlparse
+except ImportError:
+    import urlparse
+
+# Enough concurrent batches to overrun one worker thread with a queue of one
+NUM_CLIENTS = 16
+BATCH_SIZE = 500
+
+class HTTPWorkQueueTest (DynamicTestFramework):
+    def setup_nodes(self):
+        # node0 holds requests for a full work queue, node1 rejects them at once
+        return start_nodes(2, self.options.tmpdir, [
+            ["-rpcthreads=1", "-rpcworkqueue=1", "-rpcworkqueuewait=60000"],
+            ["-rpcthreads=1", "-rpcworkqueue=1"]])
+
+    def setup_network(self, split=False):
+        self.nodes = self.setup_nodes()
+        self.is_network_split = False
+
+    def send_batches(self, node):
+        url = urlparse.urlparse(node.url)
+        authpair = url.username + ':' + url.password
+        headers = {"Authorization": "Basic " + str_to_b64str(authpair)}
+        batch = json.dumps([{"method": "getblockhash", "params": [i % 200], "id": i} for i in range(BATCH_SIZE)])
+        conns = []
+        for i in range(NUM_CLIENTS):
+            conn = httplib.HTTPConnection(url.hostname, url.port)
+            conn.connect()
+            conns.append(conn)
+        statuses = []
+        lock = threading.Lock()
+        def post(conn):
+            conn.request('POST', '/', batch, headers)
+            response = conn.getresponse()
+            response.read()
+            with lock:
+                statuses.append(response.status)
+        threads = [threading.Thread(target=post, args=(conn,)) for conn in conns]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for conn in conns:
+            conn.close()
+        return statuses
+
+    def run_test(self):
+        # Every request gets through when the event loop holds them
+        before = self.nodes[0].gethttpstats()["endpoints"]["/"]
+        statuses = self.send_batches(self.nodes[0])
+        assert_equal(statuses, [httplib.OK] * NUM_CLIENTS)
+        stats = self.nodes[0].gethttpstats()
+        endpoint = stats["endpoints"]["/"]
+        assert_equal(endpoint["rejected"], 0)
+        assert_greater_than(endpoint["held"], 0)
+        # the batches, plus the first gethttpstats call
+        assert_equal(endpoint["requests"], before["requests"] + NUM_CLIENTS + 1)
+        assert_equal(stats["queuedepth"], 0)
+
+        # The loop kept serving while it held requests, and holds nothing now
+        assert_equal(self.nodes[0].getblockcount(), 200)
+
+        # Without -rpcworkqueuewait the overflow is turned away
+        before = self.nodes[1].gethttpstats()["endpoints"]["/"]
+        statuses = self.send_batches(self.nodes[1])
+        rejected = statuses.count(httplib.INTERNAL_SERVER_ERROR)
+        assert_greater_than(rejected, 0)
+        assert_equal(rejected + statuses.count(httplib.OK), NUM_CLIENTS)
+        endpoint = self.nodes[1].gethttpstats()["endpoints"]["/"]
+        assert_equal(endpoint["rejected"], before["rejected"] + rejected)
+        assert_equal(endpoint["held"], 0)
+
+if __name__ == '__main__':
+    HTTPWorkQueueTest ().main ()
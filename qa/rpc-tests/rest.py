@@ -59,7 +59,8 @@ class RESTTest (DynamicTestFramework):
         initialize_chain_clean(self.options.tmpdir, 3)
 
     def setup_network(self, split=False):
-        self.nodes = start_nodes(3, self.options.tmpdir)
+        # node 0 keeps the indexes behind /rest/addressutxos, /rest/spentinfo and /rest/blockhashes
+        self.nodes = start_nodes(3, self.options.tmpdir, [["-addressindex", "-spentindex", "-timestampindex"], [], []])
         connect_nodes_bi(self.nodes,0,1)
         connect_nodes_bi(self.nodes,1,2)
         connect_nodes_bi(self.nodes,0,2)
@@ -337,5 +338,77 @@ class RESTTest (DynamicTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        ########################################
+        # index queries, only node 0 has them #
+        ########################################
+        address = self.nodes[1].getnewaddress()
+        txid = self.nodes[0].sendtoaddress(address, 2)
+        self.sync_all()
+        self.nodes[2].generate(1)
+        self.sync_all()
+        height = self.nodes[0].getblockcount()
+
+        # addressutxos matches getaddressutxos
+        json_string = http_get_call(url.hostname, url.port, '/rest/addressutxos/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        rpc_utxos = self.nodes[0].getaddressutxos({"addresses": [address]})
+        assert_equal(len(json_obj), 1)
+        assert_equal(len(rpc_utxos), 1)
+        assert_equal(json_obj[0]['txid'], txid)
+        assert_equal(json_obj[0]['outputIndex'], rpc_utxos[0]['outputIndex'])
+        assert_equal(json_obj[0]['satoshis'], rpc_utxos[0]['satoshis'])
+        assert_equal(json_obj[0]['height'], height)
+
+        response = http_get_call(url.hostname, url.port, '/rest/addressutxos/'+address+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        assert_equal(response.read()[0:1], b"\x01") # compact size of one record
+
+        response = http_get_call(url.hostname, url.port, '/rest/addressutxos/notanaddress'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        # without -addressindex there is nothing to serve
+        url1 = urlparse.urlparse(self.nodes[1].url)
+        response = http_get_call(url1.hostname, url1.port, '/rest/addressutxos/'+address+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+
+        # spentinfo of the first input of the transaction matches getspentinfo
+        decoded = self.nodes[0].decoderawtransaction(self.nodes[0].gettransaction(txid)['hex'])
+        prevout = decoded['vin'][0]
+        json_string = http_get_call(url.hostname, url.port, '/rest/spentinfo/'+prevout['txid']+'-'+str(prevout['vout'])+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        rpc_spent = self.nodes[0].getspentinfo({"txid": prevout['txid'], "index": prevout['vout']})
+        assert_equal(json_obj['txid'], txid)
+        assert_equal(json_obj['index'], 0)
+        assert_equal(json_obj['height'], height)
+        assert_equal(json_obj, rpc_spent)
+
+        response = http_get_call(url.hostname, url.port, '/rest/spentinfo/'+txid+'-x'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/spentinfo/'+txid+'-0'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404) # not spent yet
+
+        # blockhashes matches getblockhashes
+        block_time = self.nodes[0].getblock(self.nodes[0].getbestblockhash())['time']
+        json_string = http_get_call(url.hostname, url.port, '/rest/blockhashes/'+str(block_time+1)+'/'+str(block_time)+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj, self.nodes[0].getblockhashes(block_time+1, block_time))
+        assert_equal(self.nodes[0].getbestblockhash() in json_obj, True)
+
+        response = http_get_call(url.hostname, url.port, '/rest/blockhashes/'+str(block_time+1)+'/'+str(block_time)+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        response_bytes = response.read()
+        assert_equal(ord(response_bytes[0:1]), len(json_obj))
+        assert_equal(len(response_bytes), 1 + 32 * len(json_obj))
+
+        response = http_get_call(url.hostname, url.port, '/rest/blockhashes/'+str(block_time)+'/'+str(block_time+1)+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400) # low above high
+
+        # the regtest Dynode list is empty, an object keyed by outpoint
+        json_string = http_get_call(url.hostname, url.port, '/rest/dynodes'+self.FORMAT_SEPARATOR+'json')
+        assert_equal(json.loads(json_string), {})
+        assert_equal(json.loads(json_string), self.nodes[0].dynodelist("full"))
+        hex_string = http_get_call(url.hostname, url.port, '/rest/dynodes'+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string.strip(), "00")
+
 if __name__ == '__main__':
     RESTTest ().main ()
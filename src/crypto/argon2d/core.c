@@ -265,6 +265,29 @@ int fill_memory_blocks(argon2_instance_t *instance) {
         return ARGON2_THREAD_FAIL;
     }
 
+    /* With a single thread fill the lanes in place, creating a thread per
+     * segment would only add overhead. Lanes within a slice are independent,
+     * so the result is the same. */
+    if (instance->threads == 1) {
+        for (r = 0; r < instance->passes; ++r) {
+            for (s = 0; s < ARGON2_SYNC_POINTS; ++s) {
+                uint32_t l;
+                for (l = 0; l < instance->lanes; ++l) {
+                    argon2_position_t position;
+                    position.pass = r;
+                    position.lane = l;
+                    position.slice = (uint8_t)s;
+                    position.index = 0;
+                    fill_segment(instance, position);
+                }
+            }
+#ifdef GENKAT
+            internal_kat(instance, r); /* Print all memory blocks */
+#endif
+        }
+        return ARGON2_OK;
+    }
+
     /* 1. Allocating space for threads */
     thread = calloc(instance->lanes, sizeof(argon2_thread_handle_t));
     if (thread == NULL) {
@@ -579,7 +602,7 @@ int initialize(argon2_instance_t *instance, argon2_context *context) {
         if (ARGON2_OK != result) {
             return result;
         }
-        memcpy(&(instance->memory), p, sizeof(instance->memory));
+        instance->memory = (block *)p;
     } else {
         result = allocate_memory(&(instance->memory), instance->memory_blocks);
         if (ARGON2_OK != result) {
@@ -121,6 +121,7 @@ bool CDynode::UpdateFromNewBroadcast(CDynodeBroadcast& dnb)
     nPoSeBanHeight = 0;
     nTimeLastChecked = 0;
     nTimeLastWatchdogVote = dnb.sigTime;
+    dnodeman.MarkDynodeDirty(vin.prevout);
     int nDos = 0;
     if(dnb.lastPing == CDynodePing() || (dnb.lastPing != CDynodePing() && dnb.lastPing.CheckAndUpdate(nDos))) {
         lastPing = dnb.lastPing;
@@ -163,26 +164,27 @@ arith_uint256 CDynode::CalculateScore(const uint256& blockHash)
     return (hash3 > hash2 ? hash3 - hash2 : hash2 - hash3);
 }
 
-void CDynode::Check(bool fForce)
+// start of the grace period in which Dynodes loaded on start are not expired
+static int64_t nTimeStart = GetTime();
+
+bool CDynode::Check(bool fForce)
 {
     LOCK(cs);
 
-    static int64_t nTimeStart = GetTime();
-
-    if(ShutdownRequested()) return;
+    if(ShutdownRequested()) return false;
 
-    if(!fForce && (GetTime() - nTimeLastChecked < DYNODE_CHECK_SECONDS)) return;
+    if(!fForce && (GetTime() - nTimeLastChecked < DYNODE_CHECK_SECONDS)) return false;
     nTimeLastChecked = GetTime();
 
     LogPrint("dynode", "CDynode::Check -- Dynode %s is in %s state\n", vin.prevout.ToStringShort(), GetStateString());
 
     //once spent, stop doing the checks
-    if(nActiveState == DYNODE_OUTPOINT_SPENT) return;
+    if(nActiveState == DYNODE_OUTPOINT_SPENT) return true;
 
     int nHeight = 0;
     if(!fUnitTest) {
         TRY_LOCK(cs_main, lockMain);
-        if(!lockMain) return;
+        if(!lockMain) return false;
 
         CCoins coins;
         if(!pcoinsTip->GetCoins(vin.prevout.hash, coins) ||
@@ -190,7 +192,7 @@ void CDynode::Check(bool fForce)
            coins.vout[vin.prevout.n].IsNull()) {
             nActiveState = DYNODE_OUTPOINT_SPENT;
             LogPrint("dynode", "CDynode::Check -- Failed to find Dynode UTXO, dynode=%s\n", vin.prevout.ToStringShort());
-            return;
+            return true;
         }
 
         nHeight = chainActive.Height();
@@ -201,7 +203,7 @@ void CDynode::Check(bool fForce)
     bool fWaitForPing = (GetTime() - nTimeStart < DYNODE_MIN_DNP_SECONDS);
 
     if(nActiveState == DYNODE_POSE_BAN) {
-        if(nHeight < nPoSeBanHeight) return; // too early?
+        if(nHeight < nPoSeBanHeight) return true; // too early?
         // Otherwise give it a chance to proceed further to do all the usual checks and to change its state.
         // Dynode still will be on the edge and can be banned back easily if it keeps ignoring dnverify
         // or connect attempts. Will require few dnverify messages to strengthen its position in dn list.
@@ -212,7 +214,7 @@ void CDynode::Check(bool fForce)
         // ban for the whole payment cycle
         nPoSeBanHeight = nHeight + dnodeman.size();
         LogPrintf("CDynode::Check -- Dynode %s is banned till block %d now\n", vin.prevout.ToStringShort(), nPoSeBanHeight);
-        return;
+        return true;
     }
 
                    // dynode doesn't meet payment protocol requirements ...
@@ -226,7 +228,7 @@ void CDynode::Check(bool fForce)
 
         // RESCAN AFFECTED VOTES
         FlagGovernanceItemsAsDirty();
-        return;
+        return true;
     }
 
     bool fWatchdogActive = dnodeman.IsWatchdogActive();
@@ -237,22 +239,41 @@ void CDynode::Check(bool fForce)
 
     if(fWatchdogExpired) {
         nActiveState = DYNODE_WATCHDOG_EXPIRED;
-        return;
+        return true;
     }
 
     if(!fWaitForPing && !IsPingedWithin(DYNODE_EXPIRATION_SECONDS)) {
         nActiveState = DYNODE_EXPIRED;
         // RESCAN AFFECTED VOTES
         FlagGovernanceItemsAsDirty();
-        return;
+        return true;
     }
 
     if(lastPing.sigTime - sigTime < DYNODE_MIN_DNP_SECONDS) {
         nActiveState = DYNODE_PRE_ENABLED;
-        return;
+        return true;
     }
 
     nActiveState = DYNODE_ENABLED; // OK
+    return true;
+}
+
+int64_t CDynode::GetNextCheckTime()
+{
+    LOCK(cs);
+
+    if(nActiveState != DYNODE_ENABLED && nActiveState != DYNODE_PRE_ENABLED) {
+        // expired, spent, removed and watchdog expired Dynodes wait for a ping,
+        // vote or block, PoSe bans are lifted by height
+        return 0;
+    }
+
+    // expires once the last ping is too old, but not before the grace period is over
+    int64_t nTime = std::max(lastPing.sigTime + DYNODE_EXPIRATION_SECONDS, nTimeStart + DYNODE_MIN_DNP_SECONDS);
+    if(dnodeman.IsWatchdogActive()) {
+        nTime = std::min(nTime, nTimeLastWatchdogVote + DYNODE_WATCHDOG_MAX_SECONDS + 1);
+    }
+    return nTime;
 }
 
 bool CDynode::IsValidNetAddr()
@@ -777,6 +798,7 @@ bool CDynodePing::CheckAndUpdate(int& nDos, bool fSimpleCheck)
     // so, ping seems to be ok, let's store it
     LogPrint("dynode", "CDynodePing::CheckAndUpdate -- Dynode ping accepted, dynode=%s\n", vin.prevout.ToStringShort());
     pdn->lastPing = *this;
+    dnodeman.MarkDynodeDirty(vin.prevout);
 
     // and update dnodeman.mapSeenDynodeBroadcast.lastPing which is probably outdated
     CDynodeBroadcast dnb(*pdn);
@@ -822,6 +844,19 @@ void CDynode::UpdateWatchdogVoteTime()
 {
     LOCK(cs);
     nTimeLastWatchdogVote = GetTime();
+    dnodeman.MarkDynodeDirty(vin.prevout);
+}
+
+void CDynode::IncreasePoSeBanScore()
+{
+    if(nPoSeBanScore < DYNODE_POSE_BAN_MAX_SCORE) nPoSeBanScore++;
+    dnodeman.MarkDynodeDirty(vin.prevout);
+}
+
+void CDynode::DecreasePoSeBanScore()
+{
+    if(nPoSeBanScore > -DYNODE_POSE_BAN_MAX_SCORE) nPoSeBanScore--;
+    dnodeman.MarkDynodeDirty(vin.prevout);
 }
 
 /**
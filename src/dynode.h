@@ -239,7 +239,12 @@ public:
 
     bool UpdateFromNewBroadcast(CDynodeBroadcast& dnb);
 
-    void Check(bool fForce = false);
+    /// Re-evaluate nActiveState, returns false if the check was skipped
+    bool Check(bool fForce = false);
+
+    /// Earliest time at which Check() can change the state without a new ping,
+    /// vote, broadcast or block arriving, 0 if only those can change it
+    int64_t GetNextCheckTime();
 
     bool IsBroadcastedWithin(int nSeconds) { return GetAdjustedTime() - sigTime < nSeconds; }
 
@@ -275,8 +280,8 @@ public:
 
     bool IsValidNetAddr();
 
-    void IncreasePoSeBanScore() { if(nPoSeBanScore < DYNODE_POSE_BAN_MAX_SCORE) nPoSeBanScore++; }
-    void DecreasePoSeBanScore() { if(nPoSeBanScore > -DYNODE_POSE_BAN_MAX_SCORE) nPoSeBanScore--; }
+    void IncreasePoSeBanScore();
+    void DecreasePoSeBanScore();
 
     dynode_info_t GetInfo();
 
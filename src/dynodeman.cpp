@@ -7,6 +7,7 @@
 #include "activedynode.h"
 #include "privatesend.h"
 #include "governance.h"
+#include "instantsend.h"
 #include "dynode.h"
 #include "dynode-payments.h"
 #include "dynode-sync.h"
@@ -14,6 +15,7 @@
 #include "util.h"
 #include "addrman.h"
 #include "spork.h"
+#include "validationinterface.h"
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
 
@@ -115,6 +117,14 @@ CDynodeMan::CDynodeMan()
   fDynodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  cs_check(),
+  setDirtyDynodes(),
+  mapDynodeCheckTimes(),
+  mapDynodeCheckTimeIts(),
+  mapDynodeUnbanHeights(),
+  setSpentOutpoints(),
+  nLastFullCheckTime(0),
+  fWatchdogActiveOnLastCheck(false),
   mapSeenDynodeBroadcast(),
   mapSeenDynodePing(),
   nPsqCount(0)
@@ -130,7 +140,9 @@ bool CDynodeMan::Add(CDynode &dn)
         dn.nTimeLastWatchdogVote = dn.sigTime;
         vDynodes.push_back(dn);
         indexDynodes.AddDynodeVIN(dn.vin);
+        MarkDynodeDirty(dn.vin.prevout);
         fDynodesAdded = true;
+        QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().NotifyDynodeListChanged), dn.vin.prevout, true));
         return true;
     }
 
@@ -156,15 +168,95 @@ void CDynodeMan::AskForDN(CNode* pnode, const CTxIn &vin)
 
 void CDynodeMan::Check()
 {
-    LOCK(cs);
+    int64_t nNow = GetTime();
+    bool fWatchdogActive = IsWatchdogActive();
+
+    std::set<COutPoint> setToCheck;
+    std::set<COutPoint> setSpent;
+    bool fFullCheck;
+    {
+        LOCK(cs_check);
 
-    LogPrint("dynode", "CDynodeMan::Check nLastWatchdogVoteTime = %d, IsWatchdogActive() = %d\n", nLastWatchdogVoteTime, IsWatchdogActive());
+        // the watchdog turning on or off affects every Dynode
+        fFullCheck = nNow - nLastFullCheckTime >= FULL_CHECK_SECONDS || fWatchdogActive != fWatchdogActiveOnLastCheck;
+
+        setToCheck.swap(setDirtyDynodes);
+        setSpent.swap(setSpentOutpoints);
+        while(!mapDynodeCheckTimes.empty() && mapDynodeCheckTimes.begin()->first <= nNow) {
+            setToCheck.insert(mapDynodeCheckTimes.begin()->second);
+            mapDynodeCheckTimeIts.erase(mapDynodeCheckTimes.begin()->second);
+            mapDynodeCheckTimes.erase(mapDynodeCheckTimes.begin());
+        }
+    }
+
+    if(!fFullCheck && setToCheck.empty() && setSpent.empty()) return;
+
+    // Need LOCK2 here to ensure consistent locking order because CDynode::Check locks cs_main
+    LOCK2(cs_main, cs);
+
+    LogPrint("dynode", "CDynodeMan::Check nLastWatchdogVoteTime = %d, IsWatchdogActive() = %d, full check = %d, %d dirty\n",
+             nLastWatchdogVoteTime, fWatchdogActive, fFullCheck, setToCheck.size());
 
     BOOST_FOREACH(CDynode& dn, vDynodes) {
-        dn.Check();
+        const COutPoint& outpoint = dn.vin.prevout;
+        if(!fFullCheck && !setToCheck.count(outpoint) && !setSpent.count(outpoint)) continue;
+        if(!dn.Check(true)) {
+            // try again next time
+            MarkDynodeDirty(outpoint);
+            continue;
+        }
+        ScheduleCheck(dn);
+    }
+
+    if(fFullCheck) {
+        LOCK(cs_check);
+        nLastFullCheckTime = nNow;
+        fWatchdogActiveOnLastCheck = fWatchdogActive;
+    }
+}
+
+void CDynodeMan::MarkDynodeDirty(const COutPoint& outpoint)
+{
+    LOCK(cs_check);
+    setDirtyDynodes.insert(outpoint);
+}
+
+void CDynodeMan::ScheduleCheck(CDynode& dn)
+{
+    int64_t nTime = dn.GetNextCheckTime();
+    bool fPoSeBanned = dn.IsPoSeBanned();
+    int nPoSeBanHeight = dn.nPoSeBanHeight;
+
+    LOCK(cs_check);
+    const COutPoint& outpoint = dn.vin.prevout;
+
+    std::map<COutPoint, std::multimap<int64_t, COutPoint>::iterator>::iterator it = mapDynodeCheckTimeIts.find(outpoint);
+    if(it != mapDynodeCheckTimeIts.end()) {
+        mapDynodeCheckTimes.erase(it->second);
+        mapDynodeCheckTimeIts.erase(it);
+    }
+    if(nTime > 0) {
+        mapDynodeCheckTimeIts[outpoint] = mapDynodeCheckTimes.insert(std::make_pair(nTime, outpoint));
+    }
+
+    if(fPoSeBanned) {
+        // banned Dynodes are checked again and again until their ban is over, queue them once
+        std::pair<std::multimap<int, COutPoint>::iterator, std::multimap<int, COutPoint>::iterator> range = mapDynodeUnbanHeights.equal_range(nPoSeBanHeight);
+        for(std::multimap<int, COutPoint>::iterator itUnban = range.first; itUnban != range.second; ++itUnban) {
+            if(itUnban->second == outpoint) return;
+        }
+        mapDynodeUnbanHeights.insert(std::make_pair(nPoSeBanHeight, outpoint));
     }
 }
 
+void CDynodeMan::GetCheckQueueSizes(int& nDirtyRet, int& nTimedRet, int& nUnbanRet)
+{
+    LOCK(cs_check);
+    nDirtyRet = setDirtyDynodes.size();
+    nTimedRet = mapDynodeCheckTimes.size();
+    nUnbanRet = mapDynodeUnbanHeights.size();
+}
+
 void CDynodeMan::CheckAndRemove()
 {
     LogPrintf("CDynodeMan::CheckAndRemove\n");
@@ -191,6 +283,7 @@ void CDynodeMan::CheckAndRemove()
                 mWeAskedForDynodeListEntry.erase((*it).vin.prevout);
 
                 // and finally remove it from the list
+                QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().NotifyDynodeListChanged), (*it).vin.prevout, false));
                 it = vDynodes.erase(it);
                 fDynodesRemoved = true;
             } else {
@@ -295,6 +388,16 @@ void CDynodeMan::Clear()
     nLastWatchdogVoteTime = 0;
     indexDynodes.Clear();
     indexDynodesOld.Clear();
+
+    {
+        LOCK(cs_check);
+        setDirtyDynodes.clear();
+        mapDynodeCheckTimes.clear();
+        mapDynodeCheckTimeIts.clear();
+        mapDynodeUnbanHeights.clear();
+        setSpentOutpoints.clear();
+        nLastFullCheckTime = 0;
+    }
 }
 
 int CDynodeMan::CountDynodes(int nProtocolVersion)
@@ -468,7 +571,7 @@ CDynode* CDynodeMan::GetNextDynodeInQueueForPayment(bool fFilterSigTime, int& nC
 
 CDynode* CDynodeMan::GetNextDynodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount)
 {
-    // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
+    // Need LOCK2 here to ensure consistent locking order because the GetCollateralAge call below locks cs_main
     LOCK2(cs_main,cs);
 
     CDynode *pBestDynode = NULL;
@@ -1442,6 +1545,7 @@ void CDynodeMan::CheckDynode(const CTxIn& vin, bool fForce)
         return;
     }
     pDN->Check(fForce);
+    MarkDynodeDirty(pDN->vin.prevout);
 }
 
 void CDynodeMan::CheckDynode(const CPubKey& pubKeyDynode, bool fForce)
@@ -1452,6 +1556,7 @@ void CDynodeMan::CheckDynode(const CPubKey& pubKeyDynode, bool fForce)
         return;
     }
     pDN->Check(fForce);
+    MarkDynodeDirty(pDN->vin.prevout);
 }
 
 int CDynodeMan::GetDynodeState(const CTxIn& vin)
@@ -1508,6 +1613,15 @@ void CDynodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
 
     CheckSameAddr();
 
+    {
+        // PoSe bans are lifted by height
+        LOCK(cs_check);
+        while(!mapDynodeUnbanHeights.empty() && mapDynodeUnbanHeights.begin()->first <= pindex->nHeight) {
+            setDirtyDynodes.insert(mapDynodeUnbanHeights.begin()->second);
+            mapDynodeUnbanHeights.erase(mapDynodeUnbanHeights.begin());
+        }
+    }
+
     if(fDyNode) {
         DoFullVerificationStep();
         // normal wallet does not need to update this every block, doing update on rpc call should be enough
@@ -1515,6 +1629,19 @@ void CDynodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
+void CDynodeMan::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
+{
+    // only collaterals spent in a block can take a Dynode out, and there is
+    // nothing to keep track of before the chain is synced: the first Check()
+    // after that looks at all Dynodes anyway
+    if(!pblock || tx.IsCoinBase() || !dynodeSync.IsBlockchainSynced()) return;
+
+    LOCK(cs_check);
+    BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+        setSpentOutpoints.insert(txin.prevout);
+    }
+}
+
 void CDynodeMan::NotifyDynodeUpdates()
 {
     // Avoid double locking
@@ -1532,6 +1659,8 @@ void CDynodeMan::NotifyDynodeUpdates()
     }
     if(fDynodesRemovedLocal) {
         governance.UpdateCachesAndClean();
+        // cached InstantSend quorums may still rank the removed dynodes
+        ClearTxLockQuorums();
     }
 
     LOCK(cs);
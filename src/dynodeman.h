@@ -98,6 +98,9 @@ private:
 
     static const int PSEG_UPDATE_SECONDS        = 3 * 60 * 60;
 
+    /// Sporks and the watchdog can change the state of all Dynodes at once, so check them all now and then
+    static const int FULL_CHECK_SECONDS         = 10 * 60;
+
     static const int LAST_PAID_SCAN_BLOCKS      = 100;
 
     static const int MIN_POSE_PROTO_VERSION     = 60800;
@@ -141,6 +144,26 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    // critical section to protect the incremental check bookkeeping below,
+    // no other lock is taken while holding it
+    mutable CCriticalSection cs_check;
+
+    /// Dynodes to re-evaluate on the next Check() because a ping, vote, broadcast or block affected them
+    std::set<COutPoint> setDirtyDynodes;
+    /// Time at which each Dynode's state can change without any new message, earliest first
+    std::multimap<int64_t, COutPoint> mapDynodeCheckTimes;
+    std::map<COutPoint, std::multimap<int64_t, COutPoint>::iterator> mapDynodeCheckTimeIts;
+    /// Height at which each PoSe banned Dynode gets its chance back into the list
+    std::multimap<int, COutPoint> mapDynodeUnbanHeights;
+    /// Outpoints spent by connected blocks since the last Check()
+    std::set<COutPoint> setSpentOutpoints;
+
+    int64_t nLastFullCheckTime;
+    bool fWatchdogActiveOnLastCheck;
+
+    /// Remember when the state of a checked Dynode can change next
+    void ScheduleCheck(CDynode& dn);
+
     friend class CDynodeSync;
 
 public:
@@ -191,9 +214,16 @@ public:
     /// Ask (source) node for dnb
     void AskForDN(CNode *pnode, const CTxIn &vin);
 
-    /// Check all Dynodes
+    /// Check the Dynodes whose state could have changed since the last call,
+    /// all of them every FULL_CHECK_SECONDS
     void Check();
 
+    /// Have Check() re-evaluate this Dynode
+    void MarkDynodeDirty(const COutPoint& outpoint);
+
+    /// How many Dynodes are marked dirty, waiting for a timed check and waiting to be unbanned
+    void GetCheckQueueSizes(int& nDirtyRet, int& nTimedRet, int& nUnbanRet);
+
     /// Check all Dynodes and remove inactive
     void CheckAndRemove();
 
@@ -340,6 +370,7 @@ public:
     void SetDynodeLastPing(const CTxIn& vin, const CDynodePing& dnp);
 
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
 
     /**
      * Called to notify CGovernanceManager that the Dynode index has been updated.
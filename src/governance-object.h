@@ -283,7 +283,7 @@ public:
 
     void Relay();
 
-    uint256 GetHash();
+    uint256 GetHash() const;
 
     // GET VOTE COUNT FOR SIGNAL
 
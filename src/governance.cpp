@@ -20,6 +20,7 @@
 #include "netfulfilledman.h"
 #include "util.h"
 #include "addrman.h"
+#include "validationinterface.h"
 #include <boost/lexical_cast.hpp>
 #include <univalue.h>
 
@@ -331,6 +332,8 @@ bool CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj)
 
     DBG( cout << "CGovernanceManager::AddGovernanceObject END" << endl; );
 
+    QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().NotifyGovernanceObject), govobj));
+
     return true;
 }
 
@@ -736,6 +739,7 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         }
 
         vote.Relay();
+        QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().NotifyGovernanceVote), vote));
     }
     return fOk;
 }
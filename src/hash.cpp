@@ -10,6 +10,8 @@
 #include "crypto/hmac_sha512.h"
 #include "pubkey.h"
 
+#include <boost/thread/tss.hpp>
+
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
@@ -84,3 +86,39 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
     num[3] = (nChild >>  0) & 0xFF;
     CHMAC_SHA512(chainCode.begin(), chainCode.size()).Write(&header, 1).Write(data, 32).Write(num, 4).Finalize(output);
 }
+
+namespace {
+/** Argon2d memory of the current thread, reused by every hash_Argon2d_Mining call on it */
+boost::thread_specific_ptr<std::vector<uint64_t> > argon2dMemory;
+
+int AllocateArgon2dMemory(uint8_t **memory, size_t bytes_to_allocate)
+{
+    std::vector<uint64_t>* pvMemory = argon2dMemory.get();
+    if (pvMemory == NULL) {
+        pvMemory = new std::vector<uint64_t>();
+        argon2dMemory.reset(pvMemory);
+    }
+    size_t nWords = (bytes_to_allocate + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    if (pvMemory->size() < nWords)
+        pvMemory->resize(nWords);
+    *memory = (uint8_t *)&(*pvMemory)[0];
+    return ARGON2_OK;
+}
+
+void KeepArgon2dMemory(uint8_t *memory, size_t bytes_to_allocate)
+{
+    // Released together with the thread
+}
+}
+
+uint256 hash_Argon2d_Mining(const void* input, const unsigned int& hashPhase)
+{
+    uint256 hashResult;
+    if (hashPhase == 2) {
+        Argon2d_Phase2_Hash((const uint8_t*)input, (uint8_t*)&hashResult, 1, AllocateArgon2dMemory, KeepArgon2dMemory);
+    }
+    else {
+        Argon2d_Phase1_Hash((const uint8_t*)input, (uint8_t*)&hashResult, 1, AllocateArgon2dMemory, KeepArgon2dMemory);
+    }
+    return hashResult;
+}
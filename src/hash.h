@@ -255,7 +255,9 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
 /// Lanes: 2 parallel threads
 /// Threads: 2 threads
 /// Time Constraint: 1 iteration
-inline int Argon2d_Phase1_Hash(const void *in, void *out) {
+/// The number of threads and the memory allocator do not change the result.
+inline int Argon2d_Phase1_Hash(const void *in, void *out, uint32_t threads = 2,
+                               allocate_fptr allocate_cbk = NULL, deallocate_fptr free_cbk = NULL) {
     argon2_context context;
     context.out = (uint8_t *)out;
     context.outlen = (uint32_t)OUTPUT_BYTES;
@@ -267,13 +269,13 @@ inline int Argon2d_Phase1_Hash(const void *in, void *out) {
     context.secretlen = 0;
     context.ad = NULL;
     context.adlen = 0;
-    context.allocate_cbk = NULL;
-    context.free_cbk = NULL;
+    context.allocate_cbk = allocate_cbk;
+    context.free_cbk = free_cbk;
     context.flags = DEFAULT_ARGON2_FLAG; // = ARGON2_DEFAULT_FLAGS
     // main configurable Argon2 hash parameters
     context.m_cost = 1024; // Memory in KB
     context.lanes = 2;    // Degree of Parallelism
-    context.threads = 2;  // Threads
+    context.threads = threads;  // Threads
     context.t_cost = 1;   // Iterations
 
     return argon2_core(&context, Argon2_d);
@@ -294,7 +296,9 @@ inline int Argon2d_Phase1_Hash(const void *in, void *out) {
 /// Lanes: 16 parallel threads
 /// Threads: 16 threads
 /// Time Constraint: 8 iterations
-inline int Argon2d_Phase2_Hash(const void *in, void *out) {
+/// The number of threads and the memory allocator do not change the result.
+inline int Argon2d_Phase2_Hash(const void *in, void *out, uint32_t threads = 4,
+                               allocate_fptr allocate_cbk = NULL, deallocate_fptr free_cbk = NULL) {
     argon2_context context;
     context.out = (uint8_t *)out;
     context.outlen = (uint32_t)OUTPUT_BYTES;
@@ -306,13 +310,13 @@ inline int Argon2d_Phase2_Hash(const void *in, void *out) {
     context.secretlen = 0;
     context.ad = NULL;
     context.adlen = 0;
-    context.allocate_cbk = NULL;
-    context.free_cbk = NULL;
+    context.allocate_cbk = allocate_cbk;
+    context.free_cbk = free_cbk;
     context.flags = DEFAULT_ARGON2_FLAG; // = ARGON2_DEFAULT_FLAGS
     // main configurable Argon2 hash parameters
     context.m_cost = 1024; // Memory in KB
     context.lanes = 64;    // Degree of Parallelism
-    context.threads = 4;  // Threads
+    context.threads = threads;  // Threads
     context.t_cost = 8;    // Iterations
     
     return argon2_core(&context, Argon2_d);
@@ -337,4 +341,11 @@ inline uint256 hash_Argon2d(const void* input, const unsigned int& hashPhase) {
     return hashResult;
 }
 
+/**
+ * Same result as hash_Argon2d, computed for the internal miner: all lanes run
+ * on the calling thread and the Argon2d memory is kept per thread between
+ * calls, instead of allocating it and starting lane threads for every nonce.
+ */
+uint256 hash_Argon2d_Mining(const void* input, const unsigned int& hashPhase);
+
 #endif // DYNAMIC_HASH_H
@@ -22,6 +22,7 @@
 #include "utilstrencodings.h"
 
 #include <boost/algorithm/string.hpp> // boost::trim
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp> //BOOST_FOREACH
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
@@ -182,24 +183,28 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (!valRequest.read(req->ReadBody()))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
-        std::string strReply;
+        // Large replies go out in chunks while they are serialized,
+        // small ones are sent in one piece by the WriteReply below
+        CJSONStreamWriter writer(boost::bind(&HTTPRequest::WriteReplyChunk, req, (int)HTTP_OK, _1));
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            req->WriteHeader("Content-Type", "application/json");
+            if (!tableRPC.executeStream(jreq.strMethod, jreq.params, jreq.id, writer)) {
+                UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+                JSONRPCWriteReply(writer, result, NullUniValue, jreq.id);
+            }
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            req->WriteHeader("Content-Type", "application/json");
+            JSONRPCExecBatch(valRequest.get_array(), writer);
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        req->WriteReply(HTTP_OK, writer.TakeBuffered());
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -10,6 +10,7 @@
 #include "chainparamsbase.h"
 #include "compat.h"
 #include "util.h"
+#include "utiltime.h"
 #include "netbase.h"
 #include "rpcprotocol.h" // For HTTP status codes
 #include "sync.h"
@@ -44,24 +45,33 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Interval at which an event loop retries the requests it holds for a full work queue */
+static const int HTTP_HOLD_RETRY_MILLIS = 10;
+
+static void RecordHTTPRequest(const std::string& prefix, int64_t nQueueMicros, int64_t nHandlerMicros);
+
 /** HTTP request work item */
 class HTTPWorkItem : public HTTPClosure
 {
 public:
-    HTTPWorkItem(HTTPRequest* req, const std::string &path, const HTTPRequestHandler& func):
-        req(req), path(path), func(func)
+    HTTPWorkItem(HTTPRequest* req, const std::string &prefix, const std::string &path, const HTTPRequestHandler& func):
+        req(req), prefix(prefix), path(path), func(func), nTimeQueued(GetTimeMicros())
     {
     }
     void operator()()
     {
+        int64_t nTimeStart = GetTimeMicros();
         func(req.get(), path);
+        RecordHTTPRequest(prefix, nTimeStart - nTimeQueued, GetTimeMicros() - nTimeStart);
     }
 
     boost::scoped_ptr<HTTPRequest> req;
+    std::string prefix;
 
 private:
     std::string path;
     HTTPRequestHandler func;
+    int64_t nTimeQueued;
 };
 
 /** Simple work queue for distributing work over multiple threads.
@@ -151,6 +161,12 @@ public:
         running = false;
         cond.notify_all();
     }
+    /** Return whether the queue still accepts work, i.e. was not interrupted */
+    bool IsRunning()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return running;
+    }
     /** Wait for worker threads to exit */
     void WaitExit()
     {
@@ -180,20 +196,76 @@ struct HTTPPathHandler
     HTTPRequestHandler handler;
 };
 
+/** A request an event loop holds until the work queue has room, or until nDeadline (in milliseconds) */
+struct HTTPHeldRequest
+{
+    HTTPWorkItem* item;
+    int64_t nDeadline;
+};
+
+/** An event loop with its own HTTP server, listening sockets and thread */
+struct HTTPEventLoop
+{
+    HTTPEventLoop(): base(0), http(0), retryEvent(0) {}
+    struct event_base* base;
+    struct evhttp* http;
+    std::vector<evhttp_bound_socket *> boundSockets;
+    boost::thread thread;
+    //! Requests held for a full work queue, oldest first. Only used from the loop's own thread.
+    std::deque<HTTPHeldRequest> held;
+    //! Timer that retries the held requests
+    HTTPEvent* retryEvent;
+};
+
 /** HTTP module state */
 
-//! libevent event loop
+//! libevent event loops, connections are spread over them by the kernel
+static std::vector<HTTPEventLoop*> eventLoops;
+//! Event base of the first loop, for submodules' timers and events
 static struct event_base* eventBase = 0;
-//! HTTP server
-struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! How long an event loop holds a request when the work queue is full before rejecting it
+static int64_t nWorkQueueWaitMillis = 0;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
-//! Bound listening sockets
-std::vector<evhttp_bound_socket *> boundSockets;
+//! Request statistics per handler prefix
+static std::map<std::string, HTTPEndpointStats> mapEndpointStats;
+static CCriticalSection cs_endpointStats;
+
+static void RecordHTTPRequest(const std::string& prefix, int64_t nQueueMicros, int64_t nHandlerMicros)
+{
+    LOCK(cs_endpointStats);
+    HTTPEndpointStats& stats = mapEndpointStats[prefix];
+    stats.nRequests++;
+    stats.nQueueMicros += nQueueMicros;
+    stats.nMaxQueueMicros = std::max(stats.nMaxQueueMicros, nQueueMicros);
+    stats.nHandlerMicros += nHandlerMicros;
+    stats.nMaxHandlerMicros = std::max(stats.nMaxHandlerMicros, nHandlerMicros);
+}
+
+static void RecordHTTPRejected(const std::string& prefix)
+{
+    LOCK(cs_endpointStats);
+    mapEndpointStats[prefix].nRejected++;
+}
+
+static void RecordHTTPHeld(const std::string& prefix)
+{
+    LOCK(cs_endpointStats);
+    mapEndpointStats[prefix].nHeld++;
+}
+
+void GetHTTPStats(std::map<std::string, HTTPEndpointStats>& mapStatsRet, size_t& nQueueDepthRet)
+{
+    {
+        LOCK(cs_endpointStats);
+        mapStatsRet = mapEndpointStats;
+    }
+    nQueueDepthRet = workQueue ? workQueue->Depth() : 0;
+}
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -253,6 +325,31 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+static void RejectHTTPWorkItem(HTTPWorkItem* item)
+{
+    RecordHTTPRejected(item->prefix);
+    item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
+    delete item;
+}
+
+/** Timer callback: hand the held requests of a loop to the work queue, in order, while it has room */
+static void RetryHeldRequests(HTTPEventLoop* loop)
+{
+    while (!loop->held.empty()) {
+        const HTTPHeldRequest& held = loop->held.front();
+        if (!workQueue->Enqueue(held.item)) {
+            if (workQueue->IsRunning() && GetTimeMillis() < held.nDeadline)
+                break;
+            RejectHTTPWorkItem(held.item);
+        }
+        loop->held.pop_front();
+    }
+    if (!loop->held.empty()) {
+        struct timeval tv = {0, HTTP_HOLD_RETRY_MILLIS * 1000};
+        loop->retryEvent->trigger(&tv);
+    }
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -292,12 +389,24 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
-        std::auto_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
+        std::auto_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), i->prefix, path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        HTTPEventLoop* loop = (HTTPEventLoop*)arg;
+        if (loop->held.empty() && workQueue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
-        else
-            item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
+        else if (nWorkQueueWaitMillis > 0 && workQueue->IsRunning()) {
+            // With -rpcworkqueuewait the request waits behind the ones held already. A timer
+            // retries them, so this loop keeps serving its other connections meanwhile.
+            RecordHTTPHeld(item->prefix);
+            HTTPHeldRequest held = {item.release(), GetTimeMillis() + nWorkQueueWaitMillis};
+            loop->held.push_back(held);
+            if (loop->held.size() == 1) {
+                struct timeval tv = {0, HTTP_HOLD_RETRY_MILLIS * 1000};
+                loop->retryEvent->trigger(&tv);
+            }
+        } else {
+            RejectHTTPWorkItem(item.release());
+        }
     } else {
         hreq->WriteReply(HTTP_NOTFOUND);
     }
@@ -320,9 +429,36 @@ static void ThreadHTTP(struct event_base* base, struct evhttp* http)
     LogPrint("http", "Exited http event loop\n");
 }
 
-/** Bind HTTP server to specified addresses */
-static bool HTTPBindAddresses(struct evhttp* http)
+/** Open a listening socket on addr that the other event loops listen on too, the kernel spreads connections over them */
+static evutil_socket_t CreateSharedListenSocket(const CService& addr)
+{
+#ifdef SO_REUSEPORT
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr((struct sockaddr*)&sockaddr, &len))
+        return -1;
+    evutil_socket_t fd = socket(((struct sockaddr*)&sockaddr)->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&one, sizeof(one)) < 0 ||
+        evutil_make_socket_nonblocking(fd) < 0 ||
+        bind(fd, (struct sockaddr*)&sockaddr, len) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        evutil_closesocket(fd);
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+/** Bind HTTP server to specified addresses, with sockets shared between loops if fShared */
+static bool HTTPBindAddresses(HTTPEventLoop* loop, bool fShared)
 {
+    struct evhttp* http = loop->http;
     int defaultPort = GetArg("-rpcport", BaseParams().RPCPort());
     std::vector<std::pair<std::string, uint16_t> > endpoints;
 
@@ -349,14 +485,86 @@ static bool HTTPBindAddresses(struct evhttp* http)
     // Bind addresses
     for (std::vector<std::pair<std::string, uint16_t> >::iterator i = endpoints.begin(); i != endpoints.end(); ++i) {
         LogPrint("http", "Binding RPC on address %s port %i\n", i->first, i->second);
-        evhttp_bound_socket *bind_handle = evhttp_bind_socket_with_handle(http, i->first.empty() ? NULL : i->first.c_str(), i->second);
+        evhttp_bound_socket *bind_handle = NULL;
+        if (fShared) {
+            CService addr;
+            evutil_socket_t fd = -1;
+            if (Lookup(i->first.empty() ? "0.0.0.0" : i->first.c_str(), addr, i->second, false))
+                fd = CreateSharedListenSocket(addr);
+            if (fd >= 0) {
+                bind_handle = evhttp_accept_socket_with_handle(http, fd);
+                if (!bind_handle)
+                    evutil_closesocket(fd);
+            }
+        } else {
+            bind_handle = evhttp_bind_socket_with_handle(http, i->first.empty() ? NULL : i->first.c_str(), i->second);
+        }
         if (bind_handle) {
-            boundSockets.push_back(bind_handle);
+            loop->boundSockets.push_back(bind_handle);
         } else {
             LogPrintf("Binding RPC on address %s port %i failed.\n", i->first, i->second);
         }
     }
-    return !boundSockets.empty();
+    return !loop->boundSockets.empty();
+}
+
+/** Free an event loop that isn't running */
+static void FreeHTTPEventLoop(HTTPEventLoop* loop)
+{
+    // Requests still held when the loop was broken off
+    while (!loop->held.empty()) {
+        delete loop->held.front().item;
+        loop->held.pop_front();
+    }
+    delete loop->retryEvent;
+    if (loop->http)
+        evhttp_free(loop->http);
+    if (loop->base)
+        event_base_free(loop->base);
+    delete loop;
+}
+
+/** Create an event loop with an HTTP server bound to the RPC addresses */
+static HTTPEventLoop* CreateHTTPEventLoop(bool fShared)
+{
+    HTTPEventLoop* loop = new HTTPEventLoop();
+
+    loop->base = event_base_new();
+    if (!loop->base) {
+        LogPrintf("Couldn't create an event_base: exiting\n");
+        FreeHTTPEventLoop(loop);
+        return NULL;
+    }
+
+    /* Create a new evhttp object to handle requests. */
+    loop->http = evhttp_new(loop->base);
+    if (!loop->http) {
+        LogPrintf("couldn't create evhttp. Exiting.\n");
+        FreeHTTPEventLoop(loop);
+        return NULL;
+    }
+
+    evhttp_set_timeout(loop->http, GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    evhttp_set_max_headers_size(loop->http, MAX_HEADERS_SIZE);
+    evhttp_set_max_body_size(loop->http, MAX_SIZE);
+    evhttp_set_gencb(loop->http, http_request_cb, loop);
+    loop->retryEvent = new HTTPEvent(loop->base, false, boost::bind(&RetryHeldRequests, loop));
+
+    if (!HTTPBindAddresses(loop, fShared)) {
+        LogPrintf("Unable to bind any endpoint for RPC server\n");
+        FreeHTTPEventLoop(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+bool QueueHTTPWork(HTTPClosure* closure)
+{
+    std::auto_ptr<HTTPClosure> item(closure);
+    if (!workQueue || !workQueue->IsRunning() || !workQueue->Enqueue(item.get()))
+        return false;
+    item.release();
+    return true;
 }
 
 /** Simple wrapper to set thread name and run work queue */
@@ -381,9 +589,6 @@ static void libevent_log_cb(int severity, const char *msg)
 
 bool InitHTTPServer()
 {
-    struct evhttp* http = 0;
-    struct event_base* base = 0;
-
     if (!InitHTTPAllowList())
         return false;
 
@@ -410,50 +615,41 @@ bool InitHTTPServer()
     evthread_use_pthreads();
 #endif
 
-    base = event_base_new(); // XXX RAII
-    if (!base) {
-        LogPrintf("Couldn't create an event_base: exiting\n");
-        return false;
-    }
-
-    /* Create a new evhttp object to handle requests. */
-    http = evhttp_new(base); // XXX RAII
-    if (!http) {
-        LogPrintf("couldn't create evhttp. Exiting.\n");
-        event_base_free(base);
-        return false;
+    int nEventLoops = std::max((int)GetArg("-rpceventloops", DEFAULT_HTTP_EVENT_LOOPS), 1);
+#ifndef SO_REUSEPORT
+    if (nEventLoops > 1) {
+        LogPrintf("HTTP: listening sockets can't be shared on this platform, using one event loop\n");
+        nEventLoops = 1;
     }
-
-    evhttp_set_timeout(http, GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
-    evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
-    evhttp_set_max_body_size(http, MAX_SIZE);
-    evhttp_set_gencb(http, http_request_cb, NULL);
-
-    if (!HTTPBindAddresses(http)) {
-        LogPrintf("Unable to bind any endpoint for RPC server\n");
-        evhttp_free(http);
-        event_base_free(base);
-        return false;
+#endif
+    for (int i = 0; i < nEventLoops; i++) {
+        HTTPEventLoop* loop = CreateHTTPEventLoop(nEventLoops > 1);
+        if (!loop) {
+            BOOST_FOREACH(HTTPEventLoop* loopCreated, eventLoops)
+                FreeHTTPEventLoop(loopCreated);
+            eventLoops.clear();
+            return false;
+        }
+        eventLoops.push_back(loop);
     }
 
     LogPrint("http", "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    nWorkQueueWaitMillis = std::max(GetArg("-rpcworkqueuewait", DEFAULT_HTTP_WORKQUEUE_WAIT), (int64_t)0);
+    LogPrintf("HTTP: creating work queue of depth %d, %d event loops\n", workQueueDepth, nEventLoops);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
-    eventBase = base;
-    eventHTTP = http;
+    eventBase = eventLoops[0]->base;
     return true;
 }
 
-boost::thread threadHTTP;
-
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
     int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
     LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
-    threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
+    BOOST_FOREACH(HTTPEventLoop* loop, eventLoops)
+        loop->thread = boost::thread(boost::bind(&ThreadHTTP, loop->base, loop->http));
 
     for (int i = 0; i < rpcThreads; i++)
         boost::thread(boost::bind(&HTTPWorkQueueRun, workQueue));
@@ -463,13 +659,14 @@ bool StartHTTPServer()
 void InterruptHTTPServer()
 {
     LogPrint("http", "Interrupting HTTP server\n");
-    if (eventHTTP) {
+    BOOST_FOREACH(HTTPEventLoop* loop, eventLoops) {
         // Unlisten sockets
-        BOOST_FOREACH (evhttp_bound_socket *socket, boundSockets) {
-            evhttp_del_accept_socket(eventHTTP, socket);
+        BOOST_FOREACH (evhttp_bound_socket *socket, loop->boundSockets) {
+            evhttp_del_accept_socket(loop->http, socket);
         }
+        loop->boundSockets.clear();
         // Reject requests on current connections
-        evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
+        evhttp_set_gencb(loop->http, http_reject_request_cb, NULL);
     }
     if (workQueue)
         workQueue->Interrupt();
@@ -486,9 +683,8 @@ void StopHTTPServer()
         // below takes care of this and sends a loopbreak.
         workQueue->WaitExit();
 #endif        
-        delete workQueue;
     }
-    if (eventBase) {
+    BOOST_FOREACH(HTTPEventLoop* loop, eventLoops) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
         // Give event loop a few seconds to exit (to send back last RPC responses), then break it
         // Before this was solved with event_base_loopexit, but that didn't work as expected in
@@ -497,24 +693,23 @@ void StopHTTPServer()
         // could be used again (if desirable).
         // (see discussion in https://github.com/bitcoin/bitcoin/pull/6990)
 #if BOOST_VERSION >= 105000
-        if (!threadHTTP.try_join_for(boost::chrono::milliseconds(2000))) {
+        if (!loop->thread.try_join_for(boost::chrono::milliseconds(2000))) {
 #else
-        if (!threadHTTP.timed_join(boost::posix_time::milliseconds(2000))) {
+        if (!loop->thread.timed_join(boost::posix_time::milliseconds(2000))) {
 #endif
 
             LogPrintf("HTTP event loop did not exit within allotted time, sending loopbreak\n");
-            event_base_loopbreak(eventBase);
-            threadHTTP.join();
+            event_base_loopbreak(loop->base);
+            loop->thread.join();
         }
     }
-    if (eventHTTP) {
-        evhttp_free(eventHTTP);
-        eventHTTP = 0;
-    }
-    if (eventBase) {
-        event_base_free(eventBase);
-        eventBase = 0;
-    }
+    // Held requests are retried from the event loops, so the queue goes once they have exited
+    delete workQueue;
+    workQueue = 0;
+    BOOST_FOREACH(HTTPEventLoop* loop, eventLoops)
+        FreeHTTPEventLoop(loop);
+    eventLoops.clear();
+    eventBase = 0;
     LogPrint("http", "Stopped HTTP server\n");
 }
 
@@ -550,8 +745,14 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       base(eventBase),
+                                                       replySent(false),
+                                                       replyStarted(false)
 {
+    // Replies go out on the loop that owns the connection
+    evhttp_connection* con = evhttp_request_get_connection(req);
+    if (con)
+        base = evhttp_connection_get_base(con);
 }
 HTTPRequest::~HTTPRequest()
 {
@@ -606,14 +807,49 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * Replies must be sent in the main loop in the main http thread,
  * this cannot be done from worker threads.
  */
+/** Send one part of a chunked reply, from the main http thread */
+static void http_send_reply_chunk(struct evhttp_request* req, struct evbuffer* evb)
+{
+    evhttp_send_reply_chunk(req, evb);
+    evbuffer_free(evb);
+}
+
+void HTTPRequest::WriteReplyChunk(int nStatus, const std::string& strChunk)
+{
+    assert(!replySent && req);
+    if (!replyStarted) {
+        HTTPEvent* ev = new HTTPEvent(base, true,
+            boost::bind(evhttp_send_reply_start, req, nStatus, (const char*)NULL));
+        ev->trigger(0);
+        replyStarted = true;
+    }
+    // An empty chunk would terminate the reply
+    if (strChunk.empty())
+        return;
+    // Events are run in the order they are triggered, so the parts arrive in order
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    HTTPEvent* ev = new HTTPEvent(base, true, boost::bind(&http_send_reply_chunk, req, evb));
+    ev->trigger(0);
+}
+
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
     assert(!replySent && req);
+    if (replyStarted) {
+        WriteReplyChunk(nStatus, strReply);
+        HTTPEvent* ev = new HTTPEvent(base, true, boost::bind(evhttp_send_reply_end, req));
+        ev->trigger(0);
+        replySent = true;
+        req = 0; // transferred back to main thread
+        return;
+    }
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
-    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+    HTTPEvent* ev = new HTTPEvent(base, true,
         boost::bind(evhttp_send_reply, req, nStatus, (const char*)NULL, (struct evbuffer *)NULL));
     ev->trigger(0);
     replySent = true;
@@ -8,6 +8,7 @@
 #ifndef DYNAMIC_HTTPSERVER_H
 #define DYNAMIC_HTTPSERVER_H
 
+#include <map>
 #include <string>
 #include <stdint.h>
 #include <boost/thread.hpp>
@@ -17,6 +18,8 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+static const int DEFAULT_HTTP_EVENT_LOOPS=1;
+static const int64_t DEFAULT_HTTP_WORKQUEUE_WAIT=0;
 
 struct evhttp_request;
 struct event_base;
@@ -47,6 +50,22 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Requests of one handler prefix, times in microseconds */
+struct HTTPEndpointStats
+{
+    HTTPEndpointStats(): nRequests(0), nRejected(0), nHeld(0), nQueueMicros(0), nMaxQueueMicros(0), nHandlerMicros(0), nMaxHandlerMicros(0) {}
+    uint64_t nRequests;      //! handled by a worker
+    uint64_t nRejected;      //! turned away because the work queue was full
+    uint64_t nHeld;          //! held by an event loop because the work queue was full
+    int64_t nQueueMicros;    //! from arrival until a worker picked it up
+    int64_t nMaxQueueMicros;
+    int64_t nHandlerMicros;  //! spent in the handler
+    int64_t nMaxHandlerMicros;
+};
+
+/** Statistics per handler prefix, and how many requests wait for a worker now */
+void GetHTTPStats(std::map<std::string, HTTPEndpointStats>& mapStatsRet, size_t& nQueueDepthRet);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -59,7 +78,9 @@ class HTTPRequest
 {
 private:
     struct evhttp_request* req;
+    struct event_base* base;
     bool replySent;
+    bool replyStarted;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -111,10 +132,23 @@ public:
      * nStatus is the HTTP status code to send.
      * strReply is the body of the reply. Keep it empty to send a standard message.
      *
+     * When parts of the body were already sent with WriteReplyChunk,
+     * strReply is sent as the last part and nStatus is ignored.
+     *
      * @note Can be called only once. As this will give the request back to the
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Send part of the HTTP reply body right away. The first call sends the
+     * status line and headers; the body goes out with chunked transfer
+     * encoding (or until the connection closes for HTTP/1.0 clients).
+     * Finish the reply with WriteReply.
+     *
+     * @note call WriteHeader before the first call.
+     */
+    void WriteReplyChunk(int nStatus, const std::string& strChunk);
 };
 
 /** Event handler closure.
@@ -126,6 +160,12 @@ public:
     virtual ~HTTPClosure() {}
 };
 
+/** Run a closure on an HTTP worker, for handlers that split their work.
+ * Takes ownership of the closure. Returns false (and deletes it) when the work
+ * queue is full or stopped, the caller then does the work itself.
+ */
+bool QueueHTTPWork(HTTPClosure* closure);
+
 /** Event class. This can be used either as an cross-thread trigger or as a timer.
  */
 class HTTPEvent
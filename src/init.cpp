@@ -26,6 +26,7 @@
 #include "net.h"
 #include "netfulfilledman.h"
 #include "policy/policy.h"
+#include "responsecache.h"
 #include "rpcserver.h"
 #include "script/standard.h"
 #include "script/sigcache.h"
@@ -218,6 +219,7 @@ void PrepareShutdown()
 #endif
     GenerateDynamics(false, 0, Params());
     StopNode();
+    StopValidationInterfaceQueue();
 
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
     CFlatDB<CDynodeMan> flatdb1("sncache.dat", "magicDynodeCache");
@@ -251,6 +253,8 @@ void PrepareShutdown()
         pcoinsTip = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
+        delete pcoinsPrefetch;
+        pcoinsPrefetch = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
         delete pblocktree;
@@ -282,6 +286,7 @@ void PrepareShutdown()
         LogPrintf("%s: Unable to remove pidfile: %s\n", __func__, e.what());
     }
 #endif
+    mempool.NotifyEntryRemoved.disconnect_all_slots();
     UnregisterAllValidationInterfaces();
 }
 
@@ -374,6 +379,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-asyncflush", strprintf("Write the UTXO cache to disk on a background thread; memory use can briefly reach twice -dbcache (default: %u)", DEFAULT_ASYNC_FLUSH));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
@@ -405,6 +412,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-utxoprefetch=<n>", strprintf(_("Set the number of threads reading the coins of received blocks ahead of connection (0 to %d, default: %d)"),
+        MAX_UTXO_PREFETCH_THREADS, DEFAULT_UTXO_PREFETCH_THREADS));
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
@@ -459,6 +468,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-keypool=<n>", strprintf(_("Set key pool size to <n> (default: %u)"), DEFAULT_KEYPOOL_SIZE));
     strUsage += HelpMessageOpt("-fallbackfee=<amt>", strprintf(_("A fee rate (in %s/kB) that will be used when fee estimation has insufficient data (default: %s)"),
         CURRENCY_UNIT, FormatMoney(DEFAULT_FALLBACK_FEE)));
+    strUsage += HelpMessageOpt("-migratewallet", _("Copy the wallet to the backend selected with -walletbackend on startup when it is only stored by the other one"));
     strUsage += HelpMessageOpt("-mintxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for transaction creation (default: %s)"),
             CURRENCY_UNIT, FormatMoney(DEFAULT_TRANSACTION_MINFEE)));
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
@@ -472,6 +482,7 @@ std::string HelpMessage(HelpMessageMode mode)
         CURRENCY_UNIT, FormatMoney(DEFAULT_TRANSACTION_MAXFEE)));
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format on startup"));
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), "wallet.dat"));
+    strUsage += HelpMessageOpt("-walletbackend=<backend>", strprintf(_("Store the wallet with this backend, bdb or leveldb (default: %s)"), DEFAULT_WALLET_BACKEND));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), DEFAULT_WALLETBROADCAST));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
@@ -495,6 +506,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via InstantSend) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubhashtxremoved=<address>", _("Enable publish hash of transactions removed from the mempool for a conflict, reorganization or replacement in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubhashtxevicted=<address>", _("Enable publish hash of transactions evicted from the mempool by expiry or size limit in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubdynode=<address>", _("Enable publish collateral outpoint of dynodes added to or removed from the list in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubhashgovernanceobject=<address>", _("Enable publish hash of new governance objects in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubhashgovernancevote=<address>", _("Enable publish hash of accepted governance votes in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubqueue=<n>", strprintf(_("Maximum number of ZMQ notifications waiting to be sent, further ones are dropped (default: %u)"), DEFAULT_ZMQ_PUBLISH_QUEUE));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -588,6 +605,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockminsize=<n>", strprintf(_("Set minimum block size in bytes (default: %u)"), DEFAULT_BLOCK_MIN_SIZE));
     strUsage += HelpMessageOpt("-blockmaxsize=<n>", strprintf(_("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE));
     strUsage += HelpMessageOpt("-blockprioritysize=<n>", strprintf(_("Set maximum size of high-priority/low-fee transactions in bytes (default: %d)"), DEFAULT_BLOCK_PRIORITY_SIZE));
+    strUsage += HelpMessageOpt("-longpollfeeincrease=<n>", strprintf(_("Answer long-polling getblocktemplate requests early once mempool fees grew by <n> percent of the template's fees, 0 to disable (default: %u)"), DEFAULT_LONGPOLL_FEE_INCREASE));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
@@ -602,8 +620,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), BaseParams(CBaseChainParams::MAIN).RPCPort(), BaseParams(CBaseChainParams::TESTNET).RPCPort()));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpccachesize=<n>", strprintf(_("Megabytes of replies about confirmed blocks and transactions to keep for RPC and REST, 0 to disable (default: %u)"), DEFAULT_RPC_CACHE_SIZE));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcworkqueuewait=<n>", strprintf("Milliseconds to hold a request when the RPC work queue is full before rejecting it (default: %d)", DEFAULT_HTTP_WORKQUEUE_WAIT));
+        strUsage += HelpMessageOpt("-rpceventloops=<n>", strprintf("Number of event loops accepting RPC connections, sharing the listening ports where supported (default: %d)", DEFAULT_HTTP_EVENT_LOOPS));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -626,6 +647,12 @@ std::string LicenseInfo()
            "\n";
 }
 
+/** Pass mempool removals on to the validation interface listeners, through the notification queue */
+static void QueueTransactionRemovedFromMempool(const CTransaction& tx, MemPoolRemovalReason reason)
+{
+    QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().TransactionRemovedFromMempool), tx, reason));
+}
+
 static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex)
 {
     if (initialSync || !pBlockIndex)
@@ -774,6 +801,7 @@ bool AppInitServers(boost::thread_group& threadGroup)
     RPCServer::OnPreCommand(&OnRPCPreCommand);
     if (!InitHTTPServer())
         return false;
+    responseCache.SetMaxSize((size_t)std::max(GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE), (int64_t)0) << 20);
     if (!StartRPC())
         return false;
     if (!StartHTTPRPC())
@@ -1034,6 +1062,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    int nPrefetchThreads = std::max(0, std::min((int)GetArg("-utxoprefetch", DEFAULT_UTXO_PREFETCH_THREADS), MAX_UTXO_PREFETCH_THREADS));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
@@ -1217,10 +1247,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("Unable to sign spork message, wrong key?"));
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler thread. Dynode and PrivateSend
+    // maintenance jobs rely on running one at a time, so keep it to one thread.
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
+    StartValidationInterfaceQueue();
+
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
      * that the server is there and will be ready later).  Warmup mode will
@@ -1241,6 +1274,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         std::string strWarning;
         std::string strError;
 
+        WalletDBBackend walletBackend;
+        if (!ParseWalletBackend(GetArg("-walletbackend", DEFAULT_WALLET_BACKEND), walletBackend))
+            return InitError(strprintf(_("Unknown wallet backend requested: '%s'"), GetArg("-walletbackend", "")));
+
         nWalletBackups = GetArg("-createwalletbackups", 10);
         nWalletBackups = std::max(0, std::min(10, nWalletBackups));
 
@@ -1391,6 +1428,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     BOOST_FOREACH(const std::string& strDest, mapMultiArgs["-seednode"])
         AddOneShot(strDest);
 
+    // Pass transactions leaving the mempool on to the validation interfaces
+    mempool.NotifyEntryRemoved.connect(&QueueTransactionRemovedFromMempool);
+
 #if ENABLE_ZMQ
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
@@ -1465,13 +1505,20 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
-                delete pcoinsdbview;
                 delete pcoinscatcher;
+                delete pcoinsPrefetch;
+                pcoinsPrefetch = NULL;
+                delete pcoinsdbview;
                 delete pblocktree;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex, GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH));
+                if (nPrefetchThreads > 0) {
+                    pcoinsPrefetch = new CCoinsViewPrefetch(pcoinsdbview, nPrefetchThreads);
+                    pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsPrefetch);
+                } else {
+                    pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                }
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
                 if (fReindex) {
@@ -1896,9 +1943,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     dynodeSync.UpdatedBlockTip(chainActive.Tip());
     governance.UpdatedBlockTip(chainActive.Tip());
 
-    // ********************************************************* Step 11d: start dynamic-privatesend thread
+    // ********************************************************* Step 11d: schedule Dynode and PrivateSend maintenance
 
-    threadGroup.create_thread(boost::bind(&ThreadCheckPrivateSendPool));
+    SchedulePrivateSendMaintenance(threadGroup, scheduler);
 
     // ********************************************************* Step 12: start node
 
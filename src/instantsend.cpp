@@ -36,8 +36,75 @@ std::map<COutPoint, uint256> mapLockedInputs;
 std::map<uint256, CTxLockCandidate> mapTxLockCandidates;
 std::map<COutPoint, int64_t> mapDynodeOrphanVotes; //track dynodes who voted with no txreq (for DOS protection)
 
+// Expiry queues, so cleanup only visits what expired instead of every entry.
+// An entry can be stale when the item is gone or its expiry changed since,
+// which is checked when it is taken off the queue.
+std::multimap<int, uint256> mapTxLockCandidatesByExpiry; // nExpirationBlock -> txid
+std::deque<std::pair<int64_t, uint256> > dqTxLockVotesOrphanExpiry; // nOrphanExpireTime -> vote hash, in time order
+std::deque<std::pair<int64_t, COutPoint> > dqDynodeOrphanVotesExpiry; // expiry -> dynode, in time order
+int64_t nDynodeOrphanVoteTimeTotal = 0; // sum of mapDynodeOrphanVotes, for GetAverageDynodeOrphanVoteTime
+
 CCriticalSection cs_instantsend;
 
+namespace {
+/** Top INSTANTSEND_SIGNATURES_TOTAL dynodes of a lock height, by outpoint */
+struct CTxLockQuorum
+{
+    int64_t nTime;
+    std::map<COutPoint, int> mapRanks;
+};
+
+// Scoring and sorting the dynode list for every vote is what made votes slow,
+// all votes of a lock share the height they are ranked at.
+CCriticalSection cs_txlockquorums;
+std::map<int, CTxLockQuorum> mapTxLockQuorums;
+
+// Votes whose signature was verified, by hash of the whole vote (CTxLockVote::GetHash()
+// leaves out the height and signature) and the time they were verified
+CCriticalSection cs_verifiedvotes;
+std::map<uint256, int64_t> mapVerifiedTxLockVotes;
+std::deque<std::pair<int64_t, uint256> > dqVerifiedTxLockVotes; // in time order, for expiry
+
+bool IsTxLockVoteVerified(const CTxLockVote& vote)
+{
+    LOCK(cs_verifiedvotes);
+    return mapVerifiedTxLockVotes.count(SerializeHash(vote)) != 0;
+}
+
+void SetTxLockVoteVerified(const CTxLockVote& vote)
+{
+    uint256 hash = SerializeHash(vote);
+    LOCK(cs_verifiedvotes);
+    int64_t nNow = GetTime();
+    mapVerifiedTxLockVotes[hash] = nNow;
+    dqVerifiedTxLockVotes.push_back(std::make_pair(nNow, hash));
+}
+
+/**
+ * Verify the signatures of a batch of votes on the script check threads, so the following
+ * checks find them verified. The dynode keys are looked up here, the threads only verify.
+ */
+void CheckTxLockVoteSignatures(const std::vector<const CTxLockVote*>& vecVotes)
+{
+    std::vector<const CTxLockVote*> vecVotesQueued;
+    std::vector<CScriptCheck> vChecks;
+    BOOST_FOREACH(const CTxLockVote* pvote, vecVotes) {
+        if(IsTxLockVoteVerified(*pvote)) continue;
+        dynode_info_t infoDn = dnodeman.GetDynodeInfo(pvote->vinDynode);
+        // unknown dynodes are reported by CheckTxLockVoteSignature
+        if(!infoDn.fInfoValid) continue;
+        vecVotesQueued.push_back(pvote);
+        vChecks.push_back(CScriptCheck(pvote->GetSignatureHash(), infoDn.pubKeyDynode.GetID(), pvote->vchDyNodeSignature));
+    }
+
+    std::vector<char> vfValid;
+    RunScriptChecks(vChecks, vfValid);
+    for(size_t i = 0; i < vecVotesQueued.size(); i++)
+        if(vfValid[i])
+            SetTxLockVoteVerified(*vecVotesQueued[i]);
+}
+}
+
 // Transaction Locks
 //
 // step 2) Top INSTANTSEND_SIGNATURES_TOTAL dynodes push "txvote" message
@@ -202,6 +269,7 @@ int64_t CreateTxLockCandidate(const CTransaction& tx)
         txLockCandidate.nTimeout = GetTime()+(60*5);
         txLockCandidate.txHash = txHash;
         mapTxLockCandidates.insert(std::make_pair(txHash, txLockCandidate));
+        mapTxLockCandidatesByExpiry.insert(std::make_pair(txLockCandidate.nExpirationBlock, txHash));
     } else {
         mapTxLockCandidates[txHash].nBlockHeight = nLockInputHeight;
         LogPrint("instantsend", "CreateTxLockCandidate -- Transaction Lock Candidate exists! txid=%s\n", txHash.ToString());
@@ -215,7 +283,7 @@ void CreateTxLockVote(const CTransaction& tx, int nBlockHeight)
 {
     if(!fDyNode) return;
 
-    int n = dnodeman.GetDynodeRank(activeDynode.vin, nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION);
+    int n = GetTxLockVoteRank(activeDynode.vin, nBlockHeight);
 
     if(n == -1) {
         LogPrint("instantsend", "CreateTxLockVote -- Unknown Dynode %s\n", activeDynode.vin.prevout.ToStringShort());
@@ -264,6 +332,7 @@ bool ProcessTxLockVote(CNode* pnode, CTxLockVote& vote)
             LogPrint("instantsend", "ProcessTxLockVote -- Orphan vote: txid=%s  dynodes=%s new\n", vote.txHash.ToString(), vote.vinDynode.prevout.ToStringShort());
             vote.nOrphanExpireTime = GetTime() + 60; // keep orphan votes for 1 minute
             mapTxLockVotesOrphan[vote.GetHash()] = vote;
+            dqTxLockVotesOrphanExpiry.push_back(std::make_pair(vote.nOrphanExpireTime, vote.GetHash()));
         } else {
             LogPrint("instantsend", "ProcessTxLockVote -- Orphan vote: txid=%s  dynodes=%s seen\n", vote.txHash.ToString(), vote.vinDynode.prevout.ToStringShort());
         }
@@ -273,6 +342,8 @@ bool ProcessTxLockVote(CNode* pnode, CTxLockVote& vote)
         int nDynodeOrphanExpireTime = GetTime() + 60*10; // keep time data for 10 minutes
         if(!mapDynodeOrphanVotes.count(vote.vinDynode.prevout)) {
             mapDynodeOrphanVotes[vote.vinDynode.prevout] = nDynodeOrphanExpireTime;
+            nDynodeOrphanVoteTimeTotal += nDynodeOrphanExpireTime;
+            dqDynodeOrphanVotesExpiry.push_back(std::make_pair(nDynodeOrphanExpireTime, vote.vinDynode.prevout));
         } else {
             int64_t nPrevOrphanVote = mapDynodeOrphanVotes[vote.vinDynode.prevout];
             if(nPrevOrphanVote > GetTime() && nPrevOrphanVote > GetAverageDynodeOrphanVoteTime()) {
@@ -283,6 +354,8 @@ bool ProcessTxLockVote(CNode* pnode, CTxLockVote& vote)
             }
             // not spamming, refresh
             mapDynodeOrphanVotes[vote.vinDynode.prevout] = nDynodeOrphanExpireTime;
+            nDynodeOrphanVoteTimeTotal += nDynodeOrphanExpireTime - nPrevOrphanVote;
+            dqDynodeOrphanVotesExpiry.push_back(std::make_pair(nDynodeOrphanExpireTime, vote.vinDynode.prevout));
         }
 
         return true;
@@ -294,7 +367,7 @@ bool ProcessTxLockVote(CNode* pnode, CTxLockVote& vote)
         return false;
     }
 
-    int n = dnodeman.GetDynodeRank(vote.vinDynode, vote.nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION);
+    int n = GetTxLockVoteRank(vote.vinDynode, vote.nBlockHeight);
 
     if(n == -1) {
         //can be caused by past versions trying to vote with an invalid protocol
@@ -311,7 +384,7 @@ bool ProcessTxLockVote(CNode* pnode, CTxLockVote& vote)
         return false;
     }
 
-    if(!vote.CheckSignature()) {
+    if(!CheckTxLockVoteSignature(vote)) {
         LogPrintf("ProcessTxLockVote -- Signature invalid\n");
         // don't ban, it could just be a non-synced dynode
         if(pnode) {
@@ -354,6 +427,13 @@ bool ProcessTxLockVote(CNode* pnode, CTxLockVote& vote)
 
 void ProcessOrphanTxLockVotes()
 {
+    // verify the votes that can be processed now all at once
+    std::vector<const CTxLockVote*> vecVotes;
+    for(std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin(); it != mapTxLockVotesOrphan.end(); ++it)
+        if(mapLockRequestAccepted.count(it->second.txHash))
+            vecVotes.push_back(&it->second);
+    CheckTxLockVoteSignatures(vecVotes);
+
     std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
     while(it != mapTxLockVotesOrphan.end()) {
         if(ProcessTxLockVote(NULL, it->second)) {
@@ -391,7 +471,7 @@ void UpdateLockedTransaction(const CTransaction& tx, bool fForceNotification)
 #endif
 
     if(nSignatures == INSTANTSEND_SIGNATURES_REQUIRED || (fForceNotification && nSignatures > INSTANTSEND_SIGNATURES_REQUIRED))
-        GetMainSignals().NotifyTransactionLock(tx);
+        QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().NotifyTransactionLock), tx));
 }
 
 void LockTransactionInputs(const CTransaction& tx) {
@@ -417,11 +497,8 @@ bool FindConflictingLocks(const CTransaction& tx)
             if(mapLockedInputs[txin.prevout] != txHash) {
                 LogPrintf("FindConflictingLocks -- found two complete conflicting Transaction Locks, removing both: txid=%s, txin=%s", txHash.ToString(), mapLockedInputs[txin.prevout].ToString());
 
-                if(mapTxLockCandidates.count(txHash))
-                    mapTxLockCandidates[txHash].nExpirationBlock = -1;
-
-                if(mapTxLockCandidates.count(mapLockedInputs[txin.prevout]))
-                    mapTxLockCandidates[mapLockedInputs[txin.prevout]].nExpirationBlock = -1;
+                ExpireTxLockCandidate(txHash);
+                ExpireTxLockCandidate(mapLockedInputs[txin.prevout]);
 
                 return true;
             }
@@ -445,20 +522,21 @@ void ResolveConflicts(const CTransaction& tx)
     }
 }
 
+void ExpireTxLockCandidate(const uint256& txHash)
+{
+    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    if(it == mapTxLockCandidates.end()) return;
+
+    it->second.nExpirationBlock = -1;
+    mapTxLockCandidatesByExpiry.insert(std::make_pair(-1, txHash));
+}
+
 int64_t GetAverageDynodeOrphanVoteTime()
 {
     // NOTE: should never actually call this function when mapDynodeOrphanVotes is empty
     if(mapDynodeOrphanVotes.empty()) return 0;
 
-    std::map<COutPoint, int64_t>::iterator it = mapDynodeOrphanVotes.begin();
-    int64_t total = 0;
-
-    while(it != mapDynodeOrphanVotes.end()) {
-        total+= it->second;
-        ++it;
-    }
-
-    return total / mapDynodeOrphanVotes.size();
+    return nDynodeOrphanVoteTimeTotal / mapDynodeOrphanVotes.size();
 }
 
 void CleanTxLockCandidates()
@@ -471,53 +549,78 @@ void CleanTxLockCandidates()
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.begin();
+    int64_t nNow = GetTime();
 
-    while(it != mapTxLockCandidates.end()) {
-        CTxLockCandidate &txLockCandidate = it->second;
-        if(nHeight > txLockCandidate.nExpirationBlock) {
-            LogPrintf("CleanTxLockCandidates -- Removing expired Transaction Lock Candidate: txid=%s\n", txLockCandidate.txHash.ToString());
+    while(!mapTxLockCandidatesByExpiry.empty() && nHeight > mapTxLockCandidatesByExpiry.begin()->first) {
+        int nExpirationBlock = mapTxLockCandidatesByExpiry.begin()->first;
+        uint256 txHash = mapTxLockCandidatesByExpiry.begin()->second;
+        mapTxLockCandidatesByExpiry.erase(mapTxLockCandidatesByExpiry.begin());
 
-            if(mapLockRequestAccepted.count(txLockCandidate.txHash)){
-                CTransaction& tx = mapLockRequestAccepted[txLockCandidate.txHash];
+        std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+        if(it == mapTxLockCandidates.end() || it->second.nExpirationBlock != nExpirationBlock)
+            continue; // stale entry
 
-                BOOST_FOREACH(const CTxIn& txin, tx.vin)
-                    mapLockedInputs.erase(txin.prevout);
+        CTxLockCandidate &txLockCandidate = it->second;
+        LogPrintf("CleanTxLockCandidates -- Removing expired Transaction Lock Candidate: txid=%s\n", txLockCandidate.txHash.ToString());
 
-                mapLockRequestAccepted.erase(txLockCandidate.txHash);
-                mapLockRequestRejected.erase(txLockCandidate.txHash);
+        if(mapLockRequestAccepted.count(txLockCandidate.txHash)){
+            CTransaction& tx = mapLockRequestAccepted[txLockCandidate.txHash];
 
-                BOOST_FOREACH(const CTxLockVote& vote, txLockCandidate.vecTxLockVotes)
-                    if(mapTxLockVotes.count(vote.GetHash()))
-                        mapTxLockVotes.erase(vote.GetHash());
-            }
+            BOOST_FOREACH(const CTxIn& txin, tx.vin)
+                mapLockedInputs.erase(txin.prevout);
 
-            mapTxLockCandidates.erase(it++);
-        } else {
-            ++it;
+            mapLockRequestAccepted.erase(txLockCandidate.txHash);
+            mapLockRequestRejected.erase(txLockCandidate.txHash);
+
+            BOOST_FOREACH(const CTxLockVote& vote, txLockCandidate.vecTxLockVotes)
+                mapTxLockVotes.erase(vote.GetHash());
         }
+
+        mapTxLockCandidates.erase(it);
     }
 
     // clean expired orphan votes
-    std::map<uint256, CTxLockVote>::iterator it1 = mapTxLockVotesOrphan.begin();
-    while(it1 != mapTxLockVotesOrphan.end()) {
-        if(it1->second.nOrphanExpireTime < GetTime()) {
+    while(!dqTxLockVotesOrphanExpiry.empty() && dqTxLockVotesOrphanExpiry.front().first < nNow) {
+        std::map<uint256, CTxLockVote>::iterator it1 = mapTxLockVotesOrphan.find(dqTxLockVotesOrphanExpiry.front().second);
+        if(it1 != mapTxLockVotesOrphan.end() && it1->second.nOrphanExpireTime == dqTxLockVotesOrphanExpiry.front().first) {
             LogPrint("instantsend", "CleanTxLockCandidates -- Removing expired orphan vote: txid=%s  dynode=%s\n", it1->second.txHash.ToString(), it1->second.vinDynode.prevout.ToStringShort());
-            mapTxLockVotesOrphan.erase(it1++);
-        } else {
-            ++it1;
+            mapTxLockVotesOrphan.erase(it1);
+        }
+        dqTxLockVotesOrphanExpiry.pop_front();
+    }
+
+    {
+        LOCK(cs_verifiedvotes);
+        // verified votes are kept for as long as locks
+        while(!dqVerifiedTxLockVotes.empty() && nNow - dqVerifiedTxLockVotes.front().first > 60 * 60) {
+            std::map<uint256, int64_t>::iterator it3 = mapVerifiedTxLockVotes.find(dqVerifiedTxLockVotes.front().second);
+            if(it3 != mapVerifiedTxLockVotes.end() && it3->second == dqVerifiedTxLockVotes.front().first)
+                mapVerifiedTxLockVotes.erase(it3);
+            dqVerifiedTxLockVotes.pop_front();
+        }
+    }
+
+    {
+        LOCK(cs_txlockquorums);
+        std::map<int, CTxLockQuorum>::iterator it4 = mapTxLockQuorums.begin();
+        while(it4 != mapTxLockQuorums.end()) {
+            if(nNow - it4->second.nTime > INSTANTSEND_QUORUM_CACHE_SECONDS) {
+                mapTxLockQuorums.erase(it4++);
+            } else {
+                ++it4;
+            }
         }
     }
 
     // clean expired dynode orphan vote times
-    std::map<COutPoint, int64_t>::iterator it2 = mapDynodeOrphanVotes.begin();
-    while(it2 != mapDynodeOrphanVotes.end()) {
-        if(it2->second < GetTime()) {
+    while(!dqDynodeOrphanVotesExpiry.empty() && dqDynodeOrphanVotesExpiry.front().first < nNow) {
+        std::map<COutPoint, int64_t>::iterator it2 = mapDynodeOrphanVotes.find(dqDynodeOrphanVotesExpiry.front().second);
+        if(it2 != mapDynodeOrphanVotes.end() && it2->second == dqDynodeOrphanVotesExpiry.front().first) {
             LogPrint("instantsend", "CleanTxLockCandidates -- Removing expired orphan dynode vote time: dynode=%s\n", it2->first.ToStringShort());
-            mapDynodeOrphanVotes.erase(it2++);
-        } else {
-            ++it2;
+            nDynodeOrphanVoteTimeTotal -= it2->second;
+            mapDynodeOrphanVotes.erase(it2);
         }
+        dqDynodeOrphanVotesExpiry.pop_front();
     }
 }
 
@@ -551,11 +654,83 @@ bool IsTransactionLockTimedOut(const uint256 &txHash)
     return false;
 }
 
+int GetTxLockVoteRank(const CTxIn& vinDynode, int nBlockHeight)
+{
+    bool fCached = false;
+    int nCachedRank = -1;
+    {
+        LOCK(cs_txlockquorums);
+        std::map<int, CTxLockQuorum>::iterator it = mapTxLockQuorums.find(nBlockHeight);
+        if(it != mapTxLockQuorums.end() && GetTime() - it->second.nTime <= INSTANTSEND_QUORUM_CACHE_SECONDS) {
+            fCached = true;
+            std::map<COutPoint, int>::iterator itRank = it->second.mapRanks.find(vinDynode.prevout);
+            if(itRank != it->second.mapRanks.end())
+                nCachedRank = itRank->second;
+        }
+    }
+
+    if(fCached) {
+        // not in the top dynodes, rank it fully in case it just got enabled
+        if(nCachedRank == -1)
+            return dnodeman.GetDynodeRank(vinDynode, nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION);
+        // the quorum may predate a change of the list, only dynodes still enabled keep their rank
+        dynode_info_t infoDn = dnodeman.GetDynodeInfo(vinDynode);
+        if(!infoDn.fInfoValid || infoDn.nActiveState != CDynode::DYNODE_ENABLED)
+            return -1;
+        return nCachedRank;
+    }
+
+    std::vector<std::pair<int, CDynode> > vecDynodeRanks = dnodeman.GetDynodeRanks(nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION);
+    if(vecDynodeRanks.empty()) return -1; // unknown block
+
+    CTxLockQuorum quorum;
+    quorum.nTime = GetTime();
+    int nRank = -1;
+    for(size_t i = 0; i < vecDynodeRanks.size(); i++) {
+        if(vecDynodeRanks[i].first <= INSTANTSEND_SIGNATURES_TOTAL)
+            quorum.mapRanks[vecDynodeRanks[i].second.vin.prevout] = vecDynodeRanks[i].first;
+        if(vecDynodeRanks[i].second.vin.prevout == vinDynode.prevout)
+            nRank = vecDynodeRanks[i].first;
+    }
+
+    LOCK(cs_txlockquorums);
+    mapTxLockQuorums[nBlockHeight] = quorum;
+    return nRank;
+}
+
+void ClearTxLockQuorums()
+{
+    LOCK(cs_txlockquorums);
+    mapTxLockQuorums.clear();
+}
+
+bool CheckTxLockVoteSignature(const CTxLockVote& vote)
+{
+    uint256 hash = SerializeHash(vote);
+    {
+        LOCK(cs_verifiedvotes);
+        if(mapVerifiedTxLockVotes.count(hash)) return true;
+    }
+
+    if(!vote.CheckSignature()) return false;
+
+    SetTxLockVoteVerified(vote);
+    return true;
+}
+
 uint256 CTxLockVote::GetHash() const
 {
     return ArithToUint256(UintToArith256(vinDynode.prevout.hash) + vinDynode.prevout.n + UintToArith256(txHash));
 }
 
+uint256 CTxLockVote::GetSignatureHash() const
+{
+    // the hash CPrivateSendSigner::SignMessage signs
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << txHash.ToString() + boost::lexical_cast<std::string>(nBlockHeight);
+    return ss.GetHash();
+}
 
 bool CTxLockVote::CheckSignature() const
 {
@@ -599,10 +774,14 @@ bool CTxLockVote::Sign()
 
 bool CTxLockCandidate::IsAllVotesValid()
 {
+    std::vector<const CTxLockVote*> vecVotes;
+    BOOST_FOREACH(const CTxLockVote& vote, vecTxLockVotes)
+        vecVotes.push_back(&vote);
+    CheckTxLockVoteSignatures(vecVotes);
 
     BOOST_FOREACH(const CTxLockVote& vote, vecTxLockVotes)
     {
-        int n = dnodeman.GetDynodeRank(vote.vinDynode, vote.nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION);
+        int n = GetTxLockVoteRank(vote.vinDynode, vote.nBlockHeight);
 
         if(n == -1) {
             LogPrintf("CTxLockCandidate::IsAllVotesValid -- Unknown Dynode, txin=%s\n", vote.vinDynode.ToString());
@@ -614,7 +793,7 @@ bool CTxLockCandidate::IsAllVotesValid()
             return false;
         }
 
-        if(!vote.CheckSignature()) {
+        if(!CheckTxLockVoteSignature(vote)) {
             LogPrintf("CTxLockCandidate::IsAllVotesValid -- Signature not valid\n");
             return false;
         }
@@ -626,6 +805,7 @@ bool CTxLockCandidate::IsAllVotesValid()
 void CTxLockCandidate::AddVote(const CTxLockVote& vote)
 {
     vecTxLockVotes.push_back(vote);
+    mapVoteCountByHeight[vote.nBlockHeight]++;
 }
 
 int CTxLockCandidate::CountVotes()
@@ -637,10 +817,6 @@ int CTxLockCandidate::CountVotes()
 
     if(nBlockHeight == 0) return -1;
 
-    int nCount = 0;
-    BOOST_FOREACH(const CTxLockVote& vote, vecTxLockVotes)
-        if(vote.nBlockHeight == nBlockHeight)
-            nCount++;
-
-    return nCount;
+    std::map<int, int>::const_iterator it = mapVoteCountByHeight.find(nBlockHeight);
+    return it == mapVoteCountByHeight.end() ? 0 : it->second;
 }
@@ -31,6 +31,8 @@ static const int INSTANTSEND_SIGNATURES_TOTAL       = 20;
 static const int DEFAULT_INSTANTSEND_DEPTH          = 10;
 
 static const int MIN_INSTANTSEND_PROTO_VERSION      = 60800;
+// how long the top dynodes of a lock height are reused before ranking them again
+static const int INSTANTSEND_QUORUM_CACHE_SECONDS   = 30;
 static const CAmount INSTANTSEND_MIN_FEE            = 0.001 * COIN;
 
 extern bool fEnableInstantSend;
@@ -82,8 +84,20 @@ int GetTransactionLockSignatures(const uint256 &txHash);
 // verify if transaction lock timed out
 bool IsTransactionLockTimedOut(const uint256 &txHash);
 
+// make a transaction lock candidate expire at the next cleanup
+void ExpireTxLockCandidate(const uint256& txHash);
+
 int64_t GetAverageDynodeOrphanVoteTime();
 
+// rank of a dynode at a lock height, using the cached top dynodes of that height
+int GetTxLockVoteRank(const CTxIn& vinDynode, int nBlockHeight);
+
+// verify the signature of a vote, remembering the ones that passed
+bool CheckTxLockVoteSignature(const CTxLockVote& vote);
+
+// forget the cached top dynodes, the dynode list changed
+void ClearTxLockQuorums();
+
 class CTxLockVote
 {
 public:
@@ -106,6 +120,7 @@ public:
     }
 
     uint256 GetHash() const;
+    uint256 GetSignatureHash() const;
 
     bool Sign();
     bool CheckSignature() const;
@@ -117,6 +132,7 @@ public:
     int nBlockHeight;
     uint256 txHash;
     std::vector<CTxLockVote> vecTxLockVotes;
+    std::map<int, int> mapVoteCountByHeight; // number of votes in vecTxLockVotes per vote height
     int nExpirationBlock;
     int nTimeout;
 
@@ -65,6 +65,7 @@ using namespace std;
  */
 
 CCriticalSection cs_main;
+boost::shared_mutex cs_chainstate;
 
 BlockMap mapBlockIndex;
 CChain chainActive;
@@ -608,6 +609,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewPrefetch *pcoinsPrefetch = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1468,7 +1470,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
                     FormatMoney(nModifiedFees - nConflictingFees),
                     (int)nSize - (int)nConflictingSize);
         }
-        pool.RemoveStaged(allConflicting);
+        pool.RemoveStaged(allConflicting, MPR_REPLACED);
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry, setAncestors, !IsInitialBlockDownload());
@@ -1563,13 +1565,12 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
 {
     CBlockIndex *pindexSlow = NULL;
 
-    LOCK(cs_main);
-
     if (mempool.lookup(hash, txOut))
     {
         return true;
     }
 
+    // The tx index and the block files are safe to read without cs_main
     if (fTxIndex) {
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
@@ -1591,6 +1592,8 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
         }
     }
 
+    LOCK(cs_main);
+
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
         int nHeight = -1;
         {
@@ -1684,6 +1687,35 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadIndexedBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const CBlockHeader& header)
+{
+    block.SetNull();
+
+    // Open history file to read
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("ReadIndexedBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+    // Read block
+    try {
+        filein >> block;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+
+    // The index entry passed the proof of work check when it was accepted, an identical
+    // header hashes the same. The merkle root then ties the transactions to that header.
+    if (block.nVersion != header.nVersion || block.hashPrevBlock != header.hashPrevBlock ||
+        block.hashMerkleRoot != header.hashMerkleRoot || block.nTime != header.nTime ||
+        block.nBits != header.nBits || block.nNonce != header.nNonce)
+        return error("ReadIndexedBlockFromDisk: header doesn't match index at %s", pos.ToString());
+    if (BlockMerkleRoot(block) != header.hashMerkleRoot)
+        return error("ReadIndexedBlockFromDisk: merkle root doesn't match index at %s", pos.ToString());
+
+    return true;
+}
+
 int64_t GetTotalCoinEstimate(int nHeight)
 {
     int64_t nTotalCoins = 0;
@@ -1883,11 +1915,16 @@ void static InvalidBlockFound(CBlockIndex *pindex, const CValidationState &state
         }
     }
     if (!state.CorruptionPossible()) {
-        pindex->nStatus |= BLOCK_FAILED_VALID;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+            pindex->nStatus |= BLOCK_FAILED_VALID;
+        }
         setDirtyBlockIndex.insert(pindex);
         setBlockIndexCandidates.erase(pindex);
         InvalidChainFound(pindex);
     }
+    if (pcoinsPrefetch)
+        pcoinsPrefetch->BlockRejected(pindex->GetBlockHash());
 }
 
 void UpdateCoins(const CTransaction& tx, CValidationState &state, CCoinsViewCache &inputs, CTxUndo &txundo, int nHeight)
@@ -1931,6 +1968,13 @@ void UpdateCoins(const CTransaction& tx, CValidationState &state, CCoinsViewCach
 }
 
 bool CScriptCheck::operator()() {
+    if (ptxTo == NULL) {
+        CPubKey pubkeyFromSig;
+        if (!pubkeyFromSig.RecoverCompact(hashMessage, vchSig) || pubkeyFromSig.GetID() != keyIDSigner)
+            return false;
+        error = SCRIPT_ERR_OK;
+        return true;
+    }
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore), &error)) {
         return false;
@@ -2336,6 +2380,30 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+void RunScriptChecks(const std::vector<CScriptCheck>& vChecks, std::vector<char>& vfValidRet)
+{
+    if (nScriptCheckThreads && vChecks.size() > 1) {
+        // the queue only answers for the whole batch, which is all that's needed when everything is fine
+        TRY_LOCK(cs_main, lockMain);
+        if (lockMain) {
+            std::vector<CScriptCheck> vChecksQueued(vChecks);
+            CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+            control.Add(vChecksQueued);
+            if (control.Wait()) {
+                vfValidRet.assign(vChecks.size(), true);
+                return;
+            }
+        }
+    }
+
+    // one by one to tell the failures apart
+    vfValidRet.assign(vChecks.size(), false);
+    for (unsigned int i = 0; i < vChecks.size(); i++) {
+        CScriptCheck check(vChecks[i]);
+        vfValidRet[i] = check();
+    }
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -2418,7 +2486,7 @@ int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Para
 
 bool GetBlockHash(uint256& hashRet, int nBlockHeight)
 {
-    LOCK(cs_main);
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
     if(chainActive.Tip() == NULL) return false;
     if(nBlockHeight < -1 || nBlockHeight > chainActive.Height()) return false;
     if(nBlockHeight == -1) nBlockHeight = chainActive.Height();
@@ -2736,11 +2804,15 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return AbortNode(state, "Failed to write undo data");
 
             // update nUndoPos in block index
+            boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
             pindex->nUndoPos = pos.nPos;
             pindex->nStatus |= BLOCK_HAVE_UNDO;
         }
 
-        pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+            pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        }
         setDirtyBlockIndex.insert(pindex);
     }
 
@@ -2878,13 +2950,15 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
+        // With -asyncflush this only hands the dirty entries to the coin database's
+        // writer thread, and pcoinsTip continues as an empty cache on top of them.
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
         nLastFlush = nNow;
     }
     if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
         // Update best block in wallet (so we can detect restored wallets).
-        GetMainSignals().SetBestChain(chainActive.GetLocator());
+        QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().SetBestChain), chainActive.GetLocator()));
         nLastSetChain = nNow;
     }
     } catch (const std::runtime_error& e) {
@@ -2904,15 +2978,53 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+/** Memoized GetChainTipStats() result, refreshed by UpdateTip */
+static CCriticalSection cs_tipStats;
+static CChainTipStats tipStats;
+
+static void ComputeChainTipStats(const CBlockIndex* pindex, CChainTipStats& stats)
+{
+    stats = CChainTipStats();
+    stats.pindex = pindex;
+    if (pindex == NULL)
+        return;
+    stats.dDifficulty = GetBlockDifficulty(*pindex);
+    stats.nMedianTimePast = pindex->GetMedianTimePast();
+    stats.nHashPSLookup = std::min(DEFAULT_NETWORK_HASHPS_LOOKUP, pindex->nHeight);
+    stats.dNetworkHashPS = GetNetworkHashRate(pindex, stats.nHashPSLookup);
+    stats.nRetargetHashPSLookup = std::min((int)(pindex->nHeight % Params().GetConsensus().DifficultyAdjustmentInterval()) + 1, pindex->nHeight);
+    stats.dRetargetNetworkHashPS = GetNetworkHashRate(pindex, stats.nRetargetHashPSLookup);
+}
+
+CChainTipStats GetChainTipStats()
+{
+    LOCK(cs_tipStats);
+    // The tip can also be set without UpdateTip, when loading the block index
+    if (tipStats.pindex != chainActive.Tip())
+        ComputeChainTipStats(chainActive.Tip(), tipStats);
+    return tipStats;
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     const CChainParams& chainParams = Params();
-    chainActive.SetTip(pindexNew);
+    CChainTipStats stats;
+    ComputeChainTipStats(pindexNew, stats);
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+        chainActive.SetTip(pindexNew);
+        LOCK(cs_tipStats);
+        tipStats = stats;
+    }
 
     // New best block
     nTimeBestReceived = GetTime();
     mempool.AddTransactionsUpdated(1);
 
+    // Lookups for this block and any stale ones up to its height won't be used
+    if (pcoinsPrefetch)
+        pcoinsPrefetch->UpdatedTip(pindexNew->nHeight);
+
     LogPrintf("%s: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%.1fMiB(%utx)\n", __func__,
       chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(), log(chainActive.Tip()->nChainWork.getdouble())/log(2.0), (unsigned long)chainActive.Tip()->nChainTx,
       DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()),
@@ -2990,7 +3102,7 @@ bool static DisconnectTip(CValidationState& state, const Consensus::Params& cons
         list<CTransaction> removed;
         CValidationState stateDummy;
         if (tx.IsCoinBase() || !AcceptToMemoryPool(mempool, stateDummy, tx, false, NULL, true)) {
-            mempool.remove(tx, removed, true);
+            mempool.remove(tx, removed, true, MPR_REORG);
         } else if (mempool.exists(tx.GetHash())) {
             vHashUpdate.push_back(tx.GetHash());
         }
@@ -3067,10 +3179,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     BOOST_FOREACH(const CTransaction &tx, txConflicted) {
         SyncWithWallets(tx, NULL);
     }
-    // ... and about transactions that got confirmed:
-    BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
-        SyncWithWallets(tx, pblock);
-    }
+    // ... and about the block and the transactions that got confirmed:
+    NotifyBlockConnected(*pblock, pindexNew);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
@@ -3160,6 +3270,7 @@ static CBlockIndex* FindMostWorkChain() {
                 // Remove the entire chain from the set.
                 while (pindexTest != pindexFailed) {
                     if (fFailedChain) {
+                        boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
                         pindexFailed->nStatus |= BLOCK_FAILED_CHILD;
                     } else if (fMissingData) {
                         // If we're missing data, then add back to mapBlocksUnlinked,
@@ -3337,7 +3448,7 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
                 }
                 // Notify external listeners about the new tip.
                 if (!vHashes.empty()) {
-                    GetMainSignals().UpdatedBlockTip(pindexNewTip);
+                    QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().UpdatedBlockTip), pindexNewTip));
                 }
             }
         }
@@ -3357,13 +3468,19 @@ bool InvalidateBlock(CValidationState& state, const Consensus::Params& consensus
     AssertLockHeld(cs_main);
 
     // Mark the block itself as invalid.
-    pindex->nStatus |= BLOCK_FAILED_VALID;
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+        pindex->nStatus |= BLOCK_FAILED_VALID;
+    }
     setDirtyBlockIndex.insert(pindex);
     setBlockIndexCandidates.erase(pindex);
 
     while (chainActive.Contains(pindex)) {
         CBlockIndex *pindexWalk = chainActive.Tip();
-        pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+            pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
+        }
         setDirtyBlockIndex.insert(pindexWalk);
         setBlockIndexCandidates.erase(pindexWalk);
         // ActivateBestChain considers blocks already in chainActive
@@ -3395,6 +3512,7 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex) {
     AssertLockHeld(cs_main);
 
     int nHeight = pindex->nHeight;
+    boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
 
     // Remove the invalidity flag from this block and all its descendants.
     BlockMap::iterator it = mapBlockIndex.begin();
@@ -3439,19 +3557,22 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
-    BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
-    pindexNew->phashBlock = &((*mi).first);
-    BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
-    if (miPrev != mapBlockIndex.end())
     {
-        pindexNew->pprev = (*miPrev).second;
-        pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
-        pindexNew->BuildSkip();
+        boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+        BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
+        pindexNew->phashBlock = &((*mi).first);
+        BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
+        if (miPrev != mapBlockIndex.end())
+        {
+            pindexNew->pprev = (*miPrev).second;
+            pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
+            pindexNew->BuildSkip();
+        }
+        pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
+        pindexNew->RaiseValidity(BLOCK_VALID_TREE);
+        if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
+            pindexBestHeader = pindexNew;
     }
-    pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
-    pindexNew->RaiseValidity(BLOCK_VALID_TREE);
-    if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
-        pindexBestHeader = pindexNew;
 
     setDirtyBlockIndex.insert(pindexNew);
 
@@ -3461,13 +3582,17 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
 bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos)
 {
-    pindexNew->nTx = block.vtx.size();
-    pindexNew->nChainTx = 0;
-    pindexNew->nFile = pos.nFile;
-    pindexNew->nDataPos = pos.nPos;
-    pindexNew->nUndoPos = 0;
-    pindexNew->nStatus |= BLOCK_HAVE_DATA;
-    pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
+    {
+        // readers of the block data check nStatus and the position together
+        boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+        pindexNew->nTx = block.vtx.size();
+        pindexNew->nChainTx = 0;
+        pindexNew->nFile = pos.nFile;
+        pindexNew->nDataPos = pos.nPos;
+        pindexNew->nUndoPos = 0;
+        pindexNew->nStatus |= BLOCK_HAVE_DATA;
+        pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
+    }
     setDirtyBlockIndex.insert(pindexNew);
 
     if (pindexNew->pprev == NULL || pindexNew->pprev->nChainTx) {
@@ -3857,7 +3982,10 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, const CCha
 
     if ((!CheckBlock(block, state)) || !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
-            pindex->nStatus |= BLOCK_FAILED_VALID;
+            {
+                boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+                pindex->nStatus |= BLOCK_FAILED_VALID;
+            }
             setDirtyBlockIndex.insert(pindex);
         }
         return false;
@@ -3903,9 +4031,26 @@ static bool IsSuperMajority(int minVersion, const CBlockIndex* pstart, unsigned
 
 bool ProcessNewBlock(CValidationState& state, const CChainParams& chainparams, const CNode* pfrom, const CBlock* pblock, bool fForceProcessing, CDiskBlockPos* dbp)
 {
+    // Don't let validation run arbitrarily far ahead of the notification listeners
+    LimitValidationInterfaceQueue();
+
     // Preliminary checks
     bool checked = CheckBlock(*pblock, state);
 
+    // Start reading the coins this block spends while it waits for cs_main.
+    if (checked && pcoinsPrefetch) {
+        int nHeight = -1;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+            BlockMap::const_iterator mi = mapBlockIndex.find(pblock->hashPrevBlock);
+            if (mi != mapBlockIndex.end())
+                nHeight = mi->second->nHeight + 1;
+        }
+        // Without its parent the block can't be connected soon
+        if (nHeight > 0)
+            pcoinsPrefetch->Prefetch(*pblock, nHeight);
+    }
+
     {
         LOCK(cs_main);
         bool fRequested = MarkBlockAsReceived(pblock->GetHash());
@@ -3975,6 +4120,7 @@ uint64_t CalculateCurrentUsage()
 /* Prune a block file (modify associated database entries)*/
 void PruneOneBlockFile(const int fileNumber)
 {
+    boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
     for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
         CBlockIndex* pindex = it->second;
         if (pindex->nFile == fileNumber) {
@@ -4124,6 +4270,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     CBlockIndex* pindexNew = new CBlockIndex();
     if (!pindexNew)
         throw runtime_error("LoadBlockIndex(): new CBlockIndex failed");
+    boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
     mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -4240,7 +4387,10 @@ bool static LoadBlockIndexDB()
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
         return true;
-    chainActive.SetTip(it->second);
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
+        chainActive.SetTip(it->second);
+    }
 
     PruneBlockIndexCandidates();
 
@@ -4343,6 +4493,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    boost::unique_lock<boost::shared_mutex> lock(cs_chainstate);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
     pindexBestInvalid = NULL;
@@ -5135,7 +5286,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             }
 
             // Track requests for our stuff.
-            GetMainSignals().Inventory(inv.hash);
+            QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().Inventory), inv.hash));
 
             if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
                 break;
@@ -5475,7 +5626,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             }
 
             // Track requests for our stuff
-            GetMainSignals().Inventory(inv.hash);
+            QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().Inventory), inv.hash));
 
             if (pfrom->nSendSize > (SendBufferSize() * 2)) {
                 Misbehaving(pfrom->GetId(), 50);
@@ -16,6 +16,7 @@
 #include "chain.h"
 #include "coins.h"
 #include "net.h"
+#include "pubkey.h"
 #include "script/script_error.h"
 #include "sync.h"
 #include "versionbits.h"
@@ -30,12 +31,14 @@
 #include <utility>
 #include <vector>
 
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/unordered_map.hpp>
 
 class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
+class CCoinsViewPrefetch;
 class CInv;
 class CScriptCheck;
 class CTxMemPool;
@@ -141,6 +144,13 @@ struct BlockHasher
 
 extern CScript COINBASE_FLAGS;
 extern CCriticalSection cs_main;
+/**
+ * Guards chainActive, the entries of mapBlockIndex, their nStatus and where their block
+ * data is, for readers that don't take cs_main. Code changing those holds it unique on top
+ * of cs_main, only for the change itself. It isn't recursive, and cs_main must never be taken while
+ * holding it shared.
+ */
+extern boost::shared_mutex cs_chainstate;
 extern CTxMemPool mempool;
 typedef boost::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
@@ -153,6 +163,7 @@ extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fSpentIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
@@ -686,6 +697,9 @@ bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp = NULL
 /**
  * Closure representing one script verification
  * Note that this stores references to the spending transaction 
+ * Without a transaction it checks a compact signature of a message hash instead
+ * (a signed network message such as an InstantSend vote), the signer's key is
+ * looked up by the caller so the check threads only do the curve math.
  */
 class CScriptCheck
 {
@@ -696,12 +710,21 @@ private:
     unsigned int nFlags;
     bool cacheStore;
     ScriptError error;
+    uint256 hashMessage;
+    CKeyID keyIDSigner;
+    std::vector<unsigned char> vchSig;
 
 public:
     CScriptCheck(): ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
     CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) :
         scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey),
         ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
+    CScriptCheck(const CScript& scriptPubKeyIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) :
+        scriptPubKey(scriptPubKeyIn),
+        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
+    CScriptCheck(const uint256& hashMessageIn, const CKeyID& keyIDSignerIn, const std::vector<unsigned char>& vchSigIn) :
+        ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR),
+        hashMessage(hashMessageIn), keyIDSigner(keyIDSignerIn), vchSig(vchSigIn) { }
 
     bool operator()();
 
@@ -712,11 +735,21 @@ public:
         std::swap(nFlags, check.nFlags);
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
+        std::swap(hashMessage, check.hashMessage);
+        std::swap(keyIDSigner, check.keyIDSigner);
+        vchSig.swap(check.vchSig);
     }
 
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Run script checks that don't depend on each other and tell which of them pass.
+ * They go to the script check threads when cs_main can be had right away (the
+ * threads are only used under it), otherwise they run on the calling thread.
+ */
+void RunScriptChecks(const std::vector<CScriptCheck>& vChecks, std::vector<char>& vfValidRet);
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
@@ -729,6 +762,9 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read a block that is already in the block index. Its header and merkle root are checked against
+ *  the index entry instead of recomputing the proof of work, so cs_main isn't needed given pos and header. */
+bool ReadIndexedBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const CBlockHeader& header);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -828,12 +864,37 @@ bool InvalidateBlock(CValidationState& state, const Consensus::Params& consensus
 /** Remove invalidity status from a block and its descendants. */
 bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex);
 
-/** The currently-connected chain of blocks (protected by cs_main). */
+/** The currently-connected chain of blocks (protected by cs_main, readable under cs_chainstate). */
 extern CChain chainActive;
 
+/** Default number of blocks getnetworkhashps averages over */
+static const int DEFAULT_NETWORK_HASHPS_LOOKUP = 120;
+
+/** Statistics about the tip of chainActive, computed once per tip for the RPCs that poll them */
+struct CChainTipStats
+{
+    const CBlockIndex* pindex;
+    double dDifficulty;
+    int64_t nMedianTimePast;
+    //! Network hash rate over the last nHashPSLookup blocks (DEFAULT_NETWORK_HASHPS_LOOKUP, or fewer near genesis)
+    int nHashPSLookup;
+    double dNetworkHashPS;
+    //! Network hash rate over the blocks since the last difficulty adjustment
+    int nRetargetHashPSLookup;
+    double dRetargetNetworkHashPS;
+
+    CChainTipStats() : pindex(NULL), dDifficulty(1.0), nMedianTimePast(0), nHashPSLookup(0), dNetworkHashPS(0), nRetargetHashPSLookup(0), dRetargetNetworkHashPS(0) {}
+};
+
+/** Statistics of the current tip; caller holds cs_main or cs_chainstate, as for reading chainActive */
+CChainTipStats GetChainTipStats();
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Global variable that points to the UTXO prefetch layer below pcoinsTip, or NULL if disabled */
+extern CCoinsViewPrefetch *pcoinsPrefetch;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
@@ -197,6 +197,149 @@ bool CheckWork(const CChainParams& chainparams, CBlock* pblock, CWallet& wallet,
     return true;
 }
 
+namespace {
+/**
+ * Selection made for the last template. While the tip and the coinbase script
+ * stay the same and the mempool has only gained transactions, the next
+ * template is produced by appending the new arrivals to this one instead of
+ * running the full selection and TestBlockValidity again.
+ * Protected by cs_main.
+ */
+struct CBlockAssemblyState
+{
+    bool fValid;
+    uint256 hashPrevBlock;
+    CScript scriptPubKey;
+    int nHeight;
+    int64_t nLockTimeCutoff;
+    unsigned int nBlockMaxSize;
+    unsigned int nBlockMinSize;
+    unsigned int nTransactionsRemoved;
+    //! CTxMemPool::GetTransactionsAdded() when the mempool was last scanned; later arrivals have not been considered
+    uint64_t nSelectionSequence;
+    CBlockTemplate blocktemplate;
+    CTxMemPool::setEntries inBlock;
+    uint64_t nBlockSize;
+    uint64_t nBlockTx;
+    unsigned int nBlockSigOps;
+    CAmount nFees;
+
+    CBlockAssemblyState() : fValid(false) {}
+};
+
+CBlockAssemblyState lastAssembly;
+
+/** Sort candidates by descending mining score */
+struct CompareIteratorByScore
+{
+    bool operator()(const CTxMemPool::txiter a, const CTxMemPool::txiter b) const
+    {
+        return CompareTxMemPoolEntryByScore()(*a, *b);
+    }
+};
+}
+
+/** Fill in the coinbase and header of a template whose transactions have been selected */
+static void FinishBlockTemplate(CBlockTemplate* pblocktemplate, const CChainParams& chainparams, CBlockIndex* pindexPrev, const CScript& scriptPubKeyIn, CAmount nFees)
+{
+    CBlock *pblock = &pblocktemplate->block;
+    const int nHeight = pindexPrev->nHeight + 1;
+
+    CMutableTransaction txNew;
+    txNew.vin.resize(1);
+    txNew.vin[0].prevout.SetNull();
+    txNew.vout.resize(1);
+    txNew.vout[0].scriptPubKey = scriptPubKeyIn;
+
+    // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
+    CAmount blockReward = nFees + GetPoWBlockPayment(nHeight, chainparams.GetConsensus(), nFees);
+
+    // Compute regular coinbase transaction.
+    txNew.vout[0].nValue = blockReward;
+    txNew.vin[0].scriptSig = CScript() << nHeight << OP_0;
+
+    // Update coinbase transaction with additional info about dynode and governace payments,
+    // get some info back to pass to getblocktemplate
+    FillBlockPayments(txNew, nHeight, blockReward, pblock->txoutDynode, pblock->voutSuperblock);
+    // LogPrintf("CreateNewBlock -- nBlockHeight %d blockReward %lld txoutDynode %s txNew %s",
+    //             nHeight, blockReward, pblock->txoutDynode.ToString(), txNew.ToString());
+
+    // Update block coinbase
+    pblock->vtx[0] = txNew;
+    pblocktemplate->vTxFees[0] = -nFees;
+
+    // Fill in header
+    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
+    UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
+    pblock->nNonce         = 0;
+    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+}
+
+/**
+ * Append transactions that entered the mempool since the last selection to
+ * its template. Returns false if a full selection could produce a different
+ * block, e.g. because a new transaction does not fit or would only qualify
+ * for the priority area.
+ */
+static bool AppendNewMempoolTransactions(CBlockAssemblyState& state)
+{
+    AssertLockHeld(mempool.cs);
+
+    std::vector<CTxMemPool::txiter> vNew;
+    for (CTxMemPool::txiter iter = mempool.mapTx.begin(); iter != mempool.mapTx.end(); ++iter) {
+        if (iter->GetSequence() > state.nSelectionSequence && !state.inBlock.count(iter))
+            vNew.push_back(iter);
+    }
+    std::sort(vNew.begin(), vNew.end(), CompareIteratorByScore());
+
+    // Children can outscore their parents, so keep passing over the
+    // candidates until no more of them can be added.
+    bool fProgress = true;
+    while (fProgress && !vNew.empty()) {
+        fProgress = false;
+        std::vector<CTxMemPool::txiter> vDeferred;
+        BOOST_FOREACH(CTxMemPool::txiter iter, vNew) {
+            bool fOrphan = false;
+            BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(iter)) {
+                if (!state.inBlock.count(parent)) {
+                    fOrphan = true;
+                    break;
+                }
+            }
+            if (fOrphan) {
+                vDeferred.push_back(iter);
+                continue;
+            }
+
+            const CTransaction& tx = iter->GetTx();
+            if (!IsFinalTx(tx, state.nHeight, state.nLockTimeCutoff))
+                continue;
+
+            unsigned int nTxSize = iter->GetTxSize();
+            unsigned int nTxSigOps = iter->GetSigOpCount();
+            if (state.nBlockSize + nTxSize >= state.nBlockMaxSize || state.nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
+                return false;
+            if (iter->GetModifiedFee() < ::minRelayTxFee.GetFee(nTxSize) && state.nBlockSize >= state.nBlockMinSize)
+                return false;
+
+            CAmount nTxFees = iter->GetFee();
+            state.blocktemplate.block.vtx.push_back(tx);
+            state.blocktemplate.vTxFees.push_back(nTxFees);
+            state.blocktemplate.vTxSigOps.push_back(nTxSigOps);
+            state.nBlockSize += nTxSize;
+            ++state.nBlockTx;
+            state.nBlockSigOps += nTxSigOps;
+            state.nFees += nTxFees;
+            state.inBlock.insert(iter);
+            fProgress = true;
+        }
+        vNew.swap(vDeferred);
+    }
+    // Whatever is left depends on transactions a full selection skipped as well.
+    return true;
+}
+
 CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn)
 {
     // Create new block
@@ -252,6 +395,38 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
         const int nHeight = pindexPrev->nHeight + 1;
         pblock->nTime = GetAdjustedTime();
         const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
+        const uint64_t nSelectionSequence = mempool.GetTransactionsAdded();
+
+        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                                ? nMedianTimePast
+                                : pblock->GetBlockTime();
+
+        // Try to extend the previous selection. The extended block is checked
+        // like a fresh one, if it fails the block is assembled from scratch.
+        if (lastAssembly.fValid && !fPrintPriority &&
+            lastAssembly.hashPrevBlock == pindexPrev->GetBlockHash() &&
+            lastAssembly.nHeight == nHeight &&
+            lastAssembly.nLockTimeCutoff == nLockTimeCutoff &&
+            lastAssembly.scriptPubKey == scriptPubKeyIn &&
+            lastAssembly.nBlockMaxSize == nBlockMaxSize &&
+            lastAssembly.nBlockMinSize == nBlockMinSize &&
+            lastAssembly.nTransactionsRemoved == mempool.GetTransactionsRemoved()) {
+            // On failure the state is left half-extended, but it is rebuilt below.
+            if (AppendNewMempoolTransactions(lastAssembly)) {
+                FinishBlockTemplate(&lastAssembly.blocktemplate, chainparams, pindexPrev, scriptPubKeyIn, lastAssembly.nFees);
+                CValidationState state;
+                if (TestBlockValidity(state, chainparams, lastAssembly.blocktemplate.block, pindexPrev, false, false)) {
+                    lastAssembly.nSelectionSequence = nSelectionSequence;
+                    nLastBlockTx = lastAssembly.nBlockTx;
+                    nLastBlockSize = lastAssembly.nBlockSize;
+                    LogPrint("bench", "CreateNewBlock(): extended previous template, total size %u txs: %u fees: %ld sigops %d\n",
+                             lastAssembly.nBlockSize, lastAssembly.nBlockTx, lastAssembly.nFees, lastAssembly.nBlockSigOps);
+                    return new CBlockTemplate(lastAssembly.blocktemplate);
+                }
+                LogPrintf("CreateNewBlock(): extended template failed TestBlockValidity: %s\n", FormatStateMessage(state));
+            }
+        }
+        lastAssembly.fValid = false;
 
         // Add our coinbase tx as first transaction
         pblock->vtx.push_back(txNew);
@@ -263,20 +438,18 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
         if (chainparams.MineBlocksOnDemand())
             pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
 
-        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
-                                ? nMedianTimePast
-                                : pblock->GetBlockTime();
-
-
         bool fPriorityBlock = nBlockPrioritySize > 0;
         if (fPriorityBlock) {
+            const bool fHaveDeltas = !mempool.mapDeltas.empty();
             vecPriority.reserve(mempool.mapTx.size());
             for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
                  mi != mempool.mapTx.end(); ++mi)
             {
                 double dPriority = mi->GetPriority(nHeight);
-                CAmount dummy;
-                mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
+                if (fHaveDeltas) {
+                    CAmount dummy;
+                    mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
+                }
                 vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
             }
             std::make_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
@@ -399,38 +572,32 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
             }
         }
 
-        // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
-        CAmount blockReward = nFees + GetPoWBlockPayment(nHeight, chainparams.GetConsensus(), nFees);
-
-        // Compute regular coinbase transaction.
-        txNew.vout[0].nValue = blockReward;
-        txNew.vin[0].scriptSig = CScript() << nHeight << OP_0;
-
-        // Update coinbase transaction with additional info about dynode and governace payments,
-        // get some info back to pass to getblocktemplate
-        FillBlockPayments(txNew, nHeight, blockReward, pblock->txoutDynode, pblock->voutSuperblock);
-        // LogPrintf("CreateNewBlock -- nBlockHeight %d blockReward %lld txoutDynode %s txNew %s",
-        //             nHeight, blockReward, pblock->txoutDynode.ToString(), txNew.ToString());
-
         nLastBlockTx = nBlockTx;
         nLastBlockSize = nBlockSize;
         LogPrintf("CreateNewBlock(): total size %u txs: %u fees: %ld sigops %d\n", nBlockSize, nBlockTx, nFees, nBlockSigOps);
 
-        // Update block coinbase
-        pblock->vtx[0] = txNew;
-        pblocktemplate->vTxFees[0] = -nFees;
-
-        // Fill in header
-        pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-        UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
-        pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
-        pblock->nNonce         = 0;
-        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+        FinishBlockTemplate(pblocktemplate.get(), chainparams, pindexPrev, scriptPubKeyIn, nFees);
 
         CValidationState state;
         if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
             throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
         }
+
+        lastAssembly.hashPrevBlock = pindexPrev->GetBlockHash();
+        lastAssembly.nHeight = nHeight;
+        lastAssembly.nLockTimeCutoff = nLockTimeCutoff;
+        lastAssembly.scriptPubKey = scriptPubKeyIn;
+        lastAssembly.nBlockMaxSize = nBlockMaxSize;
+        lastAssembly.nBlockMinSize = nBlockMinSize;
+        lastAssembly.nTransactionsRemoved = mempool.GetTransactionsRemoved();
+        lastAssembly.nSelectionSequence = nSelectionSequence;
+        lastAssembly.blocktemplate = *pblocktemplate;
+        lastAssembly.inBlock.swap(inBlock);
+        lastAssembly.nBlockSize = nBlockSize;
+        lastAssembly.nBlockTx = nBlockTx;
+        lastAssembly.nBlockSigOps = nBlockSigOps;
+        lastAssembly.nFees = nFees;
+        lastAssembly.fValid = true;
     }
 
     return pblocktemplate.release();
@@ -463,37 +630,69 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 double dHashesPerSec = 0.0;
 int64_t nHPSTimerStart = 0;
 
-// ScanHash scans nonces looking for a hash with at least some zero bits.
-// The nonce is usually preserved between calls, but periodically or if the
-// nonce is 0xffff0000 or above, the block is rebuilt and nNonce starts over at
-// zero.
-//
-//bool static ScanHash(const CBlockHeader *pblock, uint32_t& nNonce, uint256 *phash)
-//{
-    // Write the first 76 bytes of the block header to a double-SHA256 state.
-//    CHash256 hasher;
-//    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-//    ss << *pblock;
-//    assert(ss.size() == 80);
-//    hasher.Write((unsigned char*)&ss[0], 76);
-
-//    while (true) {
-//        nNonce++;
-
-        // Write the last 4 bytes of the block header (the nonce) to a copy of
-        // the double-SHA256 state, and compute the result.
-//        CHash256(hasher).Write((unsigned char*)&nNonce, 4).Finalize((unsigned char*)phash);
-
-        // Return the nonce if the hash has at least some zero bits,
-        // caller will check if it has enough to reach the target
-//        if (((uint16_t*)phash)[15] == 0)
-//            return true;
-
-        // If nothing found after trying for a while, return -1
-//        if ((nNonce & 0xfff) == 0)
-//            return false;
-//    }/
-//}
+/** Hash meter of one miner thread */
+struct CThreadHashMeter
+{
+    double dHashesPerSec;
+    int64_t nUpdateTime; //! GetTimeMillis() of the last update
+};
+
+static CCriticalSection cs_hashmeter;
+static std::vector<CThreadHashMeter> vThreadHashMeters;
+
+/** Record the rate of one miner thread and update the totals reported by gethashespersec */
+static void UpdateHashMeter(int nThread, double dThreadHashesPerSec)
+{
+    LOCK(cs_hashmeter);
+    if (nThread >= (int)vThreadHashMeters.size())
+        return;
+    int64_t nNow = GetTimeMillis();
+    vThreadHashMeters[nThread].dHashesPerSec = dThreadHashesPerSec;
+    vThreadHashMeters[nThread].nUpdateTime = nNow;
+
+    double dTotal = 0.0;
+    BOOST_FOREACH(const CThreadHashMeter& meter, vThreadHashMeters)
+        if (nNow - meter.nUpdateTime <= 8000)
+            dTotal += meter.dHashesPerSec;
+    dHashesPerSec = dTotal;
+    nHPSTimerStart = nNow;
+
+    static int64_t nLogTime;
+    if (GetTime() - nLogTime > 30 * 60)
+    {
+        nLogTime = GetTime();
+        LogPrintf("hashmeter %6.0f khash/s\n", dHashesPerSec/1000.0);
+    }
+}
+
+std::vector<double> GetThreadHashesPerSec()
+{
+    LOCK(cs_hashmeter);
+    std::vector<double> vRates;
+    int64_t nNow = GetTimeMillis();
+    BOOST_FOREACH(const CThreadHashMeter& meter, vThreadHashMeters)
+        vRates.push_back(nNow - meter.nUpdateTime <= 8000 ? meter.dHashesPerSec : 0.0);
+    return vRates;
+}
+
+// ScanHash tries up to nMaxHashes nonces on the header in place, hashing on the
+// calling thread with its preallocated Argon2d memory. Returns true with
+// pblock->nNonce and phash set when a hash meets the target; otherwise the
+// nonce is left after the last one tried. nHashesDone counts the hashes computed.
+static bool ScanHash(CBlockHeader* pblock, const arith_uint256& hashTarget, unsigned int nMaxHashes, uint256* phash, unsigned int& nHashesDone)
+{
+    nHashesDone = 0;
+    while (nHashesDone < nMaxHashes) {
+        *phash = hash_Argon2d_Mining(UVOIDBEGIN(pblock->nVersion), 1);
+        nHashesDone++;
+        if (UintToArith256(*phash) <= hashTarget)
+            return true;
+        pblock->nNonce += 1;
+        if ((pblock->nNonce & 0xFF) == 0)
+            break;
+    }
+    return false;
+}
 
 static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams)
 {
@@ -508,7 +707,7 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     }
 
     // Inform about the new block
-    GetMainSignals().BlockFound(pblock->GetHash());
+    QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().BlockFound), pblock->GetHash()));
 
     // Process this block the same as if we had received it from another node
     CValidationState state;
@@ -519,13 +718,15 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
 }
 
 // ***TODO*** that part changed in bitcoin, we are using a mix with old one here for now
-void static DynamicMiner(const CChainParams& chainparams)
+void static DynamicMiner(const CChainParams& chainparams, int nThread)
 {
     LogPrintf("DynamicMiner -- started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("dynamic-miner");
 
     unsigned int nExtraNonce = 0;
+    int64_t nHashMeterStart = GetTimeMillis();
+    uint64_t nHashCounter = 0;
 
     boost::shared_ptr<CReserveScript> coinbaseScript;
     GetMainSignals().ScriptForMining(coinbaseScript);
@@ -582,64 +783,34 @@ void static DynamicMiner(const CChainParams& chainparams)
             while (true)
             {
                 unsigned int nHashesDone = 0;
-
-                uint256 hash;
-                while (true)
+                if (ScanHash(pblock, hashTarget, 0x100, &hash, nHashesDone))
                 {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        //pblock->nNonce = nNonce;
-                        //assert(hash == pblock->GetHash());
+                    // Found a solution
+                    assert(hash == pblock->GetHash());
 
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("DynamicMiner:\n");
-                        LogPrintf("proof-of-work found  \n  hash: %s  \ntarget: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
+                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                    LogPrintf("DynamicMiner:\n");
+                    LogPrintf("proof-of-work found  \n  hash: %s  \ntarget: %s\n", hash.GetHex(), hashTarget.GetHex());
+                    ProcessBlockFound(pblock, chainparams);
+                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                    coinbaseScript->KeepScript();
 
-                        // In regression test mode, stop mining after a block is found.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                    // In regression test mode, stop mining after a block is found.
+                    if (chainparams.MineBlocksOnDemand())
+                        throw boost::thread_interrupted();
 
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if ((pblock->nNonce & 0xFF) == 0)
-                        break;
+                    break;
                 }
 
-                // Meter hashes/sec
-                static int64_t nHashCounter;
-                if (nHPSTimerStart == 0)
+                // Meter hashes/sec, per thread so the threads don't contend on it
+                nHashCounter += nHashesDone;
+                int64_t nElapsed = GetTimeMillis() - nHashMeterStart;
+                if (nElapsed > 4000)
                 {
-                    nHPSTimerStart = GetTimeMillis();
+                    UpdateHashMeter(nThread, 1000.0 * nHashCounter / nElapsed);
+                    nHashMeterStart = GetTimeMillis();
                     nHashCounter = 0;
                 }
-                else
-                    nHashCounter += nHashesDone;
-                if (GetTimeMillis() - nHPSTimerStart > 4000)
-                {
-                    static CCriticalSection cs;
-                    {
-                        LOCK(cs);
-                        if (GetTimeMillis() - nHPSTimerStart > 4000)
-                        {
-                            dHashesPerSec = 1000.0 * nHashCounter / (GetTimeMillis() - nHPSTimerStart);
-                            nHPSTimerStart = GetTimeMillis();
-                            nHashCounter = 0;
-                            static int64_t nLogTime;
-                            if (GetTime() - nLogTime > 30 * 60)
-                            {
-                                nLogTime = GetTime();
-                                LogPrintf("hashmeter %6.0f khash/s\n", dHashesPerSec/1000.0);
-                            }
-                        }
-                    }
-                }
 
                 // Check for stop or if block needs to be rebuilt
                 boost::this_thread::interruption_point();
@@ -691,10 +862,17 @@ void GenerateDynamics(bool fGenerate, int nThreads, const CChainParams& chainpar
         minerThreads = NULL;
     }
 
+    {
+        LOCK(cs_hashmeter);
+        vThreadHashMeters.clear();
+        if (fGenerate)
+            vThreadHashMeters.resize(nThreads, CThreadHashMeter());
+    }
+
     if (nThreads == 0 || !fGenerate)
         return;
 
     minerThreads = new boost::thread_group();
     for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&DynamicMiner, boost::cref(chainparams)));
+        minerThreads->create_thread(boost::bind(&DynamicMiner, boost::cref(chainparams), i));
 }
@@ -24,6 +24,8 @@ static const bool DEFAULT_GENERATE = false;
 static const int DEFAULT_GENERATE_THREADS = 1;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Percentage of a template's fees the mempool has to gain before a long-polling getblocktemplate returns early */
+static const int64_t DEFAULT_LONGPOLL_FEE_INCREASE = 10;
 
 struct CBlockTemplate
 {
@@ -48,6 +50,9 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
+/** Recent hashes per second of each internal miner thread */
+std::vector<double> GetThreadHashesPerSec();
+
 extern double dHashesPerSec;
 extern int64_t nHPSTimerStart;
 
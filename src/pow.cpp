@@ -97,6 +97,52 @@ arith_uint256 GetBlockProof(const CBlockIndex& block)
     return (~bnTarget / (bnTarget + 1)) + 1;
 }
 
+double GetBlockDifficulty(const CBlockIndex& block)
+{
+    int nShift = (block.nBits >> 24) & 0xff;
+
+    double dDiff =
+        (double)0x0000ffff / (double)(block.nBits & 0x00ffffff);
+
+    while (nShift < 29)
+    {
+        dDiff *= 256.0;
+        nShift++;
+    }
+    while (nShift > 29)
+    {
+        dDiff /= 256.0;
+        nShift--;
+    }
+
+    return dDiff;
+}
+
+double GetNetworkHashRate(const CBlockIndex* pindex, int nLookup)
+{
+    if (pindex == NULL || nLookup <= 0)
+        return 0;
+
+    const CBlockIndex* pindex0 = pindex;
+    int64_t minTime = pindex0->GetBlockTime();
+    int64_t maxTime = minTime;
+    for (int i = 0; i < nLookup && pindex0->pprev; i++) {
+        pindex0 = pindex0->pprev;
+        int64_t time = pindex0->GetBlockTime();
+        minTime = std::min(time, minTime);
+        maxTime = std::max(time, maxTime);
+    }
+
+    // In case there's a situation where minTime == maxTime, we don't want a divide by zero exception.
+    if (minTime == maxTime)
+        return 0;
+
+    arith_uint256 workDiff = pindex->nChainWork - pindex0->nChainWork;
+    int64_t timeDiff = maxTime - minTime;
+
+    return workDiff.getdouble() / timeDiff;
+}
+
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params& params)
 {
     arith_uint256 r;
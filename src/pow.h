@@ -24,6 +24,10 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&);
 arith_uint256 GetBlockProof(const CBlockIndex& block);
+/** Proof-of-work difficulty of a block as a multiple of the minimum difficulty */
+double GetBlockDifficulty(const CBlockIndex& block);
+/** Average hashes per second that went into the nLookup blocks ending at pindex */
+double GetNetworkHashRate(const CBlockIndex* pindex, int nLookup);
 
 /** Return the time it would take to redo the work difference between from and to, assuming the current hashrate corresponds to the difficulty at tip, in seconds. */
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
@@ -8,6 +8,7 @@
 #include "consensus/validation.h"
 #include "privatesend.h"
 #include "init.h"
+#include "scheduler.h"
 #include "instantsend.h"
 #include "dynode-payments.h"
 #include "dynode-sync.h"
@@ -342,6 +343,9 @@ void CPrivatesendPool::ProcessMessage(CNode* pfrom, std::string& strCommand, CDa
         int nTxInIndex = 0;
         int nTxInsCount = (int)vecTxIn.size();
 
+        // verify all signatures of the message at once, AddScriptSig then uses the outcomes
+        CheckScriptSigs(vecTxIn);
+
         BOOST_FOREACH(const CTxIn txin, vecTxIn) {
             nTxInIndex++;
             if(!AddScriptSig(txin)) {
@@ -470,6 +474,7 @@ void CPrivatesendPool::SetNull()
     nSessionID = 0;
     nSessionDenom = 0;
     vecEntries.clear();
+    mapScriptSigChecks.clear();
     finalMutableTransaction.vin.clear();
     finalMutableTransaction.vout.clear();
     nTimeLastSuccessfulStep = GetTimeMillis();
@@ -842,55 +847,117 @@ void CPrivatesendPool::CheckForCompleteQueue()
     }
 }
 
-// Check to make sure a given input matches an input in the pool and its scriptSig is valid
-bool CPrivatesendPool::IsInputScriptSigValid(const CTxIn& txin)
+void CPrivatesendPool::GetEntriesTransaction(CMutableTransaction& txRet, std::map<COutPoint, std::pair<int, CScript> >& mapInputsRet)
 {
-    CMutableTransaction txNew;
-    txNew.vin.clear();
-    txNew.vout.clear();
-
-    int i = 0;
-    int nTxInIndex = -1;
-    CScript sigPubKey = CScript();
+    txRet.vin.clear();
+    txRet.vout.clear();
+    mapInputsRet.clear();
 
-    BOOST_FOREACH(CPrivateSendEntry& entry, vecEntries) {
+    BOOST_FOREACH(const CPrivateSendEntry& entry, vecEntries) {
 
         BOOST_FOREACH(const CTxSSOut& txssout, entry.vecTxSSOut)
-            txNew.vout.push_back(txssout);
+            txRet.vout.push_back(txssout);
 
         BOOST_FOREACH(const CTxSSIn& txssin, entry.vecTxSSIn) {
-            txNew.vin.push_back(txssin);
-
-            if(txssin.prevout == txin.prevout) {
-                nTxInIndex = i;
-                sigPubKey = txssin.prevPubKey;
-            }
-            i++;
+            // the last one wins, like the lookup this replaced
+            mapInputsRet[txssin.prevout] = std::make_pair((int)txRet.vin.size(), txssin.prevPubKey);
+            txRet.vin.push_back(txssin);
         }
     }
+}
+
+// Check to make sure a given input matches an input in the pool and its scriptSig is valid
+bool CPrivatesendPool::IsInputScriptSigValid(const CTxIn& txin)
+{
+    std::pair<COutPoint, uint256> key = std::make_pair(txin.prevout, Hash(txin.scriptSig.begin(), txin.scriptSig.end()));
+    std::map<std::pair<COutPoint, uint256>, bool>::const_iterator it = mapScriptSigChecks.find(key);
+    if(it != mapScriptSigChecks.end()) {
+        LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- already checked input and scriptSig, valid: %d\n", it->second);
+        return it->second;
+    }
 
-    if(nTxInIndex >= 0) { //might have to do this one input at a time?
-        txNew.vin[nTxInIndex].scriptSig = txin.scriptSig;
-        LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0,24));
-        if(!VerifyScript(txNew.vin[nTxInIndex].scriptSig, sigPubKey, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, MutableTransactionSignatureChecker(&txNew, nTxInIndex))) {
-            LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
-            return false;
-        }
-    } else {
+    CMutableTransaction txNew;
+    std::map<COutPoint, std::pair<int, CScript> > mapInputs;
+    GetEntriesTransaction(txNew, mapInputs);
+
+    std::map<COutPoint, std::pair<int, CScript> >::const_iterator mi = mapInputs.find(txin.prevout);
+    if(mi == mapInputs.end()) {
         LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- Failed to find matching input in pool, %s\n", txin.ToString());
         return false;
     }
 
+    int nTxInIndex = mi->second.first;
+    txNew.vin[nTxInIndex].scriptSig = txin.scriptSig;
+    LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0,24));
+    bool fValid = VerifyScript(txNew.vin[nTxInIndex].scriptSig, mi->second.second, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, MutableTransactionSignatureChecker(&txNew, nTxInIndex));
+    mapScriptSigChecks[key] = fValid;
+    if(!fValid) {
+        LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
+        return false;
+    }
+
     LogPrint("privatesend", "CPrivatesendPool::IsInputScriptSigValid -- Successfully validated input and scriptSig\n");
     return true;
 }
 
+void CPrivatesendPool::CheckScriptSigs(const std::vector<CTxIn>& vecTxIn)
+{
+    CMutableTransaction txNew;
+    std::map<COutPoint, std::pair<int, CScript> > mapInputs;
+    GetEntriesTransaction(txNew, mapInputs);
+
+    // Only the signed input matters for the signature hash, so all of them go into one
+    // transaction. An input signed twice in the message is left to IsInputScriptSigValid.
+    std::vector<std::pair<COutPoint, uint256> > vecKeys;
+    std::vector<std::pair<int, CScript> > vecInputs;
+    std::set<COutPoint> setSeen;
+    BOOST_FOREACH(const CTxIn& txin, vecTxIn) {
+        std::pair<COutPoint, uint256> key = std::make_pair(txin.prevout, Hash(txin.scriptSig.begin(), txin.scriptSig.end()));
+        if(mapScriptSigChecks.count(key) || !setSeen.insert(txin.prevout).second) continue;
+        std::map<COutPoint, std::pair<int, CScript> >::const_iterator mi = mapInputs.find(txin.prevout);
+        if(mi == mapInputs.end()) continue;
+        txNew.vin[mi->second.first].scriptSig = txin.scriptSig;
+        vecKeys.push_back(key);
+        vecInputs.push_back(mi->second);
+    }
+
+    // on the script check threads, which are idle while no block is being connected
+    const CTransaction txCheck(txNew);
+    std::vector<CScriptCheck> vChecks;
+    for(unsigned int i = 0; i < vecInputs.size(); i++)
+        vChecks.push_back(CScriptCheck(vecInputs[i].second, txCheck, vecInputs[i].first, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, false));
+    std::vector<char> vfValid;
+    RunScriptChecks(vChecks, vfValid);
+
+    for(unsigned int i = 0; i < vecKeys.size(); i++)
+        mapScriptSigChecks[vecKeys[i]] = vfValid[i];
+    LogPrint("privatesend", "CPrivatesendPool::CheckScriptSigs -- checked %d of %d inputs\n", vecKeys.size(), vecTxIn.size());
+}
+
 // check to make sure the collateral provided by the client is valid
 bool CPrivatesendPool::IsCollateralValid(const CTransaction& txCollateral)
 {
     if(txCollateral.vout.empty()) return false;
     if(txCollateral.nLockTime != 0) return false;
 
+    // A client sends its collateral with PSACCEPT and again with its entry, a recent pass
+    // is good enough for the second time. ChargeFees still finds out if it got spent since.
+    uint256 hashCollateral = txCollateral.GetHash();
+    if(fDyNode) {
+        int64_t nNow = GetTime();
+        std::map<uint256, int64_t>::iterator it = mapValidCollaterals.begin();
+        while(it != mapValidCollaterals.end()) {
+            if(nNow - it->second > PRIVATESEND_QUEUE_TIMEOUT)
+                mapValidCollaterals.erase(it++);
+            else
+                ++it;
+        }
+        if(mapValidCollaterals.count(hashCollateral)) {
+            LogPrint("privatesend", "CPrivatesendPool::IsCollateralValid -- recently validated, txCollateral=%s", txCollateral.ToString());
+            return true;
+        }
+    }
+
     CAmount nValueIn = 0;
     CAmount nValueOut = 0;
     bool fMissingTx = false;
@@ -937,6 +1004,9 @@ bool CPrivatesendPool::IsCollateralValid(const CTransaction& txCollateral)
         }
     }
 
+    if(fDyNode)
+        mapValidCollaterals[hashCollateral] = GetTime();
+
     return true;
 }
 
@@ -982,6 +1052,8 @@ bool CPrivatesendPool::AddEntry(const CPrivateSendEntry& entryNew, PoolMessage&
     }
 
     vecEntries.push_back(entryNew);
+    // the transaction scriptSigs are checked against has changed
+    mapScriptSigChecks.clear();
 
     LogPrint("privatesend", "CPrivatesendPool::AddEntry -- adding entry\n");
     nMessageIDRet = MSG_ENTRIES_ADDED;
@@ -2440,63 +2512,143 @@ void CPrivatesendPool::SetState(PoolState nStateNew)
     nState = nStateNew;
 }
 
-void CPrivatesendPool::UpdatedBlockTip(const CBlockIndex *pindex)
+namespace {
+
+CScheduler* pmaintenanceScheduler = NULL;
+// Jobs that walk the whole dynode list or payment votes under cs_main run
+// on their own thread, so they don't hold up the shared scheduler
+CScheduler maintenanceWorker;
+bool fMaintenanceWorkerStarted = false;
+CCriticalSection cs_maintenance;
+bool fBlockMaintenanceQueued = false;
+
+bool IsMaintenanceReady()
 {
-    pCurrentBlockIndex = pindex;
-    LogPrint("privatesend", "CPrivatesendPool::UpdatedBlockTip -- pCurrentBlockIndex->nHeight: %d\n", pCurrentBlockIndex->nHeight);
+    return dynodeSync.IsBlockchainSynced() && !ShutdownRequested();
+}
 
-    if(!fLiteMode && dynodeSync.IsDynodeListSynced()) {
-        NewBlock();
-    }
+void ProcessDynodeSyncTick()
+{
+    // try to sync from all available nodes, one step at a time
+    dynodeSync.ProcessTick();
 }
 
-//TODO: Rename/move to core
-void ThreadCheckPrivateSendPool()
+void ManageActiveDynode()
 {
-    if(fLiteMode) return; // disable all Dynamic specific functionality
+    static int64_t nTimeLastManageState = 0;
+
+    if(!IsMaintenanceReady()) return;
+
+    // check if we should activate or ping every few minutes,
+    // start right after sync is considered to be done
+    if(GetTime() - nTimeLastManageState < DYNODE_MIN_DNP_SECONDS) return;
+    nTimeLastManageState = GetTime();
+
+    activeDynode.ManageState();
+}
+
+void CheckDynodes()
+{
+    if(!IsMaintenanceReady()) return;
+    dnodeman.Check();
+}
 
-    static bool fOneThread;
-    if(fOneThread) return;
-    fOneThread = true;
+void CheckAndRemoveDynodes()
+{
+    if(!IsMaintenanceReady()) return;
+    dnodeman.CheckAndRemove();
+    dnodeman.ProcessDynodeConnections();
+}
 
-    // Make this thread recognisable as the PrivateSend thread
-    RenameThread("dynamic-privatesend");
+void CleanInstantSend()
+{
+    if(!IsMaintenanceReady()) return;
+    // lock candidates expire by height, but orphan votes expire by time
+    CleanTxLockCandidates();
+}
 
-    unsigned int nTick = 0;
-    unsigned int nDoAutoNextRun = nTick + PRIVATESEND_AUTO_TIMEOUT_MIN;
+void CheckPrivateSendPool()
+{
+    if(!IsMaintenanceReady()) return;
+    privateSendPool.CheckTimeout();
+    privateSendPool.CheckForCompleteQueue();
+}
 
-    while (true)
+void DoAutomaticDenominating()
+{
+    if(!IsMaintenanceReady()) return;
+    privateSendPool.DoAutomaticDenominating();
+}
+
+// Expiry of payment votes only depends on the chain height,
+// so this runs once per new tip instead of on a timer
+void ProcessBlockMaintenance()
+{
     {
-        MilliSleep(1000);
+        LOCK(cs_maintenance);
+        fBlockMaintenanceQueued = false;
+    }
 
-        // try to sync from all available nodes, one step at a time
-        dynodeSync.ProcessTick();
+    if(!IsMaintenanceReady()) return;
+    dnpayments.CheckAndRemove();
+}
 
-        if(dynodeSync.IsBlockchainSynced() && !ShutdownRequested()) {
+void TriggerBlockMaintenance()
+{
+    LOCK(cs_maintenance);
+    // a burst of blocks (e.g. while catching up) only needs one run
+    if(!fMaintenanceWorkerStarted || fBlockMaintenanceQueued) return;
+    fBlockMaintenanceQueued = true;
+    maintenanceWorker.scheduleFromNow(&ProcessBlockMaintenance, 0, "blockmaintenance");
+}
 
-            nTick++;
+} // anon namespace
 
-            // check if we should activate or ping every few minutes,
-            // start right after sync is considered to be done
-            if(nTick % DYNODE_MIN_DNP_SECONDS == 1)
-                activeDynode.ManageState();
+void CPrivatesendPool::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    pCurrentBlockIndex = pindex;
+    LogPrint("privatesend", "CPrivatesendPool::UpdatedBlockTip -- pCurrentBlockIndex->nHeight: %d\n", pCurrentBlockIndex->nHeight);
 
-            dnodeman.Check();
+    if(!fLiteMode && dynodeSync.IsDynodeListSynced()) {
+        NewBlock();
+    }
 
-            if(nTick % 60 == 0) {
-                dnodeman.CheckAndRemove();
-                dnodeman.ProcessDynodeConnections();
-                dnpayments.CheckAndRemove();
-                CleanTxLockCandidates();
-            }
+    TriggerBlockMaintenance();
+}
 
-            privateSendPool.CheckTimeout();
-            privateSendPool.CheckForCompleteQueue();
+void SchedulePrivateSendMaintenance(boost::thread_group& threadGroup, CScheduler& scheduler)
+{
+    if(fLiteMode) return; // disable all Dynamic specific functionality
 
-            if(nDoAutoNextRun == nTick) {
-                privateSendPool.DoAutomaticDenominating();
-                nDoAutoNextRun = nTick + PRIVATESEND_AUTO_TIMEOUT_MIN + GetRandInt(PRIVATESEND_AUTO_TIMEOUT_MAX - PRIVATESEND_AUTO_TIMEOUT_MIN);
-            }
-        }
+    // quick per-second steps stay on the shared scheduler
+    scheduler.scheduleEvery(&ProcessDynodeSyncTick, 1, "dynodesync");
+    scheduler.scheduleEvery(&ManageActiveDynode, 1, "activedynode");
+    scheduler.scheduleEvery(&CheckPrivateSendPool, 1, "privatesendpool");
+
+    // the managers lock their own state, so these can run next to the
+    // jobs above the same way they run next to the message handlers
+    CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &maintenanceWorker);
+    threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "dnmaint", serviceLoop));
+    maintenanceWorker.scheduleEvery(&CheckDynodes, DYNODE_CHECK_SECONDS, "dynodecheck");
+    maintenanceWorker.scheduleEvery(&CheckAndRemoveDynodes, 60, "dynodelist", 5);
+    maintenanceWorker.scheduleEvery(&CleanInstantSend, 60, "instantsend");
+    maintenanceWorker.scheduleEvery(&DoAutomaticDenominating, PRIVATESEND_AUTO_TIMEOUT_MIN, "privatesendauto",
+                                    PRIVATESEND_AUTO_TIMEOUT_MAX - PRIVATESEND_AUTO_TIMEOUT_MIN);
+
+    {
+        LOCK(cs_maintenance);
+        pmaintenanceScheduler = &scheduler;
+        fMaintenanceWorkerStarted = true;
     }
+    TriggerBlockMaintenance();
+}
+
+void GetMaintenanceTaskStats(std::map<std::string, CScheduler::TaskStats>& mapSchedulerRet,
+                             std::map<std::string, CScheduler::TaskStats>& mapWorkerRet)
+{
+    LOCK(cs_maintenance);
+    mapSchedulerRet.clear();
+    if(pmaintenanceScheduler)
+        mapSchedulerRet = pmaintenanceScheduler->getTaskStats();
+    mapWorkerRet = maintenanceWorker.getTaskStats();
 }
@@ -7,6 +7,7 @@
 #define DYNAMIC_PRIVATESEND_H
 
 #include "dynode.h"
+#include "scheduler.h"
 #include "wallet/wallet.h"
 
 class CPrivatesendPool;
@@ -335,6 +336,11 @@ private:
     CMutableTransaction txMyCollateral; // client side collateral
     CMutableTransaction finalMutableTransaction; // the finalized transaction ready for signing
 
+    // Outcome of scriptSig checks against the current entries, by input and hash of the scriptSig
+    std::map<std::pair<COutPoint, uint256>, bool> mapScriptSigChecks;
+    // Collaterals that passed IsCollateralValid on this Dynode and when, PSACCEPT and PSVIN carry the same one
+    std::map<uint256, int64_t> mapValidCollaterals;
+
     /// Add a clients entry to the pool
     bool AddEntry(const CPrivateSendEntry& entryNew, PoolMessage& nMessageIDRet);
     /// Add signature to a txin
@@ -374,6 +380,10 @@ private:
     bool IsSignaturesComplete();
     /// Check to make sure a given input matches an input in the pool and its scriptSig is valid
     bool IsInputScriptSigValid(const CTxIn& txin);
+    /// Verify a batch of signed inputs in parallel, IsInputScriptSigValid then finds them checked
+    void CheckScriptSigs(const std::vector<CTxIn>& vecTxIn);
+    /// The transaction made of all entries that scriptSigs are verified against, and where each input is in it
+    void GetEntriesTransaction(CMutableTransaction& txRet, std::map<COutPoint, std::pair<int, CScript> >& mapInputsRet);
     /// Are these outputs compatible with other client in the pool?
     bool IsOutputsCompatibleWithSessionDenom(const std::vector<CTxSSOut>& vecTxSSOut);
 
@@ -479,6 +489,11 @@ public:
     void UpdatedBlockTip(const CBlockIndex *pindex);
 };
 
-void ThreadCheckPrivateSendPool();
+// register the periodic and per-block Dynode and PrivateSend jobs on the scheduler
+// and on a maintenance thread of their own for the heavy ones
+void SchedulePrivateSendMaintenance(boost::thread_group& threadGroup, CScheduler& scheduler);
+// runtimes of the named tasks of the shared scheduler and of the maintenance thread
+void GetMaintenanceTaskStats(std::map<std::string, CScheduler::TaskStats>& mapSchedulerRet,
+                             std::map<std::string, CScheduler::TaskStats>& mapWorkerRet);
 
 #endif // DYNAMIC_PRIVATESEND_H
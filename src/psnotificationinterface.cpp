@@ -26,3 +26,8 @@ void CPSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
     governance.UpdatedBlockTip(pindex);
     dynodeSync.UpdatedBlockTip(pindex);
 }
+
+void CPSNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    dnodeman.SyncTransaction(tx, pblock);
+}
@@ -18,6 +18,7 @@ public:
 protected:
     // CValidationInterface
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
 
 private:
 };
@@ -0,0 +1,156 @@
+// Copyright (c) 2009-2017 Satoshi Nakamoto
+// Copyright (c) 2009-2017 The Bitcoin Developers
+// Copyright (c) 2014-2017 The Dash Core Developers
+// Copyright (c) 2016-2017 Duality Blockchain Solutions Ltd
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "responsecache.h"
+
+#include "chain.h"
+#include "main.h"
+
+#include <boost/thread/shared_mutex.hpp>
+
+CResponseCache responseCache;
+
+/** Rough memory footprint of a reply */
+static size_t EstimateSize(const UniValue& value)
+{
+    size_t nSize = sizeof(UniValue) + value.getValStr().size();
+    if (value.isObject()) {
+        const std::vector<std::string>& keys = value.getKeys();
+        for (unsigned int i = 0; i < keys.size(); i++)
+            nSize += sizeof(std::string) + keys[i].size();
+    }
+    if (value.isObject() || value.isArray()) {
+        const std::vector<UniValue>& values = value.getValues();
+        for (unsigned int i = 0; i < values.size(); i++)
+            nSize += EstimateSize(values[i]);
+    }
+    return nSize;
+}
+
+/** Copy of a cached object with its place in the active chain brought up to date */
+static UniValue RefreshChainPosition(const UniValue& cached, int nConfirmations, const CBlockIndex* pindexNext)
+{
+    if (!cached.isObject() || !cached.exists("confirmations"))
+        return cached;
+
+    UniValue result(UniValue::VOBJ);
+    result.reserve(cached.size());
+    const std::vector<std::string>& keys = cached.getKeys();
+    const std::vector<UniValue>& values = cached.getValues();
+    bool fHadNext = false;
+    for (unsigned int i = 0; i < keys.size(); i++) {
+        if (keys[i] == "confirmations")
+            result.push_back(Pair("confirmations", nConfirmations));
+        else if (keys[i] == "nextblockhash")
+            fHadNext = true;
+        else
+            result.push_back(Pair(keys[i], values[i]));
+    }
+    if (fHadNext && pindexNext)
+        result.push_back(Pair("nextblockhash", pindexNext->GetBlockHash().GetHex()));
+    return result;
+}
+
+CResponseCache::CResponseCache() : nBytes(0), nMaxBytes(DEFAULT_RPC_CACHE_SIZE << 20), nHits(0), nMisses(0)
+{
+}
+
+void CResponseCache::EraseEntry(list_t::iterator it)
+{
+    nBytes -= it->nBytes;
+    mapEntries.erase(it->strKey);
+    listEntries.erase(it);
+}
+
+void CResponseCache::SetMaxSize(size_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    while (nBytes > nMaxBytes && !listEntries.empty())
+        EraseEntry(--listEntries.end());
+}
+
+void CResponseCache::Clear()
+{
+    LOCK(cs);
+    mapEntries.clear();
+    listEntries.clear();
+    nBytes = 0;
+}
+
+bool CResponseCache::Get(const std::string& strKey, UniValue& valueRet)
+{
+    // cs_chainstate before cs, as in Put
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+    LOCK(cs);
+    std::map<std::string, list_t::iterator>::iterator mi = mapEntries.find(strKey);
+    if (mi == mapEntries.end()) {
+        nMisses++;
+        return false;
+    }
+    const CacheEntry& entry = *mi->second;
+    const CBlockIndex* pindex = chainActive[entry.nHeight];
+    if (!pindex || pindex->GetBlockHash() != entry.hashBlock) {
+        // Reorganized away, the entry may describe data that no longer is in the chain
+        EraseEntry(mi->second);
+        nMisses++;
+        return false;
+    }
+    listEntries.splice(listEntries.begin(), listEntries, mi->second);
+    valueRet = RefreshChainPosition(entry.value, chainActive.Height() - entry.nHeight + 1, chainActive.Next(pindex));
+    nHits++;
+    return true;
+}
+
+void CResponseCache::Put(const std::string& strKey, const UniValue& value, const uint256& hashBlock)
+{
+    int nHeight;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second))
+            return;
+        nHeight = mi->second->nHeight;
+        if (chainActive.Height() - nHeight + 1 < RESPONSE_CACHE_MIN_CONFIRMATIONS)
+            return;
+    }
+
+    size_t nEntryBytes = EstimateSize(value) + sizeof(CacheEntry) + 2 * strKey.size();
+
+    LOCK(cs);
+    if (nEntryBytes > nMaxBytes)
+        return;
+    std::map<std::string, list_t::iterator>::iterator mi = mapEntries.find(strKey);
+    if (mi != mapEntries.end())
+        EraseEntry(mi->second);
+    while (nBytes + nEntryBytes > nMaxBytes && !listEntries.empty())
+        EraseEntry(--listEntries.end());
+
+    listEntries.push_front(CacheEntry());
+    CacheEntry& entry = listEntries.front();
+    entry.strKey = strKey;
+    entry.value = value;
+    entry.hashBlock = hashBlock;
+    entry.nHeight = nHeight;
+    entry.nBytes = nEntryBytes;
+    mapEntries[strKey] = listEntries.begin();
+    nBytes += nEntryBytes;
+}
+
+void CResponseCache::GetStats(uint64_t& nHitsRet, uint64_t& nMissesRet, size_t& nEntriesRet, size_t& nBytesRet) const
+{
+    LOCK(cs);
+    nHitsRet = nHits;
+    nMissesRet = nMisses;
+    nEntriesRet = mapEntries.size();
+    nBytesRet = nBytes;
+}
+
+std::string ResponseCacheKey(const std::string& strMethod, const std::string& strParams, const std::string& strFormat)
+{
+    return strMethod + "/" + strParams + "/" + strFormat;
+}
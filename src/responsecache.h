@@ -0,0 +1,75 @@
+// Copyright (c) 2009-2017 Satoshi Nakamoto
+// Copyright (c) 2009-2017 The Bitcoin Developers
+// Copyright (c) 2014-2017 The Dash Core Developers
+// Copyright (c) 2016-2017 Duality Blockchain Solutions Ltd
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DYNAMIC_RESPONSECACHE_H
+#define DYNAMIC_RESPONSECACHE_H
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <univalue.h>
+
+/** Default for -rpccachesize, in megabytes */
+static const unsigned int DEFAULT_RPC_CACHE_SIZE = 32;
+/** Replies about blocks with fewer confirmations than this are not cached */
+static const int RESPONSE_CACHE_MIN_CONFIRMATIONS = 6;
+
+/**
+ * Size-bounded cache of RPC and REST replies about confirmed blocks and
+ * transactions, keyed by method, parameters and format. Every entry remembers
+ * the block it describes and is only served while that block is still in the
+ * active chain, so a reorg below it drops the entry. The confirmations and
+ * nextblockhash members of cached objects are filled in again on every hit.
+ */
+class CResponseCache
+{
+private:
+    struct CacheEntry
+    {
+        std::string strKey;
+        UniValue value;
+        uint256 hashBlock;
+        int nHeight;
+        size_t nBytes;
+    };
+
+    typedef std::list<CacheEntry> list_t;
+
+    mutable CCriticalSection cs;
+    list_t listEntries; //! most recently used first
+    std::map<std::string, list_t::iterator> mapEntries;
+    size_t nBytes;
+    size_t nMaxBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    void EraseEntry(list_t::iterator it);
+
+public:
+    CResponseCache();
+
+    void SetMaxSize(size_t nMaxBytesIn);
+    void Clear();
+
+    /** Look up a reply, valid if the block it describes is still in the active chain */
+    bool Get(const std::string& strKey, UniValue& valueRet);
+    /** Store a reply about the data in block hashBlock, if that block is deep enough in the active chain */
+    void Put(const std::string& strKey, const UniValue& value, const uint256& hashBlock);
+
+    void GetStats(uint64_t& nHitsRet, uint64_t& nMissesRet, size_t& nEntriesRet, size_t& nBytesRet) const;
+};
+
+/** Build a cache key out of a method or path, its parameters and the reply format */
+std::string ResponseCacheKey(const std::string& strMethod, const std::string& strParams, const std::string& strFormat);
+
+extern CResponseCache responseCache;
+
+#endif // DYNAMIC_RESPONSECACHE_H
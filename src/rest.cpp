@@ -5,20 +5,27 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkpoints.h"
+#include "dynodeman.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
 #include "httpserver.h"
+#include "policy/policy.h"
+#include "responsecache.h"
 #include "rpcserver.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
+#include "util.h"
 #include "utilstrencodings.h"
 #include "version.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/dynamic_bitset.hpp>
 
 #include <univalue.h>
@@ -60,12 +67,129 @@ struct CCoin {
     }
 };
 
+/** /rest/chaininfo.bin, the fields of getblockchaininfo up to the soft fork states */
+struct CChainInfo {
+    std::string strChain;
+    int32_t nBlocks;
+    int32_t nHeaders;
+    uint256 hashBestBlock;
+    double dDifficulty;
+    int64_t nMedianTime;
+    double dVerificationProgress;
+    uint256 nChainWork;
+    bool fPruned;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(strChain);
+        READWRITE(nBlocks);
+        READWRITE(nHeaders);
+        READWRITE(hashBestBlock);
+        READWRITE(dDifficulty);
+        READWRITE(nMedianTime);
+        READWRITE(dVerificationProgress);
+        READWRITE(nChainWork);
+        READWRITE(fPruned);
+    }
+};
+
+/** /rest/mempool/info.bin */
+struct CMempoolInfo {
+    uint64_t nSize;
+    uint64_t nBytes;
+    uint64_t nUsage;
+    int64_t nMaxMempool;
+    CAmount nMinFeePerK;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(nSize);
+        READWRITE(nBytes);
+        READWRITE(nUsage);
+        READWRITE(nMaxMempool);
+        READWRITE(nMinFeePerK);
+    }
+};
+
+/** An entry of /rest/mempool/contents.bin, the fields of verbose getrawmempool */
+struct CMempoolEntryInfo {
+    uint256 txid;
+    uint32_t nSize;
+    CAmount nFee;
+    CAmount nModifiedFee;
+    int64_t nTime;
+    uint32_t nHeight;
+    double dStartingPriority;
+    double dCurrentPriority;
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
+    std::vector<uint256> vDepends;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(txid);
+        READWRITE(nSize);
+        READWRITE(nFee);
+        READWRITE(nModifiedFee);
+        READWRITE(nTime);
+        READWRITE(nHeight);
+        READWRITE(dStartingPriority);
+        READWRITE(dCurrentPriority);
+        READWRITE(nCountWithDescendants);
+        READWRITE(nSizeWithDescendants);
+        READWRITE(nModFeesWithDescendants);
+        READWRITE(vDepends);
+    }
+};
+
+/** An entry of /rest/dynodes.bin, the fields of dynodelist full */
+struct CDynodeListEntry {
+    COutPoint outpoint;
+    CService addr;
+    CKeyID payee;
+    int32_t nActiveState;
+    int32_t nProtocolVersion;
+    int64_t nLastSeen;
+    int64_t nActiveSeconds;
+    int64_t nLastPaidTime;
+    int32_t nLastPaidBlock;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(outpoint);
+        READWRITE(addr);
+        READWRITE(payee);
+        READWRITE(nActiveState);
+        READWRITE(nProtocolVersion);
+        READWRITE(nLastSeen);
+        READWRITE(nActiveSeconds);
+        READWRITE(nLastPaidTime);
+        READWRITE(nLastPaidBlock);
+    }
+};
+
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
+extern void mempoolToJSON(CJSONStreamWriter& writer);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
+extern bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
+                       std::pair<CAddressUnspentKey, CAddressUnspentValue> b);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
 {
@@ -74,6 +198,55 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message
     return false;
 }
 
+/** Send val as JSON, large values go out in chunks while they are serialized */
+static void WriteJSONReply(HTTPRequest* req, const UniValue& val)
+{
+    req->WriteHeader("Content-Type", "application/json");
+    CJSONStreamWriter writer(boost::bind(&HTTPRequest::WriteReplyChunk, req, (int)HTTP_OK, _1));
+    writer.Write(val);
+    writer.WriteRaw("\n");
+    req->WriteReply(HTTP_OK, writer.TakeBuffered());
+}
+
+/** Send a reply taken from the response cache, stored as a string for .bin and .hex */
+static void WriteCachedReply(HTTPRequest* req, enum RetFormat rf, const UniValue& val)
+{
+    switch (rf) {
+    case RF_BINARY:
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, val.get_str());
+        break;
+    case RF_HEX:
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, val.get_str());
+        break;
+    default:
+        WriteJSONReply(req, val);
+        break;
+    }
+}
+
+/** Send ss in one of the formats every endpoint shares, false if rf is neither .bin nor .hex */
+static bool WriteSerializedReply(HTTPRequest* req, enum RetFormat rf, const CDataStream& ss)
+{
+    switch (rf) {
+    case RF_BINARY: {
+        string strBinary = ss.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, strBinary);
+        return true;
+    }
+    case RF_HEX: {
+        string strHex = HexStr(ss.begin(), ss.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
 static enum RetFormat ParseDataFormat(std::string& param, const std::string& strReq)
 {
     const std::string::size_type pos = strReq.rfind('.');
@@ -153,7 +326,7 @@ static bool rest_headers(HTTPRequest* req,
     std::vector<const CBlockIndex *> headers;
     headers.reserve(count);
     {
-        LOCK(cs_main);
+        boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
         BlockMap::const_iterator it = mapBlockIndex.find(hash);
         const CBlockIndex *pindex = (it != mapBlockIndex.end()) ? it->second : NULL;
         while (pindex != NULL && chainActive.Contains(pindex)) {
@@ -184,13 +357,20 @@ static bool rest_headers(HTTPRequest* req,
         return true;
     }
     case RF_JSON: {
-        UniValue jsonHeaders(UniValue::VARR);
+        req->WriteHeader("Content-Type", "application/json");
+        CJSONStreamWriter writer(boost::bind(&HTTPRequest::WriteReplyChunk, req, (int)HTTP_OK, _1));
+        writer.BeginArray();
         BOOST_FOREACH(const CBlockIndex *pindex, headers) {
-            jsonHeaders.push_back(blockheaderToJSON(pindex));
+            UniValue objHeader;
+            {
+                boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+                objHeader = blockheaderToJSON(pindex);
+            }
+            writer.Write(objHeader);
         }
-        string strJSON = jsonHeaders.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        writer.EndArray();
+        writer.WriteRaw("\n");
+        req->WriteReply(HTTP_OK, writer.TakeBuffered());
         return true;
     }
     default: {
@@ -215,27 +395,42 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    // Transaction details carry spent outputs, which change while the spent index is kept
+    const bool fCacheable = rf != RF_UNDEF && !(rf == RF_JSON && showTxDetails && fSpentIndex);
+    const std::string strCacheKey = ResponseCacheKey(showTxDetails ? "rest/block" : "rest/block/notxdetails", hash.GetHex(), rf_names[rf].name);
+    UniValue cached;
+    if (fCacheable && responseCache.Get(strCacheKey, cached)) {
+        WriteCachedReply(req, rf, cached);
+        return true;
+    }
+
     CBlock block;
     CBlockIndex* pblockindex = NULL;
+    CDiskBlockPos pos;
     {
-        LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
-        pblockindex = mapBlockIndex[hash];
+        pblockindex = mi->second;
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        pos = pblockindex->GetBlockPos();
     }
 
+    if (!ReadIndexedBlockFromDisk(block, pos, pblockindex->GetBlockHeader()))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+
     CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
     ssBlock << block;
 
     switch (rf) {
     case RF_BINARY: {
         string binaryBlock = ssBlock.str();
+        if (fCacheable)
+            responseCache.Put(strCacheKey, binaryBlock, hash);
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
@@ -243,16 +438,22 @@ static bool rest_block(HTTPRequest* req,
 
     case RF_HEX: {
         string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        if (fCacheable)
+            responseCache.Put(strCacheKey, strHex, hash);
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        UniValue objBlock;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+            objBlock = blockToJSON(block, pblockindex, showTxDetails);
+        }
+        if (fCacheable)
+            responseCache.Put(strCacheKey, objBlock, hash);
+        WriteJSONReply(req, objBlock);
         return true;
     }
 
@@ -283,16 +484,34 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
     const RetFormat rf = ParseDataFormat(param, strURIPart);
 
     switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CChainInfo info;
+        {
+            LOCK(cs_main);
+            info.strChain = Params().NetworkIDString();
+            info.nBlocks = chainActive.Height();
+            info.nHeaders = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+            info.hashBestBlock = chainActive.Tip()->GetBlockHash();
+            CChainTipStats tipStats = GetChainTipStats();
+            info.dDifficulty = tipStats.dDifficulty;
+            info.nMedianTime = tipStats.nMedianTimePast;
+            info.dVerificationProgress = Checkpoints::GuessVerificationProgress(Params().Checkpoints(), chainActive.Tip());
+            info.nChainWork = ArithToUint256(chainActive.Tip()->nChainWork);
+            info.fPruned = fPruneMode;
+        }
+        CDataStream ssInfo(SER_NETWORK, PROTOCOL_VERSION);
+        ssInfo << info;
+        return WriteSerializedReply(req, rf, ssInfo);
+    }
     case RF_JSON: {
         UniValue rpcParams(UniValue::VARR);
         UniValue chainInfoObject = getblockchaininfo(rpcParams, false);
-        string strJSON = chainInfoObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        WriteJSONReply(req, chainInfoObject);
         return true;
     }
     default: {
-        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
     }
     }
 
@@ -308,16 +527,26 @@ static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
     const RetFormat rf = ParseDataFormat(param, strURIPart);
 
     switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CMempoolInfo info;
+        info.nSize = mempool.size();
+        info.nBytes = mempool.GetTotalTxSize();
+        info.nUsage = mempool.DynamicMemoryUsage();
+        info.nMaxMempool = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+        info.nMinFeePerK = mempool.GetMinFee(info.nMaxMempool).GetFeePerK();
+        CDataStream ssInfo(SER_NETWORK, PROTOCOL_VERSION);
+        ssInfo << info;
+        return WriteSerializedReply(req, rf, ssInfo);
+    }
     case RF_JSON: {
         UniValue mempoolInfoObject = mempoolInfoToJSON();
 
-        string strJSON = mempoolInfoObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        WriteJSONReply(req, mempoolInfoObject);
         return true;
     }
     default: {
-        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
     }
     }
 
@@ -333,16 +562,50 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     const RetFormat rf = ParseDataFormat(param, strURIPart);
 
     switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        int nChainHeight;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+            nChainHeight = chainActive.Height();
+        }
+        CDataStream ssEntries(SER_NETWORK, PROTOCOL_VERSION);
+        {
+            LOCK(mempool.cs);
+            WriteCompactSize(ssEntries, mempool.mapTx.size());
+            BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx) {
+                CMempoolEntryInfo info;
+                info.txid = e.GetTx().GetHash();
+                info.nSize = e.GetTxSize();
+                info.nFee = e.GetFee();
+                info.nModifiedFee = e.GetModifiedFee();
+                info.nTime = e.GetTime();
+                info.nHeight = e.GetHeight();
+                info.dStartingPriority = e.GetPriority(e.GetHeight());
+                info.dCurrentPriority = e.GetPriority(nChainHeight);
+                info.nCountWithDescendants = e.GetCountWithDescendants();
+                info.nSizeWithDescendants = e.GetSizeWithDescendants();
+                info.nModFeesWithDescendants = e.GetModFeesWithDescendants();
+                std::set<uint256> setDepends;
+                BOOST_FOREACH(const CTxIn& txin, e.GetTx().vin)
+                    if (mempool.exists(txin.prevout.hash))
+                        setDepends.insert(txin.prevout.hash);
+                info.vDepends.assign(setDepends.begin(), setDepends.end());
+                ssEntries << info;
+            }
+        }
+        return WriteSerializedReply(req, rf, ssEntries);
+    }
     case RF_JSON: {
-        UniValue mempoolObject = mempoolToJSON(true);
-
-        string strJSON = mempoolObject.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        CJSONStreamWriter writer(boost::bind(&HTTPRequest::WriteReplyChunk, req, (int)HTTP_OK, _1));
+        mempoolToJSON(writer);
+        writer.WriteRaw("\n");
+        req->WriteReply(HTTP_OK, writer.TakeBuffered());
         return true;
     }
     default: {
-        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
     }
     }
 
@@ -361,10 +624,21 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    // Spent outputs change the JSON form while the spent index is kept
+    bool fCacheable = rf != RF_UNDEF && !(rf == RF_JSON && fSpentIndex);
+    const std::string strCacheKey = ResponseCacheKey("rest/tx", hash.GetHex(), rf_names[rf].name);
+    UniValue cached;
+    if (fCacheable && responseCache.Get(strCacheKey, cached)) {
+        WriteCachedReply(req, rf, cached);
+        return true;
+    }
+
     CTransaction tx;
     uint256 hashBlock = uint256();
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
         return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+    // Only transactions in a block can go into the cache
+    fCacheable = fCacheable && !hashBlock.IsNull();
 
     CDataStream psTx(SER_NETWORK, PROTOCOL_VERSION);
     psTx << tx;
@@ -372,6 +646,8 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     switch (rf) {
     case RF_BINARY: {
         string binaryTx = psTx.str();
+        if (fCacheable)
+            responseCache.Put(strCacheKey, binaryTx, hashBlock);
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryTx);
         return true;
@@ -379,6 +655,8 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
 
     case RF_HEX: {
         string strHex = HexStr(psTx.begin(), psTx.end()) + "\n";
+        if (fCacheable)
+            responseCache.Put(strCacheKey, strHex, hashBlock);
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
@@ -387,9 +665,9 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     case RF_JSON: {
         UniValue objTx(UniValue::VOBJ);
         TxToJSON(tx, hashBlock, objTx);
-        string strJSON = objTx.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        if (fCacheable)
+            responseCache.Put(strCacheKey, objTx, hashBlock);
+        WriteJSONReply(req, objTx);
         return true;
     }
 
@@ -584,11 +862,108 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
         objGetUTXOResponse.push_back(Pair("utxos", utxos));
 
         // return json string
-        string strJSON = objGetUTXOResponse.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        WriteJSONReply(req, objGetUTXOResponse);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_addressutxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    CDynamicAddress address(param);
+    uint160 hashBytes;
+    int type = 0;
+    if (!address.GetIndexKey(hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + param);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if (!GetAddressUnspent(hashBytes, type, unspentOutputs))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address " + param);
+    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        // the address index records themselves
+        CDataStream ssOutputs(SER_NETWORK, PROTOCOL_VERSION);
+        ssOutputs << unspentOutputs;
+        return WriteSerializedReply(req, rf, ssOutputs);
+    }
+
+    case RF_JSON: {
+        UniValue result(UniValue::VARR);
+        result.reserve(unspentOutputs.size());
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+            UniValue output(UniValue::VOBJ);
+            output.push_back(Pair("address", param));
+            output.push_back(Pair("txid", it->first.txhash.GetHex()));
+            output.push_back(Pair("outputIndex", (int)it->first.index));
+            output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
+            output.push_back(Pair("satoshis", it->second.satoshis));
+            output.push_back(Pair("height", it->second.blockHeight));
+            result.push_back(output);
+        }
+        WriteJSONReply(req, result);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_spentinfo(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    // same outpoint notation as getutxos: <txid>-<n>
+    uint256 txid;
+    int32_t nOutput;
+    std::string strTxid = param.substr(0, param.find("-"));
+    std::string strOutput = param.substr(param.find("-") + 1);
+    if (!ParseHashStr(strTxid, txid) || !ParseInt32(strOutput, &nOutput) || nOutput < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid outpoint: " + param);
+
+    CSpentIndexKey key(txid, nOutput);
+    CSpentIndexValue value;
+    if (!GetSpentIndex(key, value))
+        return RESTERR(req, HTTP_NOT_FOUND, "Unable to get spent info for " + param);
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssValue(SER_NETWORK, PROTOCOL_VERSION);
+        ssValue << value;
+        return WriteSerializedReply(req, rf, ssValue);
+    }
+
+    case RF_JSON: {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("txid", value.txid.GetHex()));
+        obj.push_back(Pair("index", (int)value.inputIndex));
+        obj.push_back(Pair("height", value.blockHeight));
+        WriteJSONReply(req, obj);
         return true;
     }
+
     default: {
         return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
     }
@@ -598,6 +973,99 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_blockhashes(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    vector<string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    int64_t nHigh, nLow;
+    if (path.size() != 2 || !ParseInt64(path[0], &nHigh) || !ParseInt64(path[1], &nLow) ||
+        nHigh < 0 || nHigh > std::numeric_limits<unsigned int>::max() || nLow < 0 || nLow > nHigh)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid time range. Use /rest/blockhashes/<high>/<low>.<ext>.");
+
+    std::vector<uint256> blockHashes;
+    if (!GetTimestampIndex(nHigh, nLow, blockHashes))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for block hashes");
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssHashes(SER_NETWORK, PROTOCOL_VERSION);
+        ssHashes << blockHashes;
+        return WriteSerializedReply(req, rf, ssHashes);
+    }
+
+    case RF_JSON: {
+        UniValue result(UniValue::VARR);
+        result.reserve(blockHashes.size());
+        BOOST_FOREACH(const uint256& hash, blockHashes)
+            result.push_back(hash.GetHex());
+        WriteJSONReply(req, result);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_dynodes(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    if (rf != RF_BINARY && rf != RF_HEX && rf != RF_JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    // Read-only: last paid is as of the last UpdateLastPaid, which Dynodes run every block
+    std::vector<CDynode> vDynodes = dnodeman.GetFullDynodeVector();
+
+    if (rf == RF_JSON) {
+        UniValue result(UniValue::VOBJ);
+        BOOST_FOREACH(CDynode& dn, vDynodes) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("addr", dn.addr.ToString()));
+            obj.push_back(Pair("payee", CDynamicAddress(dn.pubKeyCollateralAddress.GetID()).ToString()));
+            obj.push_back(Pair("status", dn.GetStatus()));
+            obj.push_back(Pair("protocol", dn.nProtocolVersion));
+            obj.push_back(Pair("lastseen", (int64_t)dn.lastPing.sigTime));
+            obj.push_back(Pair("activeseconds", (int64_t)(dn.lastPing.sigTime - dn.sigTime)));
+            obj.push_back(Pair("lastpaidtime", dn.GetLastPaidTime()));
+            obj.push_back(Pair("lastpaidblock", dn.GetLastPaidBlock()));
+            result.push_back(Pair(dn.vin.prevout.ToStringShort(), obj));
+        }
+        WriteJSONReply(req, result);
+        return true;
+    }
+
+    CDataStream ssDynodes(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(ssDynodes, vDynodes.size());
+    BOOST_FOREACH(CDynode& dn, vDynodes) {
+        CDynodeListEntry entry;
+        entry.outpoint = dn.vin.prevout;
+        entry.addr = dn.addr;
+        entry.payee = dn.pubKeyCollateralAddress.GetID();
+        entry.nActiveState = dn.nActiveState;
+        entry.nProtocolVersion = dn.nProtocolVersion;
+        entry.nLastSeen = dn.lastPing.sigTime;
+        entry.nActiveSeconds = dn.lastPing.sigTime - dn.sigTime;
+        entry.nLastPaidTime = dn.GetLastPaidTime();
+        entry.nLastPaidBlock = dn.GetLastPaidBlock();
+        ssDynodes << entry;
+    }
+    return WriteSerializedReply(req, rf, ssDynodes);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -610,6 +1078,10 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/addressutxos/", rest_addressutxos},
+      {"/rest/spentinfo/", rest_spentinfo},
+      {"/rest/blockhashes/", rest_blockhashes},
+      {"/rest/dynodes", rest_dynodes},
 };
 
 bool StartREST()
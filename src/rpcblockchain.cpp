@@ -13,7 +13,9 @@
 #include "consensus/validation.h"
 #include "main.h"
 #include "policy/policy.h"
+#include "pow.h"
 #include "primitives/transaction.h"
+#include "responsecache.h"
 #include "rpcserver.h"
 #include "streams.h"
 #include "sync.h"
@@ -35,30 +37,9 @@ double GetDifficulty(const CBlockIndex* blockindex)
     // Floating point number that is a multiple of the minimum difficulty,
     // minimum difficulty = 1.0.
     if (blockindex == NULL)
-    {
-        if (chainActive.Tip() == NULL)
-            return 1.0;
-        else
-            blockindex = chainActive.Tip();
-    }
-
-    int nShift = (blockindex->nBits >> 24) & 0xff;
-
-    double dDiff =
-        (double)0x0000ffff / (double)(blockindex->nBits & 0x00ffffff);
-
-    while (nShift < 29)
-    {
-        dDiff *= 256.0;
-        nShift++;
-    }
-    while (nShift > 29)
-    {
-        dDiff /= 256.0;
-        nShift--;
-    }
+        return GetChainTipStats().dDifficulty;
 
-    return dDiff;
+    return GetBlockDifficulty(*blockindex);
 }
 
 UniValue blockheaderToJSON(const CBlockIndex* blockindex)
@@ -91,7 +72,8 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
 {
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", block.GetHash().GetHex()));
+    // The block was read for this index entry, so don't rehash it (callers may hold cs_chainstate)
+    result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex))
@@ -102,6 +84,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
     UniValue txs(UniValue::VARR);
+    txs.reserve(block.vtx.size());
     BOOST_FOREACH(const CTransaction&tx, block.vtx)
     {
         if(txDetails)
@@ -142,7 +125,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
     return chainActive.Height();
 }
 
@@ -159,7 +142,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
     return chainActive.Tip()->GetBlockHash().GetHex();
 }
 
@@ -176,47 +159,58 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getdifficulty", "")
         );
 
-    LOCK(cs_main);
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
     return GetDifficulty();
 }
 
+static UniValue mempoolEntryToJSON(const CTxMemPoolEntry& e, int nChainHeight)
+{
+    AssertLockHeld(mempool.cs);
+    UniValue info(UniValue::VOBJ);
+    info.push_back(Pair("size", (int)e.GetTxSize()));
+    info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
+    info.push_back(Pair("modifiedfee", ValueFromAmount(e.GetModifiedFee())));
+    info.push_back(Pair("time", e.GetTime()));
+    info.push_back(Pair("height", (int)e.GetHeight()));
+    info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
+    info.push_back(Pair("currentpriority", e.GetPriority(nChainHeight)));
+    info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
+    info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
+    info.push_back(Pair("descendantfees", e.GetModFeesWithDescendants()));
+    const CTransaction& tx = e.GetTx();
+    set<string> setDepends;
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        if (mempool.exists(txin.prevout.hash))
+            setDepends.insert(txin.prevout.hash.ToString());
+    }
+
+    UniValue depends(UniValue::VARR);
+    BOOST_FOREACH(const string& dep, setDepends)
+    {
+        depends.push_back(dep);
+    }
+
+    info.push_back(Pair("depends", depends));
+    return info;
+}
+
+static int GetChainHeight()
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+    return chainActive.Height();
+}
+
 UniValue mempoolToJSON(bool fVerbose = false)
 {
     if (fVerbose)
     {
+        int nChainHeight = GetChainHeight();
         LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
+        o.reserve(mempool.mapTx.size());
         BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
-        {
-            const uint256& hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
-            info.push_back(Pair("size", (int)e.GetTxSize()));
-            info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
-            info.push_back(Pair("modifiedfee", ValueFromAmount(e.GetModifiedFee())));
-            info.push_back(Pair("time", e.GetTime()));
-            info.push_back(Pair("height", (int)e.GetHeight()));
-            info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
-            info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
-            info.push_back(Pair("descendantfees", e.GetModFeesWithDescendants()));
-            const CTransaction& tx = e.GetTx();
-            set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-            {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
-            }
-
-            UniValue depends(UniValue::VARR);
-            BOOST_FOREACH(const string& dep, setDepends)
-            {
-                depends.push_back(dep);
-            }
-
-            info.push_back(Pair("depends", depends));
-            o.push_back(Pair(hash.ToString(), info));
-        }
+            o.push_back(Pair(e.GetTx().GetHash().ToString(), mempoolEntryToJSON(e, nChainHeight)));
         return o;
     }
     else
@@ -225,6 +219,7 @@ UniValue mempoolToJSON(bool fVerbose = false)
         mempool.queryHashes(vtxid);
 
         UniValue a(UniValue::VARR);
+        a.reserve(vtxid.size());
         BOOST_FOREACH(const uint256& hash, vtxid)
             a.push_back(hash.ToString());
 
@@ -232,6 +227,28 @@ UniValue mempoolToJSON(bool fVerbose = false)
     }
 }
 
+/** Verbose mempoolToJSON, written entry by entry without building the whole object */
+void mempoolToJSON(CJSONStreamWriter& writer)
+{
+    // Take the entries out under mempool.cs, the reply goes out after it was released
+    int nChainHeight = GetChainHeight();
+    std::vector<std::pair<std::string, UniValue> > vEntries;
+    {
+        LOCK(mempool.cs);
+        vEntries.reserve(mempool.mapTx.size());
+        BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+            vEntries.push_back(std::make_pair(e.GetTx().GetHash().ToString(), mempoolEntryToJSON(e, nChainHeight)));
+    }
+
+    writer.BeginObject();
+    for (std::vector<std::pair<std::string, UniValue> >::const_iterator it = vEntries.begin(); it != vEntries.end(); ++it)
+    {
+        writer.WriteKey(it->first);
+        writer.Write(it->second);
+    }
+    writer.EndObject();
+}
+
 UniValue getrawmempool(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -268,8 +285,6 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawmempool", "true")
         );
 
-    LOCK(cs_main);
-
     bool fVerbose = false;
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
@@ -277,6 +292,32 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
     return mempoolToJSON(fVerbose);
 }
 
+/** getrawmempool for the JSON-RPC server, writes the transactions one by one */
+void getrawmempool(const UniValue& params, CJSONStreamWriter& writer)
+{
+    if (params.size() > 1)
+        getrawmempool(params, true); // throws the usage
+
+    bool fVerbose = false;
+    if (params.size() > 0)
+        fVerbose = params[0].get_bool();
+
+    if (fVerbose)
+    {
+        mempoolToJSON(writer);
+    }
+    else
+    {
+        vector<uint256> vtxid;
+        mempool.queryHashes(vtxid);
+
+        writer.BeginArray();
+        BOOST_FOREACH(const uint256& hash, vtxid)
+            writer.Write(UniValue(hash.ToString()));
+        writer.EndArray();
+    }
+}
+
 UniValue getblockhashes(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 2)
@@ -326,7 +367,7 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
 
     int nHeight = params[0].get_int();
     if (nHeight < 0 || nHeight > chainActive.Height())
@@ -369,8 +410,6 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -378,10 +417,13 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+
+    BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+    if (mi == mapBlockIndex.end())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    CBlockIndex* pblockindex = mi->second;
 
     if (!fVerbose)
     {
@@ -436,12 +478,13 @@ UniValue getblockheaders(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheaders", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" 2000")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
-    if (mapBlockIndex.count(hash) == 0)
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+
+    BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+    if (mi == mapBlockIndex.end())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
     int nCount = MAX_HEADERS_RESULTS;
@@ -455,7 +498,7 @@ UniValue getblockheaders(const UniValue& params, bool fHelp)
     if (params.size() > 2)
         fVerbose = params[2].get_bool();
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    CBlockIndex* pblockindex = mi->second;
 
     UniValue arrHeaders(UniValue::VARR);
 
@@ -521,8 +564,6 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -530,27 +571,49 @@ UniValue getblock(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    const std::string strCacheKey = ResponseCacheKey("getblock", hash.GetHex(), fVerbose ? "json" : "hex");
+    UniValue cached;
+    if (responseCache.Get(strCacheKey, cached))
+        return cached;
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    CBlockIndex* pblockindex;
+    CDiskBlockPos pos;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+        pblockindex = mi->second;
+
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        pos = pblockindex->GetBlockPos();
+    }
 
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+    // Read without holding up block connection, the index entry is checked against what was read
+    if(!ReadIndexedBlockFromDisk(block, pos, pblockindex->GetBlockHeader()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
     if (!fVerbose)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+        UniValue strHex(HexStr(ssBlock.begin(), ssBlock.end()));
+        responseCache.Put(strCacheKey, strHex, hash);
         return strHex;
     }
 
-    return blockToJSON(block, pblockindex);
+    UniValue result;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+        result = blockToJSON(block, pblockindex);
+    }
+    responseCache.Put(strCacheKey, result, hash);
+    return result;
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -793,8 +856,9 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("blocks",                (int)chainActive.Height()));
     obj.push_back(Pair("headers",               pindexBestHeader ? pindexBestHeader->nHeight : -1));
     obj.push_back(Pair("bestblockhash",         chainActive.Tip()->GetBlockHash().GetHex()));
-    obj.push_back(Pair("difficulty",            (double)GetDifficulty()));
-    obj.push_back(Pair("mediantime",            (int64_t)chainActive.Tip()->GetMedianTimePast()));
+    CChainTipStats tipStats = GetChainTipStats();
+    obj.push_back(Pair("difficulty",            tipStats.dDifficulty));
+    obj.push_back(Pair("mediantime",            tipStats.nMedianTimePast));
     obj.push_back(Pair("verificationprogress",  Checkpoints::GuessVerificationProgress(Params().Checkpoints(), chainActive.Tip())));
     obj.push_back(Pair("chainwork",             chainActive.Tip()->nChainWork.GetHex()));
     obj.push_back(Pair("pruned",                fPruneMode));
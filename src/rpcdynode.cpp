@@ -88,6 +88,53 @@ UniValue getpoolinfo(const UniValue& params, bool fHelp)
     return obj;
 }
 
+static UniValue MaintenanceTaskStatsToJSON(const std::map<std::string, CScheduler::TaskStats>& mapStats)
+{
+    UniValue obj(UniValue::VOBJ);
+    for (std::map<std::string, CScheduler::TaskStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        const CScheduler::TaskStats& stats = it->second;
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("runs",        stats.nRuns));
+        entry.push_back(Pair("avgtime",     stats.nRuns ? stats.nTotalMicros / stats.nRuns : 0));
+        entry.push_back(Pair("maxtime",     stats.nMaxMicros));
+        entry.push_back(Pair("lasttime",    stats.nLastMicros));
+        obj.push_back(Pair(it->first, entry));
+    }
+    return obj;
+}
+
+UniValue getmaintenanceinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw std::runtime_error(
+            "getmaintenanceinfo\n"
+            "Returns how long the periodic Dynode and PrivateSend jobs take, per job.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"scheduler\": {           (object) Jobs on the shared scheduler thread\n"
+            "    \"name\": {              (string) Job name, e.g. dynodesync\n"
+            "      \"runs\": n,           (numeric) Times the job ran\n"
+            "      \"avgtime\": n,        (numeric) Average runtime in microseconds\n"
+            "      \"maxtime\": n,        (numeric) Longest runtime in microseconds\n"
+            "      \"lasttime\": n        (numeric) Runtime of the last run in microseconds\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"worker\": { ... }        (object) Jobs on the maintenance thread, same fields\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmaintenanceinfo", "")
+            + HelpExampleRpc("getmaintenanceinfo", "")
+        );
+
+    std::map<std::string, CScheduler::TaskStats> mapScheduler;
+    std::map<std::string, CScheduler::TaskStats> mapWorker;
+    GetMaintenanceTaskStats(mapScheduler, mapWorker);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("scheduler", MaintenanceTaskStatsToJSON(mapScheduler)));
+    obj.push_back(Pair("worker",    MaintenanceTaskStatsToJSON(mapWorker)));
+    return obj;
+}
 
 UniValue dynode(const UniValue& params, bool fHelp)
 {
@@ -441,6 +488,61 @@ UniValue dynode(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+/** The dynodelist value of one dynode in a mode other than rank, false if the filter leaves it out */
+static bool DynodeListEntry(CDynode& dn, const std::string& strMode, const std::string& strFilter, UniValue& valueRet)
+{
+    std::string strOutpoint = dn.vin.prevout.ToStringShort();
+    if (strMode == "activeseconds") {
+        if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = (int64_t)(dn.lastPing.sigTime - dn.sigTime);
+    } else if (strMode == "addr") {
+        std::string strAddress = dn.addr.ToString();
+        if (strFilter !="" && strAddress.find(strFilter) == std::string::npos &&
+            strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = strAddress;
+    } else if (strMode == "full") {
+        std::ostringstream streamFull;
+        streamFull << std::setw(15) <<
+                       dn.GetStatus() << " " <<
+                       dn.nProtocolVersion << " " <<
+                       CDynamicAddress(dn.pubKeyCollateralAddress.GetID()).ToString() << " " <<
+                       (int64_t)dn.lastPing.sigTime << " " << std::setw(8) <<
+                       (int64_t)(dn.lastPing.sigTime - dn.sigTime) << " " << std::setw(10) <<
+                       dn.GetLastPaidTime() << " "  << std::setw(6) <<
+                       dn.GetLastPaidBlock() << " " <<
+                       dn.addr.ToString();
+        std::string strFull = streamFull.str();
+        if (strFilter !="" && strFull.find(strFilter) == std::string::npos &&
+            strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = strFull;
+    } else if (strMode == "lastpaidblock") {
+        if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = dn.GetLastPaidBlock();
+    } else if (strMode == "lastpaidtime") {
+        if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = dn.GetLastPaidTime();
+    } else if (strMode == "lastseen") {
+        if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = (int64_t)dn.lastPing.sigTime;
+    } else if (strMode == "payee") {
+        CDynamicAddress address(dn.pubKeyCollateralAddress.GetID());
+        std::string strPayee = address.ToString();
+        if (strFilter !="" && strPayee.find(strFilter) == std::string::npos &&
+            strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = strPayee;
+    } else if (strMode == "protocol") {
+        if (strFilter !="" && strFilter != strprintf("%d", dn.nProtocolVersion) &&
+            strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = (int64_t)dn.nProtocolVersion;
+    } else if (strMode == "status") {
+        std::string strStatus = dn.GetStatus();
+        if (strFilter !="" && strStatus.find(strFilter) == std::string::npos &&
+            strOutpoint.find(strFilter) == std::string::npos) return false;
+        valueRet = strStatus;
+    }
+    return true;
+}
+
 UniValue dynodelist(const UniValue& params, bool fHelp)
 {
     std::string strMode = "status";
@@ -494,60 +596,50 @@ UniValue dynodelist(const UniValue& params, bool fHelp)
     } else {
         std::vector<CDynode> vDynodes = dnodeman.GetFullDynodeVector();
         BOOST_FOREACH(CDynode& dn, vDynodes) {
-            std::string strOutpoint = dn.vin.prevout.ToStringShort();
-            if (strMode == "activeseconds") {
-                if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, (int64_t)(dn.lastPing.sigTime - dn.sigTime)));
-            } else if (strMode == "addr") {
-                std::string strAddress = dn.addr.ToString();
-                if (strFilter !="" && strAddress.find(strFilter) == std::string::npos &&
-                    strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strAddress));
-            } else if (strMode == "full") {
-                std::ostringstream streamFull;
-                streamFull << std::setw(15) <<
-                               dn.GetStatus() << " " <<
-                               dn.nProtocolVersion << " " <<
-                               CDynamicAddress(dn.pubKeyCollateralAddress.GetID()).ToString() << " " <<
-                               (int64_t)dn.lastPing.sigTime << " " << std::setw(8) <<
-                               (int64_t)(dn.lastPing.sigTime - dn.sigTime) << " " << std::setw(10) <<
-                               dn.GetLastPaidTime() << " "  << std::setw(6) <<
-                               dn.GetLastPaidBlock() << " " <<
-                               dn.addr.ToString();
-                std::string strFull = streamFull.str();
-                if (strFilter !="" && strFull.find(strFilter) == std::string::npos &&
-                    strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strFull));
-            } else if (strMode == "lastpaidblock") {
-                if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, dn.GetLastPaidBlock()));
-            } else if (strMode == "lastpaidtime") {
-                if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, dn.GetLastPaidTime()));
-            } else if (strMode == "lastseen") {
-                if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, (int64_t)dn.lastPing.sigTime));
-            } else if (strMode == "payee") {
-                CDynamicAddress address(dn.pubKeyCollateralAddress.GetID());
-                std::string strPayee = address.ToString();
-                if (strFilter !="" && strPayee.find(strFilter) == std::string::npos &&
-                    strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strPayee));
-            } else if (strMode == "protocol") {
-                if (strFilter !="" && strFilter != strprintf("%d", dn.nProtocolVersion) &&
-                    strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, (int64_t)dn.nProtocolVersion));
-            } else if (strMode == "status") {
-                std::string strStatus = dn.GetStatus();
-                if (strFilter !="" && strStatus.find(strFilter) == std::string::npos &&
-                    strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strStatus));
-            }
+            UniValue value;
+            if (DynodeListEntry(dn, strMode, strFilter, value))
+                obj.push_back(Pair(dn.vin.prevout.ToStringShort(), value));
         }
     }
     return obj;
 }
 
+/** dynodelist for the JSON-RPC server, writes the dynodes one by one from a copy of the list */
+void dynodelist(const UniValue& params, CJSONStreamWriter& writer)
+{
+    std::string strMode = "status";
+    std::string strFilter = "";
+
+    if (params.size() >= 1) strMode = params[0].get_str();
+    if (params.size() == 2) strFilter = params[1].get_str();
+
+    if (strMode == "rank") {
+        writer.Write(dynodelist(params, false));
+        return;
+    }
+
+    // throws the usage on anything else it doesn't know either
+    if (strMode != "activeseconds" && strMode != "addr" && strMode != "full" &&
+        strMode != "lastseen" && strMode != "lastpaidtime" && strMode != "lastpaidblock" &&
+        strMode != "protocol" && strMode != "payee" && strMode != "status")
+        dynodelist(params, true);
+
+    if (strMode == "full" || strMode == "lastpaidtime" || strMode == "lastpaidblock") {
+        dnodeman.UpdateLastPaid();
+    }
+
+    std::vector<CDynode> vDynodes = dnodeman.GetFullDynodeVector();
+    writer.BeginObject();
+    BOOST_FOREACH(CDynode& dn, vDynodes) {
+        UniValue value;
+        if (DynodeListEntry(dn, strMode, strFilter, value)) {
+            writer.WriteKey(dn.vin.prevout.ToStringShort());
+            writer.Write(value);
+        }
+    }
+    writer.EndObject();
+}
+
 bool DecodeHexVecDnb(std::vector<CDynodeBroadcast>& vecDnb, std::string strHexDnb) {
 
     if (!IsHex(strHexDnb))
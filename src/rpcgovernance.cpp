@@ -31,6 +31,61 @@
 
 using namespace std;
 
+/** The objects of gobject list or diff, keyed by hash. They are taken out under governance.cs, which is released before the reply is written. */
+static void ListGovernanceObjects(const std::string& strCommand, const std::string& strShow, std::vector<std::pair<std::string, UniValue> >& vObjectsRet)
+{
+    // GET STARTING TIME TO QUERY SYSTEM WITH
+
+    int nStartTime = 0; //list
+    if(strCommand == "diff") nStartTime = governance.GetLastDiffTime();
+
+    // SETUP BLOCK INDEX VARIABLE
+
+    CBlockIndex* pindex = NULL;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Tip();
+    }
+
+    // GET MATCHING GOVERNANCE OBJECTS
+
+    LOCK(governance.cs);
+
+    std::vector<CGovernanceObject*> objs = governance.GetAllNewerThan(nStartTime);
+    governance.UpdateLastDiffTime(GetTime());
+
+    // CREATE RESULTS FOR USER
+
+    BOOST_FOREACH(CGovernanceObject* pGovObj, objs)
+    {
+        // IF WE HAVE A SPECIFIC NODE REQUESTED TO VOTE, DO THAT
+        if(strShow == "valid" && !pGovObj->IsSetCachedValid()) continue;
+
+        UniValue bObj(UniValue::VOBJ);
+        bObj.push_back(Pair("DataHex",  pGovObj->GetDataAsHex()));
+        bObj.push_back(Pair("DataString",  pGovObj->GetDataAsString()));
+        bObj.push_back(Pair("Hash",  pGovObj->GetHash().ToString()));
+        bObj.push_back(Pair("CollateralHash",  pGovObj->GetCollateralHash().ToString()));
+
+        // REPORT STATUS FOR FUNDING VOTES SPECIFICALLY
+        bObj.push_back(Pair("AbsoluteYesCount",  pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING)));
+        bObj.push_back(Pair("YesCount",  pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)));
+        bObj.push_back(Pair("NoCount",  pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)));
+        bObj.push_back(Pair("AbstainCount",  pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING)));
+
+        // REPORT VALIDITY AND CACHING FLAGS FOR VARIOUS SETTINGS
+        std::string strError = "";
+        bObj.push_back(Pair("fBlockchainValidity",  pGovObj->IsValidLocally(pindex , strError, false)));
+        bObj.push_back(Pair("IsValidReason",  strError.c_str()));
+        bObj.push_back(Pair("fCachedValid",  pGovObj->IsSetCachedValid()));
+        bObj.push_back(Pair("fCachedFunding",  pGovObj->IsSetCachedFunding()));
+        bObj.push_back(Pair("fCachedDelete",  pGovObj->IsSetCachedDelete()));
+        bObj.push_back(Pair("fCachedEndorsed",  pGovObj->IsSetCachedEndorsed()));
+
+        vObjectsRet.push_back(std::make_pair(pGovObj->GetHash().ToString(), bObj));
+    }
+}
+
 UniValue gobject(const UniValue& params, bool fHelp)
 {
     std::string strCommand;
@@ -548,58 +603,14 @@ UniValue gobject(const UniValue& params, bool fHelp)
         if (params.size() == 2) strShow = params[1].get_str();
         if (strShow != "valid" && strShow != "all") return "Invalid mode, should be valid or all";
 
-        // GET STARTING TIME TO QUERY SYSTEM WITH
-
-        int nStartTime = 0; //list
-        if(strCommand == "diff") nStartTime = governance.GetLastDiffTime();
-
-        // SETUP BLOCK INDEX VARIABLE / RESULTS VARIABLE
-
-        CBlockIndex* pindex = NULL;
-        {
-            LOCK(cs_main);
-            pindex = chainActive.Tip();
-        }
-
-        UniValue objResult(UniValue::VOBJ);
-
         // GET MATCHING GOVERNANCE OBJECTS
 
-        LOCK(governance.cs);
-
-        std::vector<CGovernanceObject*> objs = governance.GetAllNewerThan(nStartTime);
-        governance.UpdateLastDiffTime(GetTime());
+        std::vector<std::pair<std::string, UniValue> > vObjects;
+        ListGovernanceObjects(strCommand, strShow, vObjects);
 
-        // CREATE RESULTS FOR USER
-
-        BOOST_FOREACH(CGovernanceObject* pGovObj, objs)
-        {
-            // IF WE HAVE A SPECIFIC NODE REQUESTED TO VOTE, DO THAT
-            if(strShow == "valid" && !pGovObj->IsSetCachedValid()) continue;
-
-            UniValue bObj(UniValue::VOBJ);
-            bObj.push_back(Pair("DataHex",  pGovObj->GetDataAsHex()));
-            bObj.push_back(Pair("DataString",  pGovObj->GetDataAsString()));
-            bObj.push_back(Pair("Hash",  pGovObj->GetHash().ToString()));
-            bObj.push_back(Pair("CollateralHash",  pGovObj->GetCollateralHash().ToString()));
-
-            // REPORT STATUS FOR FUNDING VOTES SPECIFICALLY
-            bObj.push_back(Pair("AbsoluteYesCount",  pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING)));
-            bObj.push_back(Pair("YesCount",  pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)));
-            bObj.push_back(Pair("NoCount",  pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)));
-            bObj.push_back(Pair("AbstainCount",  pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING)));
-
-            // REPORT VALIDITY AND CACHING FLAGS FOR VARIOUS SETTINGS
-            std::string strError = "";
-            bObj.push_back(Pair("fBlockchainValidity",  pGovObj->IsValidLocally(pindex , strError, false)));
-            bObj.push_back(Pair("IsValidReason",  strError.c_str()));
-            bObj.push_back(Pair("fCachedValid",  pGovObj->IsSetCachedValid()));
-            bObj.push_back(Pair("fCachedFunding",  pGovObj->IsSetCachedFunding()));
-            bObj.push_back(Pair("fCachedDelete",  pGovObj->IsSetCachedDelete()));
-            bObj.push_back(Pair("fCachedEndorsed",  pGovObj->IsSetCachedEndorsed()));
-
-            objResult.push_back(Pair(pGovObj->GetHash().ToString(), bObj));
-        }
+        UniValue objResult(UniValue::VOBJ);
+        for (std::vector<std::pair<std::string, UniValue> >::const_iterator it = vObjects.begin(); it != vObjects.end(); ++it)
+            objResult.push_back(Pair(it->first, it->second));
 
         return objResult;
     }
@@ -757,6 +768,35 @@ UniValue gobject(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+/** gobject for the JSON-RPC server, writes the objects of list and diff one by one */
+void gobject(const UniValue& params, CJSONStreamWriter& writer)
+{
+    std::string strCommand;
+    if (params.size() >= 1)
+        strCommand = params[0].get_str();
+
+    std::string strShow = "valid";
+    if ((strCommand == "list" || strCommand == "diff") && params.size() == 2) strShow = params[1].get_str();
+
+    // everything else, including the usage errors of list and diff, has a small reply
+    if ((strCommand != "list" && strCommand != "diff") || params.size() > 2 ||
+        (strShow != "valid" && strShow != "all")) {
+        writer.Write(gobject(params, false));
+        return;
+    }
+
+    std::vector<std::pair<std::string, UniValue> > vObjects;
+    ListGovernanceObjects(strCommand, strShow, vObjects);
+
+    writer.BeginObject();
+    for (std::vector<std::pair<std::string, UniValue> >::const_iterator it = vObjects.begin(); it != vObjects.end(); ++it)
+    {
+        writer.WriteKey(it->first);
+        writer.Write(it->second);
+    }
+    writer.EndObject();
+}
+
 UniValue voteraw(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 6)
@@ -85,24 +85,16 @@ UniValue GetNetworkHashPS(int lookup, int height) {
     if (lookup > pb->nHeight)
         lookup = pb->nHeight;
 
-    CBlockIndex *pb0 = pb;
-    int64_t minTime = pb0->GetBlockTime();
-    int64_t maxTime = minTime;
-    for (int i = 0; i < lookup; i++) {
-        pb0 = pb0->pprev;
-        int64_t time = pb0->GetBlockTime();
-        minTime = std::min(time, minTime);
-        maxTime = std::max(time, maxTime);
+    // The default windows at the tip are computed once per block
+    if (pb == chainActive.Tip()) {
+        CChainTipStats tipStats = GetChainTipStats();
+        if (lookup == tipStats.nHashPSLookup)
+            return tipStats.dNetworkHashPS;
+        if (lookup == tipStats.nRetargetHashPSLookup)
+            return tipStats.dRetargetNetworkHashPS;
     }
 
-    // In case there's a situation where minTime == maxTime, we don't want a divide by zero exception.
-    if (minTime == maxTime)
-        return 0;
-
-    arith_uint256 workDiff = pb->nChainWork - pb0->nChainWork;
-    int64_t timeDiff = maxTime - minTime;
-
-    return workDiff.getdouble() / timeDiff;
+    return GetNetworkHashRate(pb, lookup);
 }
 
 UniValue getnetworkhashps(const UniValue& params, bool fHelp)
@@ -123,8 +115,8 @@ UniValue getnetworkhashps(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getnetworkhashps", "")
        );
 
-    LOCK(cs_main);
-    return GetNetworkHashPS(params.size() > 0 ? params[0].get_int() : 120, params.size() > 1 ? params[1].get_int() : -1);
+    boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+    return GetNetworkHashPS(params.size() > 0 ? params[0].get_int() : DEFAULT_NETWORK_HASHPS_LOOKUP, params.size() > 1 ? params[1].get_int() : -1);
 }
 
 UniValue getgenerate(const UniValue& params, bool fHelp)
@@ -294,6 +286,8 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
             "  \"errors\": \"...\"          (string) Current errors\n"
             "  \"generate\": true|false     (boolean) If the generation is on or off (see getgenerate or setgenerate calls)\n"
             "  \"genproclimit\": n          (numeric) The processor limit for generation. -1 if no generation. (see getgenerate or setgenerate calls)\n"
+            "  \"hashespersec\": n          (numeric) The recent hashes per second of all generation threads together\n"
+            "  \"threadhashespersec\": [n,...] (array) The recent hashes per second of each generation thread\n"
             "  \"pooledtx\": n              (numeric) The size of the mem pool\n"
             "  \"testnet\": true|false      (boolean) If using testnet or not\n"
             "  \"chain\": \"xxxx\",         (string) current network name as defined in BIP70 (main, test, regtest)\n"
@@ -319,6 +313,10 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("chain",            Params().NetworkIDString()));
     obj.push_back(Pair("generate",         getgenerate(params, false)));
     obj.push_back(Pair("hashespersec",     gethashespersec(params, false)));
+    UniValue threadRates(UniValue::VARR);
+    BOOST_FOREACH(double dRate, GetThreadHashesPerSec())
+        threadRates.push_back((int64_t)dRate);
+    obj.push_back(Pair("threadhashespersec", threadRates));
     return obj;
 }
 
@@ -383,6 +381,106 @@ std::string gbt_vb_name(const Consensus::DeploymentPos pos)
     return s;
 }
 
+/**
+ * Block templates handed out over RPC. Every template gets an id, so later
+ * requests can refer back to it: getblocktemplate to ask for only what changed
+ * since, and long-polls to compare the mempool against what the template paid.
+ * Only the most recent templates are kept.
+ */
+class CBlockTemplateStore
+{
+private:
+    struct CStoredTemplate
+    {
+        boost::shared_ptr<CBlockTemplate> pblocktemplate;
+        CAmount nMempoolFees; //! mempool fee total when the template was built
+    };
+
+    static const size_t MAX_STORED_TEMPLATES = 16;
+
+    mutable CCriticalSection cs;
+    uint64_t nLastId;
+    std::map<uint64_t, CStoredTemplate> mapTemplates;
+
+public:
+    CBlockTemplateStore() : nLastId(0) {}
+
+    uint64_t Add(const boost::shared_ptr<CBlockTemplate>& pblocktemplate, CAmount nMempoolFees)
+    {
+        LOCK(cs);
+        CStoredTemplate& stored = mapTemplates[++nLastId];
+        stored.pblocktemplate = pblocktemplate;
+        stored.nMempoolFees = nMempoolFees;
+        while (mapTemplates.size() > MAX_STORED_TEMPLATES)
+            mapTemplates.erase(mapTemplates.begin());
+        return nLastId;
+    }
+
+    boost::shared_ptr<CBlockTemplate> Get(uint64_t nId, CAmount* pMempoolFees = NULL) const
+    {
+        LOCK(cs);
+        std::map<uint64_t, CStoredTemplate>::const_iterator it = mapTemplates.find(nId);
+        if (it == mapTemplates.end())
+            return boost::shared_ptr<CBlockTemplate>();
+        if (pMempoolFees)
+            *pMempoolFees = it->second.nMempoolFees;
+        return it->second.pblocktemplate;
+    }
+
+    void Clear()
+    {
+        LOCK(cs);
+        mapTemplates.clear();
+    }
+};
+
+static CBlockTemplateStore gbtTemplates;
+static CBlockTemplateStore getworkTemplates;
+
+/**
+ * Whether the mempool has gained enough fees since a template was built to be
+ * worth waking a long-polling miner for: the growth has to reach
+ * -longpollfeeincrease percent of the fees the template already collects.
+ */
+static bool IsSignificantFeeIncrease(const CBlockTemplate& blocktemplate, CAmount nMempoolFeesThen, CAmount nMempoolFeesNow)
+{
+    int64_t nPercent = GetArg("-longpollfeeincrease", DEFAULT_LONGPOLL_FEE_INCREASE);
+    if (nPercent <= 0 || nMempoolFeesNow <= nMempoolFeesThen)
+        return false;
+    CAmount nTemplateFees = blocktemplate.vTxFees.empty() ? 0 : -blocktemplate.vTxFees[0];
+    return (nMempoolFeesNow - nMempoolFeesThen) * 100 >= nTemplateFees * nPercent;
+}
+
+/**
+ * Work out how 'block' differs from the earlier template 'base': the
+ * transactions of 'base' it no longer contains, and the position from which
+ * its own transactions are new. Fails if the remaining transactions were
+ * reordered, in which case the client needs the full list.
+ */
+static bool GetTemplateDelta(const CBlock& base, const CBlock& block, std::vector<uint256>& vRemoved, size_t& nFirstAdded)
+{
+    if (base.hashPrevBlock != block.hashPrevBlock)
+        return false;
+
+    std::set<uint256> setTxHashes;
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        setTxHashes.insert(block.vtx[i].GetHash());
+
+    size_t nPos = 1;
+    for (size_t i = 1; i < base.vtx.size(); i++) {
+        const uint256& hash = base.vtx[i].GetHash();
+        if (!setTxHashes.count(hash)) {
+            vRemoved.push_back(hash);
+            continue;
+        }
+        if (nPos >= block.vtx.size() || block.vtx[nPos].GetHash() != hash)
+            return false;
+        nPos++;
+    }
+    nFirstAdded = nPos;
+    return true;
+}
+
 UniValue getwork(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -412,57 +510,65 @@ UniValue getwork(const UniValue& params, bool fHelp)
     if (IsInitialBlockDownload())
         throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "Dynamic is downloading blocks...");
 
-    typedef map<uint256, pair<CBlock*, CScript> > mapNewBlock_t;
-    static mapNewBlock_t mapNewBlock;    // FIXME: thread safety
-    static vector<CBlockTemplate*> vNewBlockTemplate;
+    // Work handed out, by merkle root: the template it came from and the
+    // coinbase scriptSig carrying its extra nonce. Cleared on a new tip.
+    typedef map<uint256, pair<uint64_t, CScript> > mapNewBlock_t;
+    static CCriticalSection cs_getwork;
+    static mapNewBlock_t mapNewBlock;
+    LOCK(cs_getwork);
 
     if (params.size() == 0)
     {
-      // Update block
-      static unsigned int nTransactionsUpdatedLast;
-      static CBlockIndex* pindexPrev;
-      static int64_t nStart;
-      static CBlockTemplate* pblocktemplate;
-      
+        // Update block
+        static unsigned int nTransactionsUpdatedLast;
+        static CBlockIndex* pindexPrev;
+        static int64_t nStart;
+        static boost::shared_ptr<CBlockTemplate> pblocktemplate;
+        static uint64_t nTemplateId;
+
         if (pindexPrev != chainActive.Tip() ||
             (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
         {
+            if (pindexPrev != chainActive.Tip())
+            {
+                // Work on the old tip can no longer be submitted
+                mapNewBlock.clear();
+                getworkTemplates.Clear();
+            }
+
             // Clear pindexPrev so future calls make a new block, despite any failures from here on
             pindexPrev = NULL;
 
             // Store the chainActive.Tip() used before CreateNewBlock, to avoid races
             nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+            CAmount nMempoolFees = mempool.GetTotalTxFees();
             CBlockIndex* pindexPrevNew = chainActive.Tip();
             nStart = GetTime();
 
             // Create new block
-            if(pblocktemplate)
-            {
-                delete pblocktemplate;
-                pblocktemplate = NULL;
-            }
             CScript scriptDummy = CScript() << OP_TRUE;
-            pblocktemplate = CreateNewBlock(Params(), scriptDummy);
+            pblocktemplate.reset(CreateNewBlock(Params(), scriptDummy));
             if (!pblocktemplate)
                 throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+            nTemplateId = getworkTemplates.Add(pblocktemplate, nMempoolFees);
 
             // Need to update only after we know CreateNewBlock succeeded
             pindexPrev = pindexPrevNew;
         }
-    
-      CBlock* pblock = &pblocktemplate->block; // pointer for convenience
-      const Consensus::Params& consensusParams = Params().GetConsensus();
-
-      // Update nTime
-      UpdateTime(pblock, consensusParams, pindexPrev);
-      pblock->nNonce = 0;
-    
+
+        CBlock* pblock = &pblocktemplate->block; // pointer for convenience
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+
+        // Update nTime
+        UpdateTime(pblock, consensusParams, pindexPrev);
+        pblock->nNonce = 0;
+
         // Update nExtraNonce
         static unsigned int nExtraNonce = 0;
         IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
 
         // Save
-        mapNewBlock[pblock->hashMerkleRoot] = make_pair(pblock, pblock->vtx[0].vin[0].scriptSig);
+        mapNewBlock[pblock->hashMerkleRoot] = make_pair(nTemplateId, pblock->vtx[0].vin[0].scriptSig);
 
         // Pre-build hash buffers
         char pmidstate[32];
@@ -492,21 +598,25 @@ UniValue getwork(const UniValue& params, bool fHelp)
             ((unsigned int*)pdata)[i] = ByteReverse(((unsigned int*)pdata)[i]);
 
         // Get saved block
-        if (!mapNewBlock.count(pdata->hashMerkleRoot))
+        mapNewBlock_t::const_iterator it = mapNewBlock.find(pdata->hashMerkleRoot);
+        if (it == mapNewBlock.end())
+            return false;
+        boost::shared_ptr<CBlockTemplate> pblocktemplate = getworkTemplates.Get(it->second.first);
+        if (!pblocktemplate)
             return false;
-        CBlock* pblock = mapNewBlock[pdata->hashMerkleRoot].first;
 
-        pblock->nTime = pdata->nTime;
-        pblock->nNonce = pdata->nNonce;
-        CMutableTransaction newTx;
-        // Use CMutableTransaction when creating a new transaction instead of CTransaction.  CTransaction public variables are all const now.
-        newTx.vin[0].scriptSig = mapNewBlock[pdata->hashMerkleRoot].second; // Oh, why? because vin is const in CTransaction now.  
-        pblock->vtx[0] = newTx;
-        pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+        // Work on a copy, the template keeps being handed out with other extra nonces
+        CBlock block = pblocktemplate->block;
+        block.nTime = pdata->nTime;
+        block.nNonce = pdata->nNonce;
+        CMutableTransaction coinbaseTx(block.vtx[0]);
+        coinbaseTx.vin[0].scriptSig = it->second.second;
+        block.vtx[0] = coinbaseTx;
+        block.hashMerkleRoot = BlockMerkleRoot(block);
 
         assert(pwalletMain != NULL);
         const CChainParams& chainParams = Params();
-        return CheckWork(chainParams, pblock, *pwalletMain, *pMiningKey);
+        return CheckWork(chainParams, &block, *pwalletMain, *pMiningKey);
     }
 }
 
@@ -528,7 +638,9 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "       \"capabilities\":[       (array, optional) A list of strings\n"
             "           \"support\"           (string) client side supported feature, 'longpoll', 'coinbasetxn', 'coinbasevalue', 'proposal', 'serverlist', 'workid'\n"
             "           ,...\n"
-            "         ]\n"
+            "         ],\n"
+            "       \"basetemplateid\":n     (numeric, optional) templateid of a template the client already has; if the\n"
+            "                                new template can be built from it, only the changes are returned\n"
             "     }\n"
             "\n"
 
@@ -542,12 +654,19 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "  },\n"
             "  \"vbrequired\" : n,                 (numeric) bit mask of versionbits the server requires set in submissions\n"
             "  \"previousblockhash\" : \"xxxx\",    (string) The hash of current highest block\n"
-            "  \"transactions\" : [                (array) contents of non-coinbase transactions that should be included in the next block\n"
+            "  \"templateid\" : n,                 (numeric) id of this template, to be passed as 'basetemplateid' in later requests\n"
+            "  \"basetemplateid\" : n,             (numeric) only present if the response is relative to the requested 'basetemplateid'\n"
+            "  \"removedtransactions\" : [         (array) only present with 'basetemplateid': hashes of the base template's transactions\n"
+            "      \"xxxx\"                         that are no longer included; the remaining ones keep their order\n"
+            "      ,...\n"
+            "  ],\n"
+            "  \"transactions\" : [                (array) contents of non-coinbase transactions that should be included in the next block,\n"
+            "                                    with 'basetemplateid' only those to append after the base template's remaining ones\n"
             "      {\n"
             "         \"data\" : \"xxxx\",          (string) transaction data encoded in hexadecimal (byte-for-byte)\n"
             "         \"hash\" : \"xxxx\",          (string) hash/id encoded in little-endian hexadecimal\n"
             "         \"depends\" : [              (array) array of numbers \n"
-            "             n                        (numeric) transactions before this one (by 1-based index in 'transactions' list) that must be present in the final block if this one is\n"
+            "             n                        (numeric) transactions before this one (by 1-based index in the full transactions list) that must be present in the final block if this one is\n"
             "             ,...\n"
             "         ],\n"
             "         \"fee\": n,                   (numeric) difference in value between transaction inputs and outputs (in duffs); for coinbase transactions, this is a negative Number of the total collected block fees (ie, not including the block subsidy); if key is not present, fee is unknown and clients MUST NOT assume there isn't one\n"
@@ -561,6 +680,8 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "  },\n"
             "  \"coinbasevalue\" : n,               (numeric) maximum allowable input to coinbase transaction, including the generation award and transaction fees (in duffs)\n"
             "  \"coinbasetxn\" : { ... },           (json object) information for coinbase transaction\n"
+            "  \"longpollid\" : \"xxxx\",             (string) pass back to wait until the chain tip changes, the mempool fees grow\n"
+            "                                     significantly (see -longpollfeeincrease) or a minute passed with new transactions\n"
             "  \"target\" : \"xxxx\",               (string) The hash target\n"
             "  \"mintime\" : xxx,                   (numeric) The minimum timestamp appropriate for next block time in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"mutable\" : [                      (array of string) list of ways the block template may be changed \n"
@@ -603,6 +724,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     UniValue lpval = NullUniValue;
     std::set<std::string> setClientRules;
     int64_t nMaxVersionPreVB = -1;
+    int64_t nBaseTemplateId = -1;
     if (params.size() > 0)
     {
         const UniValue& oparam = params[0].get_obj();
@@ -616,6 +738,9 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         else
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mode");
         lpval = find_value(oparam, "longpollid");
+        const UniValue& baseval = find_value(oparam, "basetemplateid");
+        if (baseval.isNum())
+            nBaseTemplateId = baseval.get_int64();
 
         if (strMode == "proposal")
         {
@@ -672,43 +797,60 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "Dynamic is downloading blocks...");
 
     static unsigned int nTransactionsUpdatedLast;
+    static uint64_t nTemplateId;
 
     if (!lpval.isNull())
     {
-        // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
+        // Wait to respond until either the best block changes, the mempool fees grow significantly,
+        // OR a minute has passed and there are more transactions
         uint256 hashWatchedChain;
         boost::system_time checktxtime;
         unsigned int nTransactionsUpdatedLastLP;
+        uint64_t nTemplateIdLP;
 
         if (lpval.isStr())
         {
-            // Format: <hashBestChain><nTransactionsUpdatedLast>
+            // Format: <hashBestChain><nTransactionsUpdatedLast>:<templateid>
             std::string lpstr = lpval.get_str();
 
             hashWatchedChain.SetHex(lpstr.substr(0, 64));
             nTransactionsUpdatedLastLP = atoi64(lpstr.substr(64));
+            size_t nSep = lpstr.find(':', 64);
+            nTemplateIdLP = nSep == std::string::npos ? 0 : atoi64(lpstr.substr(nSep + 1));
         }
         else
         {
             // NOTE: Spec does not specify behaviour for non-string longpollid, but this makes testing easier
             hashWatchedChain = chainActive.Tip()->GetBlockHash();
             nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
+            nTemplateIdLP = nTemplateId;
         }
 
+        // The template the client is working on, to tell whether new fees are worth waking it for
+        CAmount nMempoolFeesLP = 0;
+        boost::shared_ptr<CBlockTemplate> pblocktemplateLP = gbtTemplates.Get(nTemplateIdLP, &nMempoolFeesLP);
+
         // Release the wallet and main lock while waiting
         LEAVE_CRITICAL_SECTION(cs_main);
         {
             checktxtime = boost::get_system_time() + boost::posix_time::minutes(1);
+            boost::system_time checkfeetime = boost::get_system_time() + boost::posix_time::seconds(1);
 
             boost::unique_lock<boost::mutex> lock(csBestBlock);
             while (chainActive.Tip()->GetBlockHash() == hashWatchedChain && IsRPCRunning())
             {
-                if (!cvBlockChange.timed_wait(lock, checktxtime))
+                if (!cvBlockChange.timed_wait(lock, std::min(checktxtime, checkfeetime)))
                 {
-                    // Timeout: Check transactions for update
-                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                    // Timeout: Check fees and transactions for update
+                    if (pblocktemplateLP && IsSignificantFeeIncrease(*pblocktemplateLP, nMempoolFeesLP, mempool.GetTotalTxFees()))
                         break;
-                    checktxtime += boost::posix_time::seconds(10);
+                    if (boost::get_system_time() >= checktxtime)
+                    {
+                        if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                            break;
+                        checktxtime += boost::posix_time::seconds(10);
+                    }
+                    checkfeetime = boost::get_system_time() + boost::posix_time::seconds(1);
                 }
             }
         }
@@ -722,7 +864,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     // Update block
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
-    static CBlockTemplate* pblocktemplate;
+    static boost::shared_ptr<CBlockTemplate> pblocktemplate;
     if (pindexPrev != chainActive.Tip() ||
         (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
     {
@@ -731,19 +873,16 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
         // Store the chainActive.Tip() used before CreateNewBlock, to avoid races
         nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+        CAmount nMempoolFees = mempool.GetTotalTxFees();
         CBlockIndex* pindexPrevNew = chainActive.Tip();
         nStart = GetTime();
 
-        // Create new block
-        if(pblocktemplate)
-        {
-            delete pblocktemplate;
-            pblocktemplate = NULL;
-        }
+        // Create new block; the previous one stays in gbtTemplates for delta requests
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = CreateNewBlock(Params(), scriptDummy);
+        pblocktemplate.reset(CreateNewBlock(Params(), scriptDummy));
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+        nTemplateId = gbtTemplates.Add(pblocktemplate, nMempoolFees);
 
         // Need to update only after we know CreateNewBlock succeeded
         pindexPrev = pindexPrevNew;
@@ -757,6 +896,16 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
+    // Answer relative to the client's template if only transactions were removed or appended since
+    bool fDelta = false;
+    std::vector<uint256> vRemoved;
+    size_t nFirstAdded = 1;
+    if (nBaseTemplateId >= 0) {
+        boost::shared_ptr<CBlockTemplate> pbasetemplate = gbtTemplates.Get(nBaseTemplateId);
+        if (pbasetemplate)
+            fDelta = GetTemplateDelta(pbasetemplate->block, *pblock, vRemoved, nFirstAdded);
+    }
+
     UniValue transactions(UniValue::VARR);
     map<uint256, int64_t> setTxIndex;
     int i = 0;
@@ -766,6 +915,8 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
         if (tx.IsCoinBase())
             continue;
+        if (fDelta && (size_t)(i - 1) < nFirstAdded)
+            continue;
 
         UniValue entry(UniValue::VOBJ);
 
@@ -856,10 +1007,18 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         aMutable.push_back("version/force");
     }
     result.push_back(Pair("previousblockhash", pblock->hashPrevBlock.GetHex()));
+    result.push_back(Pair("templateid", (int64_t)nTemplateId));
+    if (fDelta) {
+        UniValue removed(UniValue::VARR);
+        BOOST_FOREACH(const uint256& hash, vRemoved)
+            removed.push_back(hash.GetHex());
+        result.push_back(Pair("basetemplateid", nBaseTemplateId));
+        result.push_back(Pair("removedtransactions", removed));
+    }
     result.push_back(Pair("transactions", transactions));
     result.push_back(Pair("coinbaseaux", aux));
     result.push_back(Pair("coinbasevalue", (int64_t)pblock->vtx[0].GetValueOut()));
-    result.push_back(Pair("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast)));
+    result.push_back(Pair("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast) + ":" + i64tostr(nTemplateId)));
     result.push_back(Pair("target", hashTarget.GetHex()));
     result.push_back(Pair("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1));
     result.push_back(Pair("mutable", aMutable));
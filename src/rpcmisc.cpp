@@ -570,6 +570,168 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/*
+ * The lookups of the getaddress* calls are split from the formatting of their
+ * results, so the JSON-RPC server can write the results while formatting them.
+ * All errors are thrown by the lookups: the entries only belong to addresses
+ * getAddressesFromParams accepted, so getAddressFromIndex can't fail on them.
+ */
+
+static void getAddressMempool(const UniValue& params, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >& indexes)
+{
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    if (!mempool.getAddressIndex(addresses, indexes)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    std::sort(indexes.begin(), indexes.end(), timestampSort);
+}
+
+static UniValue addressMempoolDeltaToJSON(const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>& index)
+{
+    std::string address;
+    if (!getAddressFromIndex(index.first.type, index.first.addressBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.push_back(Pair("address", address));
+    delta.push_back(Pair("txid", index.first.txhash.GetHex()));
+    delta.push_back(Pair("index", (int)index.first.index));
+    delta.push_back(Pair("satoshis", index.second.amount));
+    delta.push_back(Pair("timestamp", index.second.time));
+    if (index.second.amount < 0) {
+        delta.push_back(Pair("prevtxid", index.second.prevhash.GetHex()));
+        delta.push_back(Pair("prevout", (int)index.second.prevout));
+    }
+    return delta;
+}
+
+static void getAddressUtxos(const UniValue& params, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs)
+{
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+}
+
+static UniValue addressUnspentToJSON(const std::pair<CAddressUnspentKey, CAddressUnspentValue>& unspent)
+{
+    UniValue output(UniValue::VOBJ);
+    std::string address;
+    if (!getAddressFromIndex(unspent.first.type, unspent.first.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    output.push_back(Pair("address", address));
+    output.push_back(Pair("txid", unspent.first.txhash.GetHex()));
+    output.push_back(Pair("outputIndex", (int)unspent.first.index));
+    output.push_back(Pair("script", HexStr(unspent.second.script.begin(), unspent.second.script.end())));
+    output.push_back(Pair("satoshis", unspent.second.satoshis));
+    output.push_back(Pair("height", unspent.second.blockHeight));
+    return output;
+}
+
+/** The address index entries of the addresses in params, between the optional start and end heights */
+static void getAddressIndexFromParams(const UniValue& params, std::vector<std::pair<uint160, int> >& addresses,
+                                      std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex, bool fCheckRange)
+{
+    int start = 0;
+    int end = 0;
+    if (params[0].isObject()) {
+        UniValue startValue = find_value(params[0].get_obj(), "start");
+        UniValue endValue = find_value(params[0].get_obj(), "end");
+        if (startValue.isNum() && endValue.isNum()) {
+            start = startValue.get_int();
+            end = endValue.get_int();
+            if (fCheckRange && end < start) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "End value is expected to be greater than start");
+            }
+        }
+    }
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (start > 0 && end > 0) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        } else {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+    }
+}
+
+static void getAddressDeltas(const UniValue& params, std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex)
+{
+    std::vector<std::pair<uint160, int> > addresses;
+    getAddressIndexFromParams(params, addresses, addressIndex, true);
+}
+
+static UniValue addressDeltaToJSON(const std::pair<CAddressIndexKey, CAmount>& index)
+{
+    std::string address;
+    if (!getAddressFromIndex(index.first.type, index.first.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.push_back(Pair("satoshis", index.second));
+    delta.push_back(Pair("txid", index.first.txhash.GetHex()));
+    delta.push_back(Pair("index", (int)index.first.index));
+    delta.push_back(Pair("blockindex", (int)index.first.txindex));
+    delta.push_back(Pair("height", index.first.blockHeight));
+    delta.push_back(Pair("address", address));
+    return delta;
+}
+
+static void getAddressTxids(const UniValue& params, std::vector<std::string>& vTxids)
+{
+    std::vector<std::pair<uint160, int> > addresses;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressIndexFromParams(params, addresses, addressIndex, false);
+
+    std::set<std::pair<int, std::string> > txids;
+
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        int height = it->first.blockHeight;
+        std::string txid = it->first.txhash.GetHex();
+
+        if (addresses.size() > 1) {
+            txids.insert(std::make_pair(height, txid));
+        } else {
+            if (txids.insert(std::make_pair(height, txid)).second) {
+                vTxids.push_back(txid);
+            }
+        }
+    }
+
+    if (addresses.size() > 1) {
+        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
+            vTxids.push_back(it->second);
+        }
+    }
+}
+
 UniValue getaddressmempool(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -601,44 +763,33 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaddressmempool", "{\"addresses\": [\"D5nRy9Tf7Zsef8gMGL2fhWA9ZslrP4K5tf\"]}")
         );
 
-    std::vector<std::pair<uint160, int> > addresses;
-
-    if (!getAddressesFromParams(params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
-
     std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > indexes;
+    getAddressMempool(params, indexes);
 
-    if (!mempool.getAddressIndex(addresses, indexes)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::const_iterator it = indexes.begin();
+         it != indexes.end(); it++) {
+        result.push_back(addressMempoolDeltaToJSON(*it));
     }
 
-    std::sort(indexes.begin(), indexes.end(), timestampSort);
-
-    UniValue result(UniValue::VARR);
+    return result;
+}
 
-    for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::iterator it = indexes.begin();
-         it != indexes.end(); it++) {
+/** getaddressmempool for the JSON-RPC server, writes the deltas one by one */
+void getaddressmempool(const UniValue& params, CJSONStreamWriter& writer)
+{
+    if (params.size() != 1)
+        getaddressmempool(params, true); // throws the usage
 
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.addressBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > indexes;
+    getAddressMempool(params, indexes);
 
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("address", address));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("satoshis", it->second.amount));
-        delta.push_back(Pair("timestamp", it->second.time));
-        if (it->second.amount < 0) {
-            delta.push_back(Pair("prevtxid", it->second.prevhash.GetHex()));
-            delta.push_back(Pair("prevout", (int)it->second.prevout));
-        }
-        result.push_back(delta);
+    writer.BeginArray();
+    for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::const_iterator it = indexes.begin();
+         it != indexes.end(); it++) {
+        writer.Write(addressMempoolDeltaToJSON(*it));
     }
-
-    return result;
+    writer.EndArray();
 }
 
 UniValue getaddressutxos(const UniValue& params, bool fHelp)
@@ -671,41 +822,31 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"D5nRy9Tf7Zsef8gMGL2fhWA9ZslrP4K5tf\"]}")
         );
 
-    std::vector<std::pair<uint160, int> > addresses;
-
-    if (!getAddressesFromParams(params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
-
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    getAddressUtxos(params, unspentOutputs);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+        result.push_back(addressUnspentToJSON(*it));
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    return result;
+}
 
-    UniValue result(UniValue::VARR);
+/** getaddressutxos for the JSON-RPC server, writes the outputs one by one */
+void getaddressutxos(const UniValue& params, CJSONStreamWriter& writer)
+{
+    if (params.size() != 1)
+        getaddressutxos(params, true); // throws the usage
 
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
-        UniValue output(UniValue::VOBJ);
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    getAddressUtxos(params, unspentOutputs);
 
-        output.push_back(Pair("address", address));
-        output.push_back(Pair("txid", it->first.txhash.GetHex()));
-        output.push_back(Pair("outputIndex", (int)it->first.index));
-        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
-        output.push_back(Pair("satoshis", it->second.satoshis));
-        output.push_back(Pair("height", it->second.blockHeight));
-        result.push_back(output);
+    writer.BeginArray();
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+        writer.Write(addressUnspentToJSON(*it));
     }
-
-    return result;
+    writer.EndArray();
 }
 
 UniValue getaddressdeltas(const UniValue& params, bool fHelp)
@@ -739,60 +880,31 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"D5nRy9Tf7Zsef8gMGL2fhWA9ZslrP4K5tf\"]}")
         );
 
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressDeltas(params, addressIndex);
 
-    UniValue startValue = find_value(params[0].get_obj(), "start");
-    UniValue endValue = find_value(params[0].get_obj(), "end");
-
-    int start = 0;
-    int end = 0;
-
-    if (startValue.isNum() && endValue.isNum()) {
-        start = startValue.get_int();
-        end = endValue.get_int();
-        if (end < start) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "End value is expected to be greater than start");
-        }
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        result.push_back(addressDeltaToJSON(*it));
     }
 
-    std::vector<std::pair<uint160, int> > addresses;
+    return result;
+}
 
-    if (!getAddressesFromParams(params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
+/** getaddressdeltas for the JSON-RPC server, writes the deltas one by one */
+void getaddressdeltas(const UniValue& params, CJSONStreamWriter& writer)
+{
+    if (params.size() != 1 || !params[0].isObject())
+        getaddressdeltas(params, true); // throws the usage
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressDeltas(params, addressIndex);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
-
-    UniValue result(UniValue::VARR);
-
+    writer.BeginArray();
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
-
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("satoshis", it->second));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("blockindex", (int)it->first.txindex));
-        delta.push_back(Pair("height", it->first.blockHeight));
-        delta.push_back(Pair("address", address));
-        result.push_back(delta);
+        writer.Write(addressDeltaToJSON(*it));
     }
-
-    return result;
+    writer.EndArray();
 }
 
 UniValue getaddressbalance(const UniValue& params, bool fHelp)
@@ -877,61 +989,33 @@ UniValue getaddrepstxids(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaddrepstxids", "{\"addresses\": [\"D5nRy9Tf7Zsef8gMGL2fhWA9ZslrP4K5tf\"]}")
         );
 
-    std::vector<std::pair<uint160, int> > addresses;
+    std::vector<std::string> vTxids;
+    getAddressTxids(params, vTxids);
 
-    if (!getAddressesFromParams(params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
-
-    int start = 0;
-    int end = 0;
-    if (params[0].isObject()) {
-        UniValue startValue = find_value(params[0].get_obj(), "start");
-        UniValue endValue = find_value(params[0].get_obj(), "end");
-        if (startValue.isNum() && endValue.isNum()) {
-            start = startValue.get_int();
-            end = endValue.get_int();
-        }
+    UniValue result(UniValue::VARR);
+    result.reserve(vTxids.size());
+    for (std::vector<std::string>::const_iterator it=vTxids.begin(); it!=vTxids.end(); it++) {
+        result.push_back(*it);
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
+    return result;
 
-    std::set<std::pair<int, std::string> > txids;
-    UniValue result(UniValue::VARR);
+}
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        std::string txid = it->first.txhash.GetHex();
+/** getaddrepstxids for the JSON-RPC server, writes the txids one by one */
+void getaddrepstxids(const UniValue& params, CJSONStreamWriter& writer)
+{
+    if (params.size() != 1)
+        getaddrepstxids(params, true); // throws the usage
 
-        if (addresses.size() > 1) {
-            txids.insert(std::make_pair(height, txid));
-        } else {
-            if (txids.insert(std::make_pair(height, txid)).second) {
-                result.push_back(txid);
-            }
-        }
-    }
+    std::vector<std::string> vTxids;
+    getAddressTxids(params, vTxids);
 
-    if (addresses.size() > 1) {
-        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
-            result.push_back(it->second);
-        }
+    writer.BeginArray();
+    for (std::vector<std::string>::const_iterator it=vTxids.begin(); it!=vTxids.end(); it++) {
+        writer.Write(UniValue(*it));
     }
-
-    return result;
-
+    writer.EndArray();
 }
 
 UniValue getspentinfo(const UniValue& params, bool fHelp)
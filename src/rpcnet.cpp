@@ -9,10 +9,12 @@
 
 #include "chainparams.h"
 #include "clientversion.h"
+#include "httpserver.h"
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
 #include "protocol.h"
+#include "responsecache.h"
 #include "sync.h"
 #include "timedata.h"
 #include "ui_interface.h"
@@ -405,6 +407,71 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     return obj;
 }
 
+UniValue gethttpstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "gethttpstats\n"
+            "\nReturns statistics of the HTTP server, per handler path prefix.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queuedepth\": n,           (numeric) Requests waiting for a worker thread now\n"
+            "  \"endpoints\": {\n"
+            "    \"prefix\": {              (string) Handler path prefix, e.g. /rest/\n"
+            "      \"requests\": n,         (numeric) Requests handled\n"
+            "      \"rejected\": n,         (numeric) Requests rejected because the work queue was full\n"
+            "      \"held\": n,             (numeric) Requests held for -rpcworkqueuewait because the work queue was full\n"
+            "      \"avgqueuetime\": n,     (numeric) Average time waiting for a worker in microseconds\n"
+            "      \"maxqueuetime\": n,     (numeric) Longest time waiting for a worker in microseconds\n"
+            "      \"avghandlertime\": n,   (numeric) Average time in the handler in microseconds\n"
+            "      \"maxhandlertime\": n    (numeric) Longest time in the handler in microseconds\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"responsecache\": {      (object) Cache of replies about confirmed blocks and transactions\n"
+            "    \"entries\": n,          (numeric) Replies in the cache\n"
+            "    \"bytes\": n,            (numeric) Estimated memory used by the cache\n"
+            "    \"hits\": n,             (numeric) Requests answered from the cache\n"
+            "    \"misses\": n            (numeric) Cacheable requests not found in the cache\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("gethttpstats", "")
+            + HelpExampleRpc("gethttpstats", "")
+       );
+
+    std::map<std::string, HTTPEndpointStats> mapStats;
+    size_t nQueueDepth;
+    GetHTTPStats(mapStats, nQueueDepth);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("queuedepth", (uint64_t)nQueueDepth));
+    UniValue endpoints(UniValue::VOBJ);
+    for (std::map<std::string, HTTPEndpointStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        const HTTPEndpointStats& stats = it->second;
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("requests", stats.nRequests));
+        entry.push_back(Pair("rejected", stats.nRejected));
+        entry.push_back(Pair("held", stats.nHeld));
+        entry.push_back(Pair("avgqueuetime", stats.nRequests ? stats.nQueueMicros / (int64_t)stats.nRequests : 0));
+        entry.push_back(Pair("maxqueuetime", stats.nMaxQueueMicros));
+        entry.push_back(Pair("avghandlertime", stats.nRequests ? stats.nHandlerMicros / (int64_t)stats.nRequests : 0));
+        entry.push_back(Pair("maxhandlertime", stats.nMaxHandlerMicros));
+        endpoints.push_back(Pair(it->first, entry));
+    }
+    obj.push_back(Pair("endpoints", endpoints));
+
+    uint64_t nHits, nMisses;
+    size_t nEntries, nBytes;
+    responseCache.GetStats(nHits, nMisses, nEntries, nBytes);
+    UniValue cache(UniValue::VOBJ);
+    cache.push_back(Pair("entries", (uint64_t)nEntries));
+    cache.push_back(Pair("bytes", (uint64_t)nBytes));
+    cache.push_back(Pair("hits", nHits));
+    cache.push_back(Pair("misses", nMisses));
+    obj.push_back(Pair("responsecache", cache));
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
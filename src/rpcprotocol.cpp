@@ -14,6 +14,7 @@
 #include "utiltime.h"
 #include "version.h"
 
+#include <assert.h>
 #include <stdint.h>
 #include <fstream>
 
@@ -63,6 +64,135 @@ UniValue JSONRPCError(int code, const string& message)
     return error;
 }
 
+CJSONStreamWriter::CJSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn) :
+    sink(sinkIn), nChunkSize(nChunkSizeIn), fAfterKey(false)
+{
+    strBuffer.reserve(nChunkSize);
+}
+
+void CJSONStreamWriter::Append(const string& str)
+{
+    strBuffer += str;
+    if (strBuffer.size() >= nChunkSize)
+        Flush();
+}
+
+void CJSONStreamWriter::BeginValue()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vEmpty.empty()) {
+        if (!vEmpty.back())
+            Append(",");
+        vEmpty.back() = false;
+    }
+}
+
+void CJSONStreamWriter::WriteValue(const UniValue& val)
+{
+    if (val.isObject()) {
+        const vector<string>& keys = val.getKeys();
+        const vector<UniValue>& values = val.getValues();
+        Append("{");
+        for (unsigned int i = 0; i < keys.size(); i++) {
+            if (i)
+                Append(",");
+            Append(UniValue(keys[i]).write());
+            Append(":");
+            WriteValue(values[i]);
+        }
+        Append("}");
+    } else if (val.isArray()) {
+        const vector<UniValue>& values = val.getValues();
+        Append("[");
+        for (unsigned int i = 0; i < values.size(); i++) {
+            if (i)
+                Append(",");
+            WriteValue(values[i]);
+        }
+        Append("]");
+    } else {
+        Append(val.write());
+    }
+}
+
+void CJSONStreamWriter::Write(const UniValue& val)
+{
+    BeginValue();
+    WriteValue(val);
+}
+
+void CJSONStreamWriter::BeginObject()
+{
+    BeginValue();
+    Append("{");
+    vEmpty.push_back(true);
+}
+
+void CJSONStreamWriter::EndObject()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Append("}");
+}
+
+void CJSONStreamWriter::BeginArray()
+{
+    BeginValue();
+    Append("[");
+    vEmpty.push_back(true);
+}
+
+void CJSONStreamWriter::EndArray()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Append("]");
+}
+
+void CJSONStreamWriter::WriteKey(const string& strKey)
+{
+    BeginValue();
+    Append(UniValue(strKey).write());
+    Append(":");
+    fAfterKey = true;
+}
+
+void CJSONStreamWriter::WriteRaw(const string& str)
+{
+    Append(str);
+}
+
+void CJSONStreamWriter::Flush()
+{
+    if (strBuffer.empty())
+        return;
+    sink(strBuffer);
+    strBuffer.clear();
+}
+
+string CJSONStreamWriter::TakeBuffered()
+{
+    string strRet;
+    strRet.swap(strBuffer);
+    return strRet;
+}
+
+void JSONRPCWriteReply(CJSONStreamWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    writer.BeginObject();
+    writer.WriteKey("result");
+    writer.Write(error.isNull() ? result : NullUniValue);
+    writer.WriteKey("error");
+    writer.Write(error);
+    writer.WriteKey("id");
+    writer.Write(id);
+    writer.EndObject();
+    writer.WriteRaw("\n");
+}
+
 /** Username used when cookie authentication is in use (arbitrary, only for
  * recognizability in debugging/logging purposes)
  */
@@ -12,7 +12,9 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
 
 #include <univalue.h>
 
@@ -83,6 +85,55 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
+/**
+ * Compact JSON serializer that hands its output to a sink in pieces of about
+ * nChunkSize bytes while it is being produced, instead of rendering the whole
+ * document into one string like UniValue::write() does. Values can be written
+ * whole or built up member by member with Begin/End and WriteKey.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef boost::function<void(const std::string&)> Sink;
+
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    CJSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn = DEFAULT_CHUNK_SIZE);
+
+    /** Write a value, same text as UniValue::write() without indentation */
+    void Write(const UniValue& val);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Start the next member of the innermost open object */
+    void WriteKey(const std::string& strKey);
+
+    /** Append text as is, e.g. the newline that ends a reply */
+    void WriteRaw(const std::string& str);
+
+    /** Pass everything buffered so far to the sink */
+    void Flush();
+    /** Return the output that was not passed to the sink yet, and forget it */
+    std::string TakeBuffered();
+
+private:
+    Sink sink;
+    size_t nChunkSize;
+    std::string strBuffer;
+    //! One entry per open object or array, true while it has no members yet
+    std::vector<bool> vEmpty;
+    bool fAfterKey;
+
+    void BeginValue();
+    void WriteValue(const UniValue& val);
+    void Append(const std::string& str);
+};
+
+/** Stream the same reply object as JSONRPCReply(), including the trailing newline */
+void JSONRPCWriteReply(CJSONStreamWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id);
+
 /** Get name of RPC authentication cookie file */
 boost::filesystem::path GetAuthCookieFile();
 /** Generate a new RPC authentication cookie and write it to disk */
@@ -17,6 +17,7 @@
 #include "net.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
+#include "responsecache.h"
 #include "rpcserver.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -125,6 +126,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 
     if (!hashBlock.IsNull()) {
         entry.push_back(Pair("blockhash", hashBlock.GetHex()));
+        boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
         if (mi != mapBlockIndex.end() && (*mi).second) {
             CBlockIndex* pindex = (*mi).second;
@@ -208,14 +210,20 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawtransaction", "\"mytxid\", 1")
         );
 
-    LOCK(cs_main);
-
     uint256 hash = ParseHashV(params[0], "parameter 1");
 
     bool fVerbose = false;
     if (params.size() > 1)
         fVerbose = (params[1].get_int() != 0);
 
+    // Spent outputs change the verbose form as long as the spent index is kept up to date
+    const bool fCacheable = !fVerbose || !fSpentIndex;
+    const std::string strCacheKey = ResponseCacheKey("getrawtransaction", hash.GetHex(), fVerbose ? "json" : "hex");
+    UniValue cached;
+    if (fCacheable && responseCache.Get(strCacheKey, cached))
+        return cached;
+
+    // GetTransaction takes cs_main only when it has to scan the coins view
     CTransaction tx;
     uint256 hashBlock;
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
@@ -223,12 +231,15 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
 
     string strHex = EncodeHexTx(tx);
 
-    if (!fVerbose)
-        return strHex;
-
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hex", strHex));
-    TxToJSON(tx, hashBlock, result);
+    if (!fVerbose) {
+        result = strHex;
+    } else {
+        result.push_back(Pair("hex", strHex));
+        TxToJSON(tx, hashBlock, result);
+    }
+    if (fCacheable && !hashBlock.IsNull())
+        responseCache.Put(strCacheKey, result, hashBlock);
     return result;
 }
 
@@ -8,12 +8,14 @@
 #include "rpcserver.h"
 
 #include "base58.h"
+#include "httpserver.h"
 #include "init.h"
 #include "random.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "validationinterface.h"
 
 #include <univalue.h>
 
@@ -255,157 +257,181 @@ UniValue stop(const UniValue& params, bool fHelp)
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode lockClass           usesWallet
+  //  --------------------- ------------------------  -----------------------  ---------- ------------------  ----------
     /* Overall control/query calls */
-    { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
-    { "control",            "debug",                  &debug,                  true  },
-    { "control",            "help",                   &help,                   true  },
-    { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getinfo",                &getinfo,                true,  RPC_LOCK_SHARED,    true  }, /* uses wallet if enabled */
+    { "control",            "debug",                  &debug,                  true,  RPC_LOCK_EXCLUSIVE, false },
+    { "control",            "help",                   &help,                   true,  RPC_LOCK_NONE,      false },
+    { "control",            "stop",                   &stop,                   true,  RPC_LOCK_EXCLUSIVE, false },
 
     /* P2P networking */
-    { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
-    { "network",            "addnode",                &addnode,                true  },
-    { "network",            "disconnectnode",         &disconnectnode,         true  },
-    { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
-    { "network",            "getconnectioncount",     &getconnectioncount,     true  },
-    { "network",            "getnettotals",           &getnettotals,           true  },
-    { "network",            "getpeerinfo",            &getpeerinfo,            true  },
-    { "network",            "ping",                   &ping,                   true  },
-    { "network",            "setban",                 &setban,                 true  },
-    { "network",            "listbanned",             &listbanned,             true  },
-    { "network",            "clearbanned",            &clearbanned,            true  },
+    { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  RPC_LOCK_SHARED,    false },
+    { "network",            "addnode",                &addnode,                true,  RPC_LOCK_EXCLUSIVE, false },
+    { "network",            "disconnectnode",         &disconnectnode,         true,  RPC_LOCK_EXCLUSIVE, false },
+    { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  RPC_LOCK_SHARED,    false },
+    { "network",            "getconnectioncount",     &getconnectioncount,     true,  RPC_LOCK_SHARED,    false },
+    { "network",            "getnettotals",           &getnettotals,           true,  RPC_LOCK_SHARED,    false },
+    { "network",            "gethttpstats",           &gethttpstats,           true,  RPC_LOCK_NONE,      false },
+    { "network",            "getpeerinfo",            &getpeerinfo,            true,  RPC_LOCK_SHARED,    false },
+    { "network",            "ping",                   &ping,                   true,  RPC_LOCK_EXCLUSIVE, false },
+    { "network",            "setban",                 &setban,                 true,  RPC_LOCK_EXCLUSIVE, false },
+    { "network",            "listbanned",             &listbanned,             true,  RPC_LOCK_SHARED,    false },
+    { "network",            "clearbanned",            &clearbanned,            true,  RPC_LOCK_EXCLUSIVE, false },
 
     /* Block chain and UTXO */
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
-    { "blockchain",         "getblockheaders",        &getblockheaders,        true  },
-    { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
-    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
-    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
-    { "blockchain",         "verifychain",            &verifychain,            true  },
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getblock",               &getblock,               true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getblockheaders",        &getblockheaders,        true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getchaintips",           &getchaintips,           true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "gettxout",               &gettxout,               true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true,  RPC_LOCK_SHARED,    false },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  RPC_LOCK_EXCLUSIVE, false },
+    { "blockchain",         "verifychain",            &verifychain,            true,  RPC_LOCK_EXCLUSIVE, false },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false, RPC_LOCK_SHARED,    false },
 
     /* Mining */
-    { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
-    { "mining",             "getwork",                &getwork,                true  },
-    { "mining",             "getmininginfo",          &getmininginfo,          true  },
-    { "mining",             "getnetworkhashps",       &getnetworkhashps,       true  },
-    { "mining",             "prioritisetransaction",  &prioritisetransaction,  true  },
-    { "mining",             "submitblock",            &submitblock,            true  },
+    { "mining",             "getblocktemplate",       &getblocktemplate,       true,  RPC_LOCK_EXCLUSIVE, false },
+    { "mining",             "getwork",                &getwork,                true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "mining",             "getmininginfo",          &getmininginfo,          true,  RPC_LOCK_SHARED,    false },
+    { "mining",             "getnetworkhashps",       &getnetworkhashps,       true,  RPC_LOCK_SHARED,    false },
+    { "mining",             "prioritisetransaction",  &prioritisetransaction,  true,  RPC_LOCK_EXCLUSIVE, false },
+    { "mining",             "submitblock",            &submitblock,            true,  RPC_LOCK_EXCLUSIVE, false },
 
     /* Coin generation */
-    { "generating",         "getgenerate",            &getgenerate,            true  },
-    { "generating",         "setgenerate",            &setgenerate,            true  },
-    { "generating",         "generate",               &generate,               true  },
-    { "generating",         "gethashespersec",        &gethashespersec,        true  },
+    { "generating",         "getgenerate",            &getgenerate,            true,  RPC_LOCK_SHARED,    false },
+    { "generating",         "setgenerate",            &setgenerate,            true,  RPC_LOCK_EXCLUSIVE, false },
+    { "generating",         "generate",               &generate,               true,  RPC_LOCK_EXCLUSIVE, false },
+    { "generating",         "gethashespersec",        &gethashespersec,        true,  RPC_LOCK_SHARED,    false },
 
     /* Raw transactions */
-    { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
-    { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
-    { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
+    { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true,  RPC_LOCK_NONE,      false },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  RPC_LOCK_NONE,      false },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,  RPC_LOCK_NONE,      false },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  RPC_LOCK_SHARED,    false },
+    { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false, RPC_LOCK_EXCLUSIVE, false },
+    { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false, RPC_LOCK_EXCLUSIVE, true  }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
-    { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false },
+    { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false, RPC_LOCK_EXCLUSIVE, true  },
 #endif
 
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
-    { "addressindex",       "getaddrepstxids",        &getaddrepstxids,        false },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,  RPC_LOCK_SHARED,    false },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, RPC_LOCK_SHARED,    false },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, RPC_LOCK_SHARED,    false },
+    { "addressindex",       "getaddrepstxids",        &getaddrepstxids,        false, RPC_LOCK_SHARED,    false },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false, RPC_LOCK_SHARED,    false },
 
     /* Utility functions */
-    { "util",               "createmultisig",         &createmultisig,         true  },
-    { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
-    { "util",               "verifymessage",          &verifymessage,          true  },
-    { "util",               "estimatefee",            &estimatefee,            true  },
-    { "util",               "estimatepriority",       &estimatepriority,       true  },
-    { "util",               "estimatesmartfee",       &estimatesmartfee,       true  },
-    { "util",               "estimatesmartpriority",  &estimatesmartpriority,  true  },
+    { "util",               "createmultisig",         &createmultisig,         true,  RPC_LOCK_SHARED,    true  },
+    { "util",               "validateaddress",        &validateaddress,        true,  RPC_LOCK_SHARED,    true  }, /* uses wallet if enabled */
+    { "util",               "verifymessage",          &verifymessage,          true,  RPC_LOCK_NONE,      false },
+    { "util",               "estimatefee",            &estimatefee,            true,  RPC_LOCK_SHARED,    false },
+    { "util",               "estimatepriority",       &estimatepriority,       true,  RPC_LOCK_SHARED,    false },
+    { "util",               "estimatesmartfee",       &estimatesmartfee,       true,  RPC_LOCK_SHARED,    false },
+    { "util",               "estimatesmartpriority",  &estimatesmartpriority,  true,  RPC_LOCK_SHARED,    false },
 
     /* Not shown in help */
-    { "hidden",             "invalidateblock",        &invalidateblock,        true  },
-    { "hidden",             "reconsiderblock",        &reconsiderblock,        true  },
-    { "hidden",             "setmocktime",            &setmocktime,            true  },
+    { "hidden",             "invalidateblock",        &invalidateblock,        true,  RPC_LOCK_EXCLUSIVE, false },
+    { "hidden",             "reconsiderblock",        &reconsiderblock,        true,  RPC_LOCK_EXCLUSIVE, false },
+    { "hidden",             "setmocktime",            &setmocktime,            true,  RPC_LOCK_EXCLUSIVE, false },
 #ifdef ENABLE_WALLET
-    { "hidden",             "resendwallettransactions", &resendwallettransactions, true},
+    { "hidden",             "resendwallettransactions", &resendwallettransactions, true,  RPC_LOCK_EXCLUSIVE, true  },
 #endif
 
     /* Dynamic features */
-    { "dynamic",               "dynode",              &dynode,              true  },
-    { "dynamic",               "dynodelist",          &dynodelist,          true  },
-    { "dynamic",               "dynodebroadcast",     &dynodebroadcast,    true  },
-    { "dynamic",               "gobject",                &gobject,                true  },
-    { "dynamic",               "getgovernanceinfo",      &getgovernanceinfo,      true  },
-    { "dynamic",               "getsuperblockbudget",    &getsuperblockbudget,    true  },
-    { "dynamic",               "voteraw",                &voteraw,                true  },
-    { "dynamic",               "dnsync",                 &dnsync,                 true  },
-    { "dynamic",               "spork",                  &spork,                  true  },
-    { "dynamic",               "getpoolinfo",            &getpoolinfo,            true  },
+    { "dynamic",               "dynode",              &dynode,              true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "dynamic",               "dynodelist",          &dynodelist,          true,  RPC_LOCK_SHARED,    false },
+    { "dynamic",               "dynodebroadcast",     &dynodebroadcast,    true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "dynamic",               "gobject",                &gobject,                true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "dynamic",               "getgovernanceinfo",      &getgovernanceinfo,      true,  RPC_LOCK_SHARED,    false },
+    { "dynamic",               "getsuperblockbudget",    &getsuperblockbudget,    true,  RPC_LOCK_SHARED,    false },
+    { "dynamic",               "voteraw",                &voteraw,                true,  RPC_LOCK_EXCLUSIVE, false },
+    { "dynamic",               "dnsync",                 &dnsync,                 true,  RPC_LOCK_EXCLUSIVE, false },
+    { "dynamic",               "spork",                  &spork,                  true,  RPC_LOCK_EXCLUSIVE, false },
+    { "dynamic",               "getpoolinfo",            &getpoolinfo,            true,  RPC_LOCK_SHARED,    true  },
+    { "dynamic",               "getmaintenanceinfo",     &getmaintenanceinfo,     true,  RPC_LOCK_NONE,      false },
 #ifdef ENABLE_WALLET
-    { "dynamic",               "privatesend",            &privatesend,            false },
+    { "dynamic",               "privatesend",            &privatesend,            false, RPC_LOCK_EXCLUSIVE, true  },
 
     /* Wallet */
-    { "wallet",             "keepass",                &keepass,                true },
-    { "wallet",             "instantsendtoaddress",   &instantsendtoaddress,   false },
-    { "wallet",             "addmultisigaddress",     &addmultisigaddress,     true  },
-    { "wallet",             "backupwallet",           &backupwallet,           true  },
-    { "wallet",             "dumpprivkey",            &dumpprivkey,            true  },
-    { "wallet",             "dumpwallet",             &dumpwallet,             true  },
-    { "wallet",             "encryptwallet",          &encryptwallet,          true  },
-    { "wallet",             "getaccountaddress",      &getaccountaddress,      true  },
-    { "wallet",             "getaccount",             &getaccount,             true  },
-    { "wallet",             "getaddressesbyaccount",  &getaddressesbyaccount,  true  },
-    { "wallet",             "getbalance",             &getbalance,             false },
-    { "wallet",             "getnewaddress",          &getnewaddress,          true  },
-    { "wallet",             "getrawchangeaddress",    &getrawchangeaddress,    true  },
-    { "wallet",             "getreceivedbyaccount",   &getreceivedbyaccount,   false },
-    { "wallet",             "getreceivedbyaddress",   &getreceivedbyaddress,   false },
-    { "wallet",             "gettransaction",         &gettransaction,         false },
-    { "wallet",             "abandontransaction",     &abandontransaction,     false },
-    { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false },
-    { "wallet",             "getwalletinfo",          &getwalletinfo,          false },
-    { "wallet",             "importprivkey",          &importprivkey,          true  },
-    { "wallet",             "importwallet",           &importwallet,           true  },
-    { "wallet",             "importaddress",          &importaddress,          true  },
-    { "wallet",             "importpubkey",           &importpubkey,           true  },
-    { "wallet",             "keypoolrefill",          &keypoolrefill,          true  },
-    { "wallet",             "listaccounts",           &listaccounts,           false },
-    { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false },
-    { "wallet",             "listlockunspent",        &listlockunspent,        false },
-    { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false },
-    { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false },
-    { "wallet",             "listsinceblock",         &listsinceblock,         false },
-    { "wallet",             "listtransactions",       &listtransactions,       false },
-    { "wallet",             "listunspent",            &listunspent,            false },
-    { "wallet",             "lockunspent",            &lockunspent,            true  },
-    { "wallet",             "move",                   &movecmd,                false },
-    { "wallet",             "sendfrom",               &sendfrom,               false },
-    { "wallet",             "sendmany",               &sendmany,               false },
-    { "wallet",             "sendtoaddress",          &sendtoaddress,          false },
-    { "wallet",             "setaccount",             &setaccount,             true  },
-    { "wallet",             "settxfee",               &settxfee,               true  },
-    { "wallet",             "signmessage",            &signmessage,            true  },
-    { "wallet",             "walletlock",             &walletlock,             true  },
-    { "wallet",             "walletpassphrasechange", &walletpassphrasechange, true  },
-    { "wallet",             "walletpassphrase",       &walletpassphrase,       true  },
+    { "wallet",             "keepass",                &keepass,                true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "instantsendtoaddress",   &instantsendtoaddress,   false, RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "addmultisigaddress",     &addmultisigaddress,     true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "backupwallet",           &backupwallet,           true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "dumpprivkey",            &dumpprivkey,            true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "dumpwallet",             &dumpwallet,             true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "encryptwallet",          &encryptwallet,          true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "getaccountaddress",      &getaccountaddress,      true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "getaccount",             &getaccount,             true,  RPC_LOCK_SHARED,    true  },
+    { "wallet",             "getaddressesbyaccount",  &getaddressesbyaccount,  true,  RPC_LOCK_SHARED,    true  },
+    { "wallet",             "getbalance",             &getbalance,             false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "getnewaddress",          &getnewaddress,          true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "getrawchangeaddress",    &getrawchangeaddress,    true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "getreceivedbyaccount",   &getreceivedbyaccount,   false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "getreceivedbyaddress",   &getreceivedbyaddress,   false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "gettransaction",         &gettransaction,         false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "abandontransaction",     &abandontransaction,     false, RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "getwalletinfo",          &getwalletinfo,          false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "importprivkey",          &importprivkey,          true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "importwallet",           &importwallet,           true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "importaddress",          &importaddress,          true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "importpubkey",           &importpubkey,           true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "keypoolrefill",          &keypoolrefill,          true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "listaccounts",           &listaccounts,           false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listlockunspent",        &listlockunspent,        false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listsinceblock",         &listsinceblock,         false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listtransactions",       &listtransactions,       false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "listunspent",            &listunspent,            false, RPC_LOCK_SHARED,    true  },
+    { "wallet",             "lockunspent",            &lockunspent,            true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "move",                   &movecmd,                false, RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "sendfrom",               &sendfrom,               false, RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "sendmany",               &sendmany,               false, RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "sendtoaddress",          &sendtoaddress,          false, RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "setaccount",             &setaccount,             true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "settxfee",               &settxfee,               true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "signmessage",            &signmessage,            true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "walletlock",             &walletlock,             true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "walletpassphrasechange", &walletpassphrasechange, true,  RPC_LOCK_EXCLUSIVE, true  },
+    { "wallet",             "walletpassphrase",       &walletpassphrase,       true,  RPC_LOCK_EXCLUSIVE, true  },
 #endif // ENABLE_WALLET
 };
 
+/**
+ * Methods with large results that the JSON-RPC server writes out while they
+ * are produced. Help, batches and other callers still use the actor above.
+ * getblock is not one of them: its result has to be built whole for the
+ * response cache anyway, and like every other result it is written out in
+ * chunks by JSONRPCWriteReply.
+ */
+static const struct {
+    const char* name;
+    rpcstreamfn_type streamActor;
+} vRPCStreamCommands[] =
+{ //  name                      streamActor
+  //  ------------------------  -----------------------
+    { "getrawmempool",          &getrawmempool },
+    { "getaddressmempool",      &getaddressmempool },
+    { "getaddressutxos",        &getaddressutxos },
+    { "getaddressdeltas",       &getaddressdeltas },
+    { "getaddrepstxids",        &getaddrepstxids },
+    { "dynodelist",             &dynodelist },
+    { "gobject",                &gobject },
+};
+
 CRPCTable::CRPCTable()
 {
     unsigned int vcidx;
@@ -416,6 +442,8 @@ CRPCTable::CRPCTable()
         pcmd = &vRPCCommands[vcidx];
         mapCommands[pcmd->name] = pcmd;
     }
+    for (vcidx = 0; vcidx < (sizeof(vRPCStreamCommands) / sizeof(vRPCStreamCommands[0])); vcidx++)
+        mapStreamActors[vRPCStreamCommands[vcidx].name] = vRPCStreamCommands[vcidx].streamActor;
 }
 
 const CRPCCommand *CRPCTable::operator[](const std::string &name) const
@@ -524,20 +552,137 @@ static UniValue JSONRPCExecOne(const UniValue& req)
         rpc_result = JSONRPCReplyObj(NullUniValue,
                                      JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
     }
+    catch (...)
+    {
+        // e.g. boost::thread_interrupted, the other calls of the batch still get their replies
+        rpc_result = JSONRPCReplyObj(NullUniValue,
+                                     JSONRPCError(RPC_INTERNAL_ERROR, "Unknown exception"), jreq.id);
+    }
 
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+/**
+ * Calls of a batch that run together. The thread serving the batch takes calls in turn
+ * with the HTTP workers that help it, so it never waits for a call nobody has started.
+ * Helpers that come late find nothing left and only touch the counters.
+ */
+class CRPCBatchRun
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    const UniValue* pvReq;
+    UniValue* pReplies;
+    unsigned int nBegin;
+    unsigned int nCalls;
+    unsigned int nNext;
+    unsigned int nDone;
+
+public:
+    CRPCBatchRun(const UniValue& vReq, unsigned int nBeginIn, std::vector<UniValue>& vReplies) :
+        pvReq(&vReq), pReplies(&vReplies[0]), nBegin(nBeginIn), nCalls(vReplies.size()), nNext(0), nDone(0) {}
+
+    /** Run calls until none are left to start */
+    void Run()
+    {
+        while (true) {
+            unsigned int i;
+            {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                if (nNext == nCalls)
+                    return;
+                i = nNext++;
+            }
+            pReplies[i] = JSONRPCExecOne((*pvReq)[nBegin + i]);
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if (++nDone == nCalls)
+                cond.notify_all();
+        }
+    }
+
+    /** Wait for the calls the helpers started, the replies are theirs until then */
+    void Wait()
+    {
+        boost::this_thread::disable_interruption noInterrupt;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (nDone < nCalls)
+            cond.wait(lock);
+    }
+};
+
+/** Runs calls of a batch on an HTTP worker */
+class CRPCBatchHelper : public HTTPClosure
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+private:
+    boost::shared_ptr<CRPCBatchRun> run;
+
+public:
+    CRPCBatchHelper(const boost::shared_ptr<CRPCBatchRun>& runIn) : run(runIn) {}
+
+    void operator()()
+    {
+        run->Run();
+    }
+};
 
-    return ret.write() + "\n";
+/** Calls of a batch that are run together, bounds how many replies are held before they are written */
+static const unsigned int MAX_BATCH_CALLS_IN_FLIGHT = 256;
+
+static RPCLockClass GetLockClass(const UniValue& req)
+{
+    // Malformed calls and unknown methods only make an error reply
+    if (!req.isObject())
+        return RPC_LOCK_NONE;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    if (!method.isStr())
+        return RPC_LOCK_NONE;
+    const CRPCCommand *pcmd = tableRPC[method.get_str()];
+    if (!pcmd)
+        return RPC_LOCK_NONE;
+    return pcmd->lockClass;
 }
 
-UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
+void JSONRPCExecBatch(const UniValue& vReq, CJSONStreamWriter& writer)
+{
+    writer.BeginArray();
+    unsigned int reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        // Consecutive calls that don't need exclusive access run side by side,
+        // an exclusive one waits for the calls before it and runs alone.
+        unsigned int reqEnd = reqIdx;
+        while (reqEnd < vReq.size() && reqEnd - reqIdx < MAX_BATCH_CALLS_IN_FLIGHT &&
+               GetLockClass(vReq[reqEnd]) != RPC_LOCK_EXCLUSIVE)
+            reqEnd++;
+
+        if (reqEnd - reqIdx < 2) {
+            writer.Write(JSONRPCExecOne(vReq[reqIdx]));
+            reqIdx++;
+            continue;
+        }
+
+        std::vector<UniValue> vReplies(reqEnd - reqIdx);
+        {
+            // Idle HTTP workers help, we take our share of the calls too
+            boost::shared_ptr<CRPCBatchRun> run(new CRPCBatchRun(vReq, reqIdx, vReplies));
+            int nHelpers = std::min((int)vReplies.size(), (int)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS)) - 1;
+            for (int i = 0; i < nHelpers; i++)
+                if (!QueueHTTPWork(new CRPCBatchHelper(run)))
+                    break;
+            run->Run();
+            run->Wait();
+        }
+
+        BOOST_FOREACH(const UniValue& reply, vReplies)
+            writer.Write(reply);
+        reqIdx = reqEnd;
+    }
+    writer.EndArray();
+    writer.WriteRaw("\n");
+}
+
+/** Everything that comes before running a method, returns the method */
+static const CRPCCommand* PrepareCommand(const std::string &strMethod)
 {
     // Return immediately if in warmup
     {
@@ -553,6 +698,17 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    // Let wallet calls see every transaction and block validated before them
+    if (pcmd->usesWallet)
+        SyncWithValidationInterfaceQueue();
+
+    return pcmd;
+}
+
+UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
+{
+    const CRPCCommand *pcmd = PrepareCommand(strMethod);
+
     try
     {
         // Execute
@@ -566,6 +722,38 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+bool CRPCTable::executeStream(const std::string &strMethod, const UniValue &params, const UniValue &id, CJSONStreamWriter& writer) const
+{
+    std::map<std::string, rpcstreamfn_type>::const_iterator it = mapStreamActors.find(strMethod);
+    if (it == mapStreamActors.end())
+        return false;
+
+    const CRPCCommand *pcmd = PrepareCommand(strMethod);
+
+    // The stream actors throw before writing their result, so on an error only
+    // the start of the reply is left in the writer's buffer, never sent
+    writer.BeginObject();
+    writer.WriteKey("result");
+    try
+    {
+        // Execute
+        it->second(params, writer);
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+    writer.WriteKey("error");
+    writer.Write(NullUniValue);
+    writer.WriteKey("id");
+    writer.Write(id);
+    writer.EndObject();
+    writer.WriteRaw("\n");
+
+    g_rpcSignals.PostCommand(*pcmd);
+    return true;
+}
+
 std::vector<std::string> CRPCTable::listCommands() const
 {
     std::vector<std::string> commandList;
@@ -114,6 +114,16 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
+//! Writes the result as it is produced instead of returning it, the same text the actor's result would give
+typedef void(*rpcstreamfn_type)(const UniValue& params, CJSONStreamWriter& writer);
+
+/** What a method needs to be left alone with, so batches know which calls can run side by side */
+enum RPCLockClass
+{
+    RPC_LOCK_EXCLUSIVE = 0, //! may change node, chain or wallet state: runs alone and in order
+    RPC_LOCK_SHARED,        //! only reads chain, mempool, net or wallet state under the locks it takes itself
+    RPC_LOCK_NONE,          //! touches no shared state at all
+};
 
 class CRPCCommand
 {
@@ -122,6 +132,8 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    RPCLockClass lockClass;
+    bool usesWallet; //! reads or changes pwalletMain, so waits for queued validation notifications first
 };
 
 /**
@@ -131,6 +143,7 @@ class CRPCTable
 {
 private:
     std::map<std::string, const CRPCCommand*> mapCommands;
+    std::map<std::string, rpcstreamfn_type> mapStreamActors;
 public:
     CRPCTable();
     const CRPCCommand* operator[](const std::string& name) const;
@@ -145,6 +158,17 @@ public:
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
 
+    /**
+     * Execute a method that can stream its result, and write the whole reply.
+     * @param method   Method to execute
+     * @param params   UniValue Array of arguments (JSON objects)
+     * @param id       Request id for the reply
+     * @param writer   Writer that gets the same reply object as JSONRPCWriteReply()
+     * @returns false, having written nothing, for methods that only return a UniValue.
+     * @throws an exception (UniValue) when an error happens, before any of the result is written.
+     */
+    bool executeStream(const std::string &method, const UniValue &params, const UniValue &id, CJSONStreamWriter& writer) const;
+
     /**
     * Returns a list of registered commands
     * @returns List of registered commands.
@@ -175,9 +199,13 @@ extern void EnsureWalletIsUnlocked();
 
 extern UniValue getconnectioncount(const UniValue& params, bool fHelp); // in rpcnet.cpp
 extern UniValue getaddressmempool(const UniValue& params, bool fHelp);
+extern void getaddressmempool(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue getaddressutxos(const UniValue& params, bool fHelp);
+extern void getaddressutxos(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue getaddressdeltas(const UniValue& params, bool fHelp);
+extern void getaddressdeltas(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue getaddrepstxids(const UniValue& params, bool fHelp);
+extern void getaddrepstxids(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue getaddressbalance(const UniValue& params, bool fHelp);
 
 extern UniValue getpeerinfo(const UniValue& params, bool fHelp);
@@ -186,6 +214,7 @@ extern UniValue addnode(const UniValue& params, bool fHelp);
 extern UniValue disconnectnode(const UniValue& params, bool fHelp);
 extern UniValue getaddednodeinfo(const UniValue& params, bool fHelp);
 extern UniValue getnettotals(const UniValue& params, bool fHelp);
+extern UniValue gethttpstats(const UniValue& params, bool fHelp);
 extern UniValue setban(const UniValue& params, bool fHelp);
 extern UniValue listbanned(const UniValue& params, bool fHelp);
 extern UniValue clearbanned(const UniValue& params, bool fHelp);
@@ -270,11 +299,14 @@ extern UniValue verifytxoutproof(const UniValue& params, bool fHelp);
 
 extern UniValue privatesend(const UniValue& params, bool fHelp);
 extern UniValue getpoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getmaintenanceinfo(const UniValue& params, bool fHelp);
 extern UniValue spork(const UniValue& params, bool fHelp);
 extern UniValue dynode(const UniValue& params, bool fHelp);
 extern UniValue dynodelist(const UniValue& params, bool fHelp);
+extern void dynodelist(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue dynodebroadcast(const UniValue& params, bool fHelp);
 extern UniValue gobject(const UniValue& params, bool fHelp);
+extern void gobject(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue getgovernanceinfo(const UniValue& params, bool fHelp);
 extern UniValue getsuperblockbudget(const UniValue& params, bool fHelp);
 extern UniValue voteraw(const UniValue& params, bool fHelp);
@@ -286,6 +318,7 @@ extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
+extern void getrawmempool(const UniValue& params, CJSONStreamWriter& writer);
 extern UniValue getblockhashes(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblockheader(const UniValue& params, bool fHelp);
@@ -302,6 +335,10 @@ extern UniValue getspentinfo(const UniValue& params, bool fHelp);
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const UniValue& vReq);
+/**
+ * Run a batch of requests, streaming the replies in request order. Calls that
+ * don't need exclusive access are spread over the batch worker threads.
+ */
+void JSONRPCExecBatch(const UniValue& vReq, CJSONStreamWriter& writer);
 
 #endif // DYNAMIC_RPCSERVER_H
@@ -7,7 +7,10 @@
 
 #include "scheduler.h"
 
+#include "random.h"
 #include "reverselock.h"
+#include "util.h"
+#include "utiltime.h"
 
 #include <assert.h>
 #include <boost/bind.hpp>
@@ -122,6 +125,48 @@ void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds)
     scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds), deltaSeconds);
 }
 
+void CScheduler::runTimed(CScheduler::Function f, const std::string& strName)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    f();
+    int64_t nElapsed = GetTimeMicros() - nTimeStart;
+
+    boost::unique_lock<boost::mutex> lock(statsMutex);
+    TaskStats& stats = mapTaskStats[strName];
+    stats.nRuns++;
+    stats.nTotalMicros += nElapsed;
+    stats.nLastMicros = nElapsed;
+    if (nElapsed > stats.nMaxMicros)
+        stats.nMaxMicros = nElapsed;
+    LogPrint("bench", "CScheduler: %s took %.2fms (avg %.2fms over %d runs)\n", strName,
+             nElapsed * 0.001, stats.nTotalMicros * 0.001 / stats.nRuns, stats.nRuns);
+}
+
+void CScheduler::repeatTimed(CScheduler::Function f, int64_t deltaSeconds, const std::string& strName, int64_t nJitterSeconds)
+{
+    runTimed(f, strName);
+    scheduleEvery(f, deltaSeconds, strName, nJitterSeconds);
+}
+
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds, const std::string& strName)
+{
+    scheduleFromNow(boost::bind(&CScheduler::runTimed, this, f, strName), deltaSeconds);
+}
+
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds, const std::string& strName, int64_t nJitterSeconds)
+{
+    int64_t nDelay = deltaSeconds;
+    if (nJitterSeconds > 0)
+        nDelay += GetRand(nJitterSeconds + 1);
+    scheduleFromNow(boost::bind(&CScheduler::repeatTimed, this, f, deltaSeconds, strName, nJitterSeconds), nDelay);
+}
+
+std::map<std::string, CScheduler::TaskStats> CScheduler::getTaskStats() const
+{
+    boost::unique_lock<boost::mutex> lock(statsMutex);
+    return mapTaskStats;
+}
+
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
                              boost::chrono::system_clock::time_point &last) const
 {
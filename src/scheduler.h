@@ -17,6 +17,7 @@
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
 #include <map>
+#include <string>
 
 //
 // Simple class for background tasks that should be run
@@ -57,6 +58,13 @@ public:
     // need more accurate scheduling, don't use this method.
     void scheduleEvery(Function f, int64_t deltaSeconds);
 
+    // Named variants of the above. The runtime of every run is
+    // recorded under strName (see getTaskStats). scheduleEvery adds a
+    // random delay of up to nJitterSeconds each time the task is
+    // rescheduled, so tasks sharing a period don't all fire together.
+    void scheduleFromNow(Function f, int64_t deltaSeconds, const std::string& strName);
+    void scheduleEvery(Function f, int64_t deltaSeconds, const std::string& strName, int64_t nJitterSeconds = 0);
+
     // To keep things as simple as possible, there is no unschedule.
 
     // Services the queue 'forever'. Should be run in a thread,
@@ -73,7 +81,24 @@ public:
     size_t getQueueInfo(boost::chrono::system_clock::time_point &first,
                         boost::chrono::system_clock::time_point &last) const;
 
+    struct TaskStats {
+        int64_t nRuns;
+        int64_t nTotalMicros;
+        int64_t nMaxMicros;
+        int64_t nLastMicros;
+        TaskStats() : nRuns(0), nTotalMicros(0), nMaxMicros(0), nLastMicros(0) {}
+    };
+
+    // Returns runtime statistics of the named tasks, keyed by name
+    std::map<std::string, TaskStats> getTaskStats() const;
+
 private:
+    void runTimed(Function f, const std::string& strName);
+    void repeatTimed(Function f, int64_t deltaSeconds, const std::string& strName, int64_t nJitterSeconds);
+
+    std::map<std::string, TaskStats> mapTaskStats;
+    mutable boost::mutex statsMutex;
+
     std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
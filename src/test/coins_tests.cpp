@@ -7,6 +7,7 @@
 #include "uint256.h"
 #include "test/test_dynamic.h"
 #include "main.h"
+#include "txdb.h"
 #include "consensus/validation.h"
 
 #include <vector>
@@ -347,4 +348,209 @@ BOOST_AUTO_TEST_CASE(updatecoins_simulation_test)
     BOOST_CHECK(spent_a_duplicate_coinbase);
 }
 
+
+BOOST_FIXTURE_TEST_CASE(coins_db_async_write, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true, false, true);
+    uint256 hashBlock = GetRandHash();
+    uint256 txidAdd = GetRandHash();
+    uint256 txidSpend = GetRandHash();
+
+    // Write one entry, then flush a second snapshot that adds another and spends the first.
+    {
+        CCoinsViewCache cache(&db);
+        {
+            CCoinsModifier coins = cache.ModifyNewCoins(txidSpend);
+            coins->vout.resize(1);
+            coins->vout[0].nValue = 5;
+        }
+        BOOST_CHECK(cache.Flush());
+    }
+    {
+        CCoinsViewCache cache(&db);
+        {
+            CCoinsModifier coins = cache.ModifyNewCoins(txidAdd);
+            coins->vout.resize(2);
+            coins->vout[1].nValue = 7;
+        }
+        cache.ModifyCoins(txidSpend)->Spend(0);
+        cache.SetBestBlock(hashBlock);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // Reads see the flushed state whether or not the writer has finished.
+    CCoins coins;
+    BOOST_CHECK(db.GetCoins(txidAdd, coins));
+    BOOST_CHECK_EQUAL(coins.vout[1].nValue, 7);
+    BOOST_CHECK(!db.HaveCoins(txidSpend));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+
+    BOOST_CHECK(db.WaitForWrite());
+    BOOST_CHECK(db.GetCoins(txidAdd, coins));
+    BOOST_CHECK(!db.GetCoins(txidSpend, coins));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+}
+
+
+BOOST_FIXTURE_TEST_CASE(coins_prefetch, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewPrefetch prefetch(&db, 2);
+
+    CMutableTransaction funding;
+    funding.vin.resize(1);
+    funding.vout.resize(1);
+    funding.vout[0].nValue = 11;
+    {
+        CCoinsViewCache cache(&prefetch);
+        cache.ModifyNewCoins(funding.GetHash())->FromTx(funding, 1);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // A block spending the funding output and one created within the block itself.
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(funding.GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 10;
+    CMutableTransaction chained;
+    chained.vin.resize(1);
+    chained.vin[0].prevout = COutPoint(spend.GetHash(), 0);
+    chained.vout.resize(1);
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+    CBlock block;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(spend);
+    block.vtx.push_back(chained);
+    prefetch.Prefetch(block, 1);
+
+    // Lookups return the database state whether or not the workers got there first.
+    {
+        CCoinsViewCache cache(&prefetch);
+        const CCoins* coins = cache.AccessCoins(funding.GetHash());
+        BOOST_CHECK(coins && coins->IsAvailable(0));
+        cache.ModifyCoins(funding.GetHash())->Spend(0);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // A write must not leave a stale prefetched copy behind.
+    prefetch.Prefetch(block, 1);
+    CCoinsViewCache cache(&prefetch);
+    BOOST_CHECK(!cache.HaveCoins(funding.GetHash()));
+}
+
+static CBlock PrefetchTestBlock(int nInputs)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+    block.vtx.push_back(coinbase);
+    CMutableTransaction spend;
+    spend.vin.resize(nInputs);
+    for (int i = 0; i < nInputs; i++)
+        spend.vin[i].prevout = COutPoint(GetRandHash(), 0);
+    spend.vout.resize(1);
+    block.vtx.push_back(spend);
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(coins_prefetch_bound)
+{
+    // No worker threads, so the lookups stay queued
+    CCoinsViewTest base;
+    CCoinsViewPrefetch prefetch(&base, 0, 10);
+
+    CBlock blockStale = PrefetchTestBlock(6);
+    CBlock blockNext = PrefetchTestBlock(6);
+    prefetch.Prefetch(blockStale, 5);
+    BOOST_CHECK_EQUAL(prefetch.GetSize(), 6);
+    // The bound is reached part way into the second block
+    prefetch.Prefetch(blockNext, 6);
+    BOOST_CHECK_EQUAL(prefetch.GetSize(), 10);
+
+    // Once the tip passes a block that was never connected, its room is given back
+    prefetch.UpdatedTip(5);
+    BOOST_CHECK_EQUAL(prefetch.GetSize(), 4);
+    CBlock blockLater = PrefetchTestBlock(6);
+    prefetch.Prefetch(blockLater, 7);
+    BOOST_CHECK_EQUAL(prefetch.GetSize(), 10);
+
+    // So is that of a rejected block
+    prefetch.BlockRejected(blockLater.GetHash());
+    BOOST_CHECK_EQUAL(prefetch.GetSize(), 4);
+    prefetch.UpdatedTip(6);
+    BOOST_CHECK_EQUAL(prefetch.GetSize(), 0);
+}
+
+namespace
+{
+//! Coin database whose background writes can be made to fail.
+class CCoinsViewDBFailing : public CCoinsViewDB
+{
+public:
+    bool fFail;
+
+    CCoinsViewDBFailing() : CCoinsViewDB(1 << 20, true, false, true), fFail(false) {}
+
+protected:
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock)
+    {
+        if (fFail)
+            return false;
+        return CCoinsViewDB::WriteCoins(mapCoins, hashBlock);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_db_async_write_failure, TestingSetup)
+{
+    CCoinsViewDBFailing db;
+    uint256 hashBlock = GetRandHash();
+    uint256 hashBlock2 = GetRandHash();
+    uint256 txid = GetRandHash();
+    uint256 txid2 = GetRandHash();
+
+    // A snapshot whose write fails stays readable.
+    db.fFail = true;
+    {
+        CCoinsViewCache cache(&db);
+        {
+            CCoinsModifier coins = cache.ModifyNewCoins(txid);
+            coins->vout.resize(1);
+            coins->vout[0].nValue = 5;
+        }
+        cache.SetBestBlock(hashBlock);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(!db.WaitForWrite());
+    CCoins coins;
+    BOOST_CHECK(db.GetCoins(txid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 5);
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+
+    // The next flush reports the failure, but keeps both snapshots and retries them.
+    db.fFail = false;
+    {
+        CCoinsViewCache cache(&db);
+        {
+            CCoinsModifier coins = cache.ModifyNewCoins(txid2);
+            coins->vout.resize(1);
+            coins->vout[0].nValue = 7;
+        }
+        cache.SetBestBlock(hashBlock2);
+        BOOST_CHECK(!cache.Flush());
+    }
+    BOOST_CHECK(db.WaitForWrite());
+    BOOST_CHECK(db.GetCoins(txid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 5);
+    BOOST_CHECK(db.GetCoins(txid2, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 7);
+    BOOST_CHECK(db.GetBestBlock() == hashBlock2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
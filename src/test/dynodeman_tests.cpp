@@ -0,0 +1,99 @@
+// Copyright (c) 2016-2017 Duality Blockchain Solutions Ltd
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "dynodeman.h"
+#include "utiltime.h"
+#include "test/test_dynamic.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(dynodeman_tests, TestingSetup)
+
+static CDynode TestDynode(int n, int nActiveState)
+{
+    CDynode dn;
+    dn.vin = CTxIn(COutPoint(uint256S("0x1"), n));
+    dn.lastPing.sigTime = dn.sigTime;
+    dn.nActiveState = nActiveState;
+    dn.fUnitTest = true;
+    return dn;
+}
+
+static void CheckQueueSizes(CDynodeMan& man, int nDirty, int nTimed, int nUnban)
+{
+    int nDirtyRet, nTimedRet, nUnbanRet;
+    man.GetCheckQueueSizes(nDirtyRet, nTimedRet, nUnbanRet);
+    BOOST_CHECK_EQUAL(nDirtyRet, nDirty);
+    BOOST_CHECK_EQUAL(nTimedRet, nTimed);
+    BOOST_CHECK_EQUAL(nUnbanRet, nUnban);
+}
+
+BOOST_AUTO_TEST_CASE(dynodeman_dirty_check)
+{
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+
+    CDynodeMan man;
+    CDynode dn1 = TestDynode(1, CDynode::DYNODE_PRE_ENABLED);
+    CDynode dn2 = TestDynode(2, CDynode::DYNODE_PRE_ENABLED);
+    BOOST_CHECK(man.Add(dn1));
+    BOOST_CHECK(man.Add(dn2));
+    CheckQueueSizes(man, 2, 0, 0);
+
+    // The first check looks at everything and schedules when each Dynode can expire
+    man.Check();
+    CheckQueueSizes(man, 0, 2, 0);
+    BOOST_CHECK_EQUAL(man.Find(dn1.vin)->nTimeLastChecked, nTime);
+    BOOST_CHECK_EQUAL(man.Find(dn2.vin)->nTimeLastChecked, nTime);
+
+    // Nothing changed, nothing is checked
+    SetMockTime(nTime + 60);
+    man.Check();
+    BOOST_CHECK_EQUAL(man.Find(dn1.vin)->nTimeLastChecked, nTime);
+    BOOST_CHECK_EQUAL(man.Find(dn2.vin)->nTimeLastChecked, nTime);
+
+    // Only the dirty one is, and it is scheduled once
+    man.MarkDynodeDirty(dn1.vin.prevout);
+    man.Check();
+    CheckQueueSizes(man, 0, 2, 0);
+    BOOST_CHECK_EQUAL(man.Find(dn1.vin)->nTimeLastChecked, nTime + 60);
+    BOOST_CHECK_EQUAL(man.Find(dn2.vin)->nTimeLastChecked, nTime);
+
+    // Every FULL_CHECK_SECONDS all of them are
+    SetMockTime(nTime + 10 * 60);
+    man.Check();
+    BOOST_CHECK_EQUAL(man.Find(dn1.vin)->nTimeLastChecked, nTime + 10 * 60);
+    BOOST_CHECK_EQUAL(man.Find(dn2.vin)->nTimeLastChecked, nTime + 10 * 60);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(dynodeman_unban_heights)
+{
+    CDynodeMan man;
+    CDynode dn = TestDynode(3, CDynode::DYNODE_POSE_BAN);
+    dn.nPoSeBanHeight = 10;
+    BOOST_CHECK(man.Add(dn));
+
+    // Checking a banned Dynode again does not queue it again
+    for (int i = 0; i < 3; i++) {
+        man.MarkDynodeDirty(dn.vin.prevout);
+        man.Check();
+    }
+    CheckQueueSizes(man, 0, 0, 1);
+    BOOST_CHECK(man.Find(dn.vin)->IsPoSeBanned());
+
+    CBlockIndex index;
+    index.nHeight = 9;
+    man.UpdatedBlockTip(&index);
+    CheckQueueSizes(man, 0, 0, 1);
+
+    // The ban height marks it dirty for the next check
+    index.nHeight = 10;
+    man.UpdatedBlockTip(&index);
+    CheckQueueSizes(man, 1, 0, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
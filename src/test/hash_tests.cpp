@@ -47,4 +47,20 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(argon2d_mining)
+{
+    // The miner's single-threaded Argon2d with reused memory must find the
+    // same hashes as the one used for validation
+    unsigned char header[INPUT_BYTES];
+    for (unsigned int i = 0; i < sizeof(header); i++)
+        header[i] = i * 7;
+
+    for (unsigned int nPhase = 1; nPhase <= 2; nPhase++) {
+        for (unsigned char nNonce = 0; nNonce < 4; nNonce++) {
+            header[INPUT_BYTES - 4] = nNonce;
+            BOOST_CHECK(hash_Argon2d_Mining(header, nPhase) == hash_Argon2d(header, nPhase));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,10 +5,19 @@
 
 #include "chainparams.h"
 #include "main.h"
+#include "instantsend.h"
+#include "privatesend.h"
 
+#include "keystore.h"
+#include "script/sign.h"
+#include "script/standard.h"
 #include "test/test_dynamic.h"
 
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/signals2/signal.hpp>
+#include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(main_tests, TestingSetup)
@@ -29,4 +38,137 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+static void ReadChainState(boost::atomic<bool>& fStop, boost::atomic<int>& nReads, boost::atomic<int>& nErrors)
+{
+    while (!fStop) {
+        int nHeight;
+        uint256 hashTip;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_chainstate);
+            const CBlockIndex* pindex = chainActive.Tip();
+            nHeight = chainActive.Height();
+            hashTip = pindex->GetBlockHash();
+            if (pindex->nHeight != nHeight || mapBlockIndex.count(hashTip) == 0 ||
+                !(pindex->nStatus & BLOCK_HAVE_DATA) || !pindex->IsValid(BLOCK_VALID_TRANSACTIONS))
+                nErrors++;
+        }
+        // The tip may have moved on, but the block at that height stays the same
+        uint256 hashAtHeight;
+        if (!GetBlockHash(hashAtHeight, nHeight) || hashAtHeight != hashTip)
+            nErrors++;
+        nReads++;
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(chainstate_concurrent_readers, TestChain100Setup)
+{
+    boost::atomic<bool> fStop(false);
+    boost::atomic<int> nReads(0);
+    boost::atomic<int> nErrors(0);
+    boost::thread_group readers;
+    for (int i = 0; i < 4; i++)
+        readers.create_thread(boost::bind(&ReadChainState, boost::ref(fStop), boost::ref(nReads), boost::ref(nErrors)));
+
+    // Extend the chain while the readers run under the shared lock only
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    for (int i = 0; i < 10; i++)
+        CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptPubKey);
+
+    fStop = true;
+    readers.join_all();
+    BOOST_CHECK_EQUAL(chainActive.Height(), 110);
+    BOOST_CHECK(nReads > 0);
+    BOOST_CHECK_EQUAL(nErrors, 0);
+}
+
+static void CheckScriptChecks(const std::vector<CScriptCheck>& vChecks, const std::vector<char>& vfExpected)
+{
+    std::vector<char> vfValid;
+    RunScriptChecks(vChecks, vfValid);
+    BOOST_CHECK(vfValid == vfExpected);
+
+    // the same outcome without the script check threads
+    int nScriptCheckThreadsPrev = nScriptCheckThreads;
+    nScriptCheckThreads = 0;
+    RunScriptChecks(vChecks, vfValid);
+    nScriptCheckThreads = nScriptCheckThreadsPrev;
+    BOOST_CHECK(vfValid == vfExpected);
+}
+
+BOOST_AUTO_TEST_CASE(run_script_checks)
+{
+    CBasicKeyStore keystore;
+    std::vector<CScript> vScriptPubKeys;
+    CMutableTransaction tx;
+    for (int i = 0; i < 6; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        keystore.AddKey(key);
+        vScriptPubKeys.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+        tx.vin.push_back(CTxIn(COutPoint(uint256S("0x1"), i)));
+    }
+    tx.vout.push_back(CTxOut(COIN, vScriptPubKeys[0]));
+    for (int i = 0; i < 6; i++)
+        BOOST_CHECK(SignSignature(keystore, vScriptPubKeys[i], tx, i));
+
+    unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC;
+    {
+        const CTransaction txCheck(tx);
+        std::vector<CScriptCheck> vChecks;
+        for (int i = 0; i < 6; i++)
+            vChecks.push_back(CScriptCheck(vScriptPubKeys[i], txCheck, i, flags, false));
+        CheckScriptChecks(vChecks, std::vector<char>(6, true));
+    }
+
+    // a signature by another key and a garbage scriptSig among good ones
+    tx.vin[1].scriptSig = tx.vin[0].scriptSig;
+    tx.vin[4].scriptSig = CScript() << OP_0 << OP_0;
+    {
+        const CTransaction txCheck(tx);
+        std::vector<CScriptCheck> vChecks;
+        for (int i = 0; i < 6; i++)
+            vChecks.push_back(CScriptCheck(vScriptPubKeys[i], txCheck, i, flags, false));
+        std::vector<char> vfExpected(6, true);
+        vfExpected[1] = false;
+        vfExpected[4] = false;
+        CheckScriptChecks(vChecks, vfExpected);
+
+        // a single check does not go to the threads
+        std::vector<CScriptCheck> vSingle(1, CScriptCheck(vScriptPubKeys[4], txCheck, 4, flags, false));
+        CheckScriptChecks(vSingle, std::vector<char>(1, false));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(run_message_signature_checks)
+{
+    // InstantSend votes signed the way CTxLockVote::Sign does, checked against the dynode key
+    std::vector<CKey> vKeys;
+    std::vector<CTxLockVote> vVotes;
+    for (int i = 0; i < 4; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        vKeys.push_back(key);
+        CTxLockVote vote;
+        vote.txHash = GetRandHash();
+        vote.nBlockHeight = 100 + i;
+        std::string strMessage = vote.txHash.ToString() + boost::lexical_cast<std::string>(vote.nBlockHeight);
+        BOOST_CHECK(privateSendSigner.SignMessage(strMessage, vote.vchDyNodeSignature, key));
+        vVotes.push_back(vote);
+    }
+
+    std::vector<CScriptCheck> vChecks;
+    for (int i = 0; i < 4; i++)
+        vChecks.push_back(CScriptCheck(vVotes[i].GetSignatureHash(), vKeys[i].GetPubKey().GetID(), vVotes[i].vchDyNodeSignature));
+    CheckScriptChecks(vChecks, std::vector<char>(4, true));
+
+    // signed by another dynode, signed for another height and a garbage signature
+    vChecks[1] = CScriptCheck(vVotes[1].GetSignatureHash(), vKeys[0].GetPubKey().GetID(), vVotes[1].vchDyNodeSignature);
+    vVotes[2].nBlockHeight++;
+    vChecks[2] = CScriptCheck(vVotes[2].GetSignatureHash(), vKeys[2].GetPubKey().GetID(), vVotes[2].vchDyNodeSignature);
+    vChecks[3] = CScriptCheck(vVotes[3].GetSignatureHash(), vKeys[3].GetPubKey().GetID(), std::vector<unsigned char>(65, 0));
+    std::vector<char> vfExpected(4, false);
+    vfExpected[0] = true;
+    CheckScriptChecks(vChecks, vfExpected);
+}
 BOOST_AUTO_TEST_SUITE_END()
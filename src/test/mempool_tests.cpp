@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "random.h"
 #include "txmempool.h"
 #include "util.h"
 
@@ -473,4 +474,56 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+static std::vector<std::pair<uint256, MemPoolRemovalReason> > vRemoved;
+
+static void RecordRemoved(const CTransaction& tx, MemPoolRemovalReason reason)
+{
+    vRemoved.push_back(std::make_pair(tx.GetHash(), reason));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolRemovalReasonTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool(CFeeRate(0));
+    pool.NotifyEntryRemoved.connect(&RecordRemoved);
+
+    // Three unrelated transactions and one conflicting with the second
+    CMutableTransaction tx[4];
+    for (int i = 0; i < 4; i++) {
+        tx[i].vin.resize(1);
+        tx[i].vin[0].scriptSig = CScript() << OP_11;
+        tx[i].vin[0].prevout.hash = GetRandHash();
+        tx[i].vin[0].prevout.n = 0;
+        tx[i].vout.resize(1);
+        tx[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx[i].vout[0].nValue = 10000LL;
+    }
+    tx[3].vin[0].prevout = tx[1].vin[0].prevout;
+    tx[3].vout[0].nValue = 9000LL;
+
+    pool.addUnchecked(tx[0].GetHash(), entry.Time(1).FromTx(tx[0]));
+    pool.addUnchecked(tx[2].GetHash(), entry.Time(100).FromTx(tx[2]));
+    pool.addUnchecked(tx[3].GetHash(), entry.Time(100).FromTx(tx[3]));
+
+    vRemoved.clear();
+    pool.Expire(50);
+    BOOST_CHECK_EQUAL(vRemoved.size(), 1);
+    BOOST_CHECK(vRemoved[0].first == tx[0].GetHash());
+    BOOST_CHECK_EQUAL(vRemoved[0].second, MPR_EXPIRY);
+
+    // tx[1] gets mined instead of tx[3], along with tx[2]
+    vRemoved.clear();
+    std::vector<CTransaction> vtx;
+    vtx.push_back(CTransaction(tx[1]));
+    vtx.push_back(CTransaction(tx[2]));
+    std::list<CTransaction> conflicts;
+    pool.removeForBlock(vtx, 1, conflicts);
+    BOOST_CHECK_EQUAL(vRemoved.size(), 2);
+    BOOST_CHECK(vRemoved[0].first == tx[3].GetHash());
+    BOOST_CHECK_EQUAL(vRemoved[0].second, MPR_CONFLICT);
+    BOOST_CHECK(vRemoved[1].first == tx[2].GetHash());
+    BOOST_CHECK_EQUAL(vRemoved[1].second, MPR_BLOCK);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
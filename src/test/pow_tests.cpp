@@ -96,4 +96,27 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(GetNetworkHashRate_test)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = Params().GetConsensus();
+
+    std::vector<CBlockIndex> blocks(300);
+    for (int i = 0; i < 300; i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : NULL;
+        blocks[i].nHeight = i;
+        blocks[i].nTime = 1269211443 + i * params.nPowTargetSpacing;
+        blocks[i].nBits = 0x1d00ffff;
+        blocks[i].nChainWork = i ? blocks[i - 1].nChainWork + GetBlockProof(blocks[i - 1]) : arith_uint256(0);
+    }
+
+    BOOST_CHECK_EQUAL(GetBlockDifficulty(blocks[0]), 1.0);
+    double dExpected = GetBlockProof(blocks[0]).getdouble() / params.nPowTargetSpacing;
+    BOOST_CHECK_CLOSE(GetNetworkHashRate(&blocks[299], 120), dExpected, 0.0001);
+    BOOST_CHECK_CLOSE(GetNetworkHashRate(&blocks[299], 1), dExpected, 0.0001);
+    // Windows reaching past genesis stop there
+    BOOST_CHECK_CLOSE(GetNetworkHashRate(&blocks[10], 120), dExpected, 0.0001);
+    BOOST_CHECK_EQUAL(GetNetworkHashRate(&blocks[0], 120), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
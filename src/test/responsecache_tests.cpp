@@ -0,0 +1,105 @@
+// Copyright (c) 2016-2017 Duality Blockchain Solutions Ltd
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "responsecache.h"
+#include "test/test_dynamic.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(responsecache_tests, TestChain100Setup)
+
+static UniValue BlockReply(const CBlockIndex* pindex, int nConfirmations, bool fNext)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("hash", pindex->GetBlockHash().GetHex()));
+    obj.push_back(Pair("confirmations", nConfirmations));
+    obj.push_back(Pair("height", pindex->nHeight));
+    if (fNext)
+        obj.push_back(Pair("nextblockhash", std::string("stale")));
+    return obj;
+}
+
+BOOST_AUTO_TEST_CASE(responsecache_hits)
+{
+    CResponseCache cache;
+    CBlockIndex* pindex = chainActive[50];
+    UniValue val;
+
+    BOOST_CHECK(!cache.Get("a", val));
+    cache.Put("a", UniValue("deadbeef"), pindex->GetBlockHash());
+    BOOST_CHECK(cache.Get("a", val));
+    BOOST_CHECK_EQUAL(val.get_str(), "deadbeef");
+
+    // Chain position is filled in on every hit
+    cache.Put("b", BlockReply(pindex, 1, true), pindex->GetBlockHash());
+    BOOST_CHECK(cache.Get("b", val));
+    BOOST_CHECK_EQUAL(find_value(val, "confirmations").get_int(), chainActive.Height() - 50 + 1);
+    BOOST_CHECK_EQUAL(find_value(val, "nextblockhash").get_str(), chainActive[51]->GetBlockHash().GetHex());
+    BOOST_CHECK_EQUAL(find_value(val, "height").get_int(), 50);
+
+    // Too few confirmations, or not in a block of the active chain
+    cache.Put("c", UniValue("tip"), chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(!cache.Get("c", val));
+    cache.Put("d", UniValue("unknown"), uint256S("0x1"));
+    BOOST_CHECK(!cache.Get("d", val));
+
+    uint64_t nHits, nMisses;
+    size_t nEntries, nBytes;
+    cache.GetStats(nHits, nMisses, nEntries, nBytes);
+    BOOST_CHECK_EQUAL(nHits, 2U);
+    BOOST_CHECK_EQUAL(nMisses, 3U);
+    BOOST_CHECK_EQUAL(nEntries, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(responsecache_size_limit)
+{
+    CResponseCache cache;
+    uint256 hashBlock = chainActive[10]->GetBlockHash();
+    UniValue val;
+
+    cache.SetMaxSize(4096);
+    cache.Put("a", UniValue(std::string(1000, 'a')), hashBlock);
+    cache.Put("b", UniValue(std::string(1000, 'b')), hashBlock);
+    BOOST_CHECK(cache.Get("a", val)); // a is now the most recently used
+    cache.Put("c", UniValue(std::string(2000, 'c')), hashBlock);
+    BOOST_CHECK(cache.Get("a", val));
+    BOOST_CHECK(!cache.Get("b", val));
+    BOOST_CHECK(cache.Get("c", val));
+
+    // Larger than the whole cache
+    cache.Put("d", UniValue(std::string(5000, 'd')), hashBlock);
+    BOOST_CHECK(!cache.Get("d", val));
+
+    cache.SetMaxSize(0);
+    BOOST_CHECK(!cache.Get("a", val));
+    BOOST_CHECK(!cache.Get("c", val));
+}
+
+BOOST_AUTO_TEST_CASE(responsecache_reorg)
+{
+    CResponseCache cache;
+    CBlockIndex* pindex = chainActive[90];
+    UniValue val;
+
+    cache.Put("a", UniValue("below"), chainActive[80]->GetBlockHash());
+    cache.Put("b", UniValue("reorged"), pindex->GetBlockHash());
+    BOOST_CHECK(cache.Get("b", val));
+
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(InvalidateBlock(state, Params().GetConsensus(), pindex));
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_CHECK_EQUAL(chainActive.Height(), 89);
+
+    // Only entries at or above the fork are dropped
+    BOOST_CHECK(cache.Get("a", val));
+    BOOST_CHECK(!cache.Get("b", val));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,12 +6,19 @@
 #include "rpcclient.h"
 
 #include "base58.h"
+#include "chainparams.h"
+#include "main.h"
 #include "netbase.h"
+#include "privatesend.h"
+#include "scheduler.h"
 
 #include "test/test_dynamic.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 #include <univalue.h>
 
@@ -224,6 +231,215 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+static void AppendChunk(std::vector<std::string>& vChunks, const std::string& strChunk)
+{
+    vChunks.push_back(strChunk);
+}
+
+BOOST_AUTO_TEST_CASE(json_stream_writer)
+{
+    UniValue val;
+    BOOST_CHECK(val.read("{\"a\":[1,2.5,\"x\\\"y\",true,null,{}],\"b\\n\":{\"c\":[],\"d\":false}}"));
+
+    // A whole value comes out exactly like UniValue::write(), split in chunks of at least the chunk size
+    std::vector<std::string> vChunks;
+    CJSONStreamWriter writer(boost::bind(&AppendChunk, boost::ref(vChunks), _1), 8);
+    writer.Write(val);
+    writer.WriteRaw("\n");
+    std::string strRest = writer.TakeBuffered();
+    BOOST_CHECK(vChunks.size() > 1);
+    BOOST_FOREACH(const std::string& strChunk, vChunks)
+        BOOST_CHECK(strChunk.size() >= 8);
+    BOOST_CHECK_EQUAL(boost::algorithm::join(vChunks, "") + strRest, val.write() + "\n");
+
+    // Built member by member
+    vChunks.clear();
+    CJSONStreamWriter writer2(boost::bind(&AppendChunk, boost::ref(vChunks), _1));
+    writer2.BeginObject();
+    writer2.WriteKey("a");
+    writer2.BeginArray();
+    writer2.Write(val["a"][0]);
+    writer2.Write(val["a"][1]);
+    writer2.Write(val["a"][2]);
+    writer2.Write(val["a"][3]);
+    writer2.Write(val["a"][4]);
+    writer2.BeginObject();
+    writer2.EndObject();
+    writer2.EndArray();
+    writer2.WriteKey("b\n");
+    writer2.Write(val["b\n"]);
+    writer2.EndObject();
+    BOOST_CHECK(vChunks.empty());
+    BOOST_CHECK_EQUAL(writer2.TakeBuffered(), val.write());
+
+    // Same reply as JSONRPCReply
+    UniValue id("1");
+    CJSONStreamWriter writer3(boost::bind(&AppendChunk, boost::ref(vChunks), _1));
+    JSONRPCWriteReply(writer3, val, NullUniValue, id);
+    BOOST_CHECK_EQUAL(writer3.TakeBuffered(), JSONRPCReply(val, NullUniValue, id));
+    JSONRPCWriteReply(writer3, val, JSONRPCError(RPC_MISC_ERROR, "error"), id);
+    BOOST_CHECK_EQUAL(writer3.TakeBuffered(), JSONRPCReply(val, JSONRPCError(RPC_MISC_ERROR, "error"), id));
+}
+
+static UniValue BatchCall(const std::string& strMethod, const UniValue& params, int nId)
+{
+    UniValue req(UniValue::VOBJ);
+    req.push_back(Pair("method", strMethod));
+    req.push_back(Pair("params", params));
+    req.push_back(Pair("id", nId));
+    return req;
+}
+
+/** End the RPC warmup, in whichever of the tests needing that runs first */
+static void EndRPCWarmup()
+{
+    if (RPCIsInWarmup(NULL))
+        SetRPCWarmupFinished();
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch)
+{
+    BOOST_CHECK_EQUAL(tableRPC["getblockhash"]->lockClass, RPC_LOCK_SHARED);
+    BOOST_CHECK_EQUAL(tableRPC["decodescript"]->lockClass, RPC_LOCK_NONE);
+    BOOST_CHECK_EQUAL(tableRPC["stop"]->lockClass, RPC_LOCK_EXCLUSIVE);
+
+    EndRPCWarmup();
+
+    // Runs of shared calls split by an exclusive one, an unknown method and a malformed call
+    UniValue params(UniValue::VARR);
+    params.push_back(0);
+    UniValue vReq(UniValue::VARR);
+    for (int i = 0; i < 600; i++) {
+        if (i == 100)
+            vReq.push_back(BatchCall("setmocktime", params, i));
+        else if (i == 200)
+            vReq.push_back(BatchCall("nosuchmethod", params, i));
+        else if (i == 300)
+            vReq.push_back("notacall");
+        else if (i % 2)
+            vReq.push_back(BatchCall("getblockhash", params, i));
+        else
+            vReq.push_back(BatchCall("getblockcount", NullUniValue, i));
+    }
+
+    // Replies come in request order and match the calls run on their own
+    std::vector<std::string> vChunks;
+    CJSONStreamWriter writer(boost::bind(&AppendChunk, boost::ref(vChunks), _1));
+    JSONRPCExecBatch(vReq, writer);
+    UniValue vReplies;
+    BOOST_CHECK(vReplies.read(boost::algorithm::join(vChunks, "") + writer.TakeBuffered()));
+    BOOST_CHECK_EQUAL(vReplies.size(), vReq.size());
+    for (unsigned int i = 0; i < vReq.size(); i++) {
+        UniValue vOne(UniValue::VARR);
+        vOne.push_back(vReq[i]);
+        CJSONStreamWriter writerOne(boost::bind(&AppendChunk, boost::ref(vChunks), _1));
+        JSONRPCExecBatch(vOne, writerOne);
+        UniValue vReply;
+        BOOST_CHECK(vReply.read(writerOne.TakeBuffered()));
+        BOOST_CHECK_EQUAL(vReplies[i].write(), vReply[0].write());
+    }
+    BOOST_CHECK_EQUAL(find_value(vReplies[1], "result").get_str(), Params().GenesisBlock().GetHash().GetHex());
+    BOOST_CHECK(!find_value(vReplies[100], "error").isNull());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_uses_wallet)
+{
+    // Calls that read the wallet outside the wallet category wait for the validation queue too
+    BOOST_CHECK(tableRPC["signrawtransaction"]->usesWallet);
+    BOOST_CHECK(tableRPC["validateaddress"]->usesWallet);
+    BOOST_CHECK(tableRPC["dynode"]->usesWallet);
+    BOOST_CHECK(tableRPC["gobject"]->usesWallet);
+    BOOST_CHECK(!tableRPC["getblockhash"]->usesWallet);
+    BOOST_CHECK(!tableRPC["decoderawtransaction"]->usesWallet);
+#ifdef ENABLE_WALLET
+    BOOST_CHECK(tableRPC["fundrawtransaction"]->usesWallet);
+    BOOST_CHECK(tableRPC["privatesend"]->usesWallet);
+    BOOST_CHECK(tableRPC["getbalance"]->usesWallet);
+#endif
+}
+
+static std::string StreamRPC(const std::string& strMethod, const UniValue& params, const UniValue& id, size_t nChunkSize)
+{
+    std::vector<std::string> vChunks;
+    CJSONStreamWriter writer(boost::bind(&AppendChunk, boost::ref(vChunks), _1), nChunkSize);
+    BOOST_CHECK(tableRPC.executeStream(strMethod, params, id, writer));
+    return boost::algorithm::join(vChunks, "") + writer.TakeBuffered();
+}
+
+BOOST_AUTO_TEST_CASE(rpc_stream)
+{
+    EndRPCWarmup();
+    TestMemPoolEntryHelper entry;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(uint256S("0x1"), i);
+        tx.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+        mempool.addUnchecked(tx.GetHash(), entry.Fee(1000 * (i + 1)).FromTx(tx));
+    }
+
+    // Streamed the same as the reply to what the actor returns, in small chunks too
+    UniValue id("1");
+    UniValue params(UniValue::VARR);
+    BOOST_CHECK_EQUAL(StreamRPC("getrawmempool", params, id, 16), JSONRPCReply(tableRPC.execute("getrawmempool", params), NullUniValue, id));
+    params.push_back(true);
+    BOOST_CHECK_EQUAL(StreamRPC("getrawmempool", params, id, 16), JSONRPCReply(tableRPC.execute("getrawmempool", params), NullUniValue, id));
+    BOOST_CHECK_EQUAL(StreamRPC("getrawmempool", params, id, CJSONStreamWriter::DEFAULT_CHUNK_SIZE), JSONRPCReply(tableRPC.execute("getrawmempool", params), NullUniValue, id));
+
+    // Usage errors are thrown before anything is sent
+    std::vector<std::string> vChunks;
+    CJSONStreamWriter writer(boost::bind(&AppendChunk, boost::ref(vChunks), _1));
+    params.push_back(true);
+    BOOST_CHECK_THROW(tableRPC.executeStream("getrawmempool", params, id, writer), UniValue);
+    BOOST_CHECK(vChunks.empty());
+    UniValue paramsAddress(UniValue::VARR);
+    paramsAddress.push_back("D5nRy9Tf7Zsef8gMGL2fhWA9ZslrP4K5tf");
+    BOOST_CHECK_THROW(tableRPC.executeStream("getaddressutxos", paramsAddress, id, writer), UniValue);
+    BOOST_CHECK_THROW(tableRPC.executeStream("getaddrepstxids", UniValue(UniValue::VARR), id, writer), UniValue);
+    BOOST_CHECK(vChunks.empty());
+
+    // The dynode and governance lists, and the small replies of the other gobject commands
+    UniValue paramsList(UniValue::VARR);
+    BOOST_CHECK_EQUAL(StreamRPC("dynodelist", paramsList, id, 16), JSONRPCReply(tableRPC.execute("dynodelist", paramsList), NullUniValue, id));
+    paramsList.push_back("list");
+    paramsList.push_back("all");
+    BOOST_CHECK_EQUAL(StreamRPC("gobject", paramsList, id, 16), JSONRPCReply(tableRPC.execute("gobject", paramsList), NullUniValue, id));
+    paramsList.push_back("extra");
+    BOOST_CHECK_THROW(tableRPC.executeStream("gobject", paramsList, id, writer), UniValue);
+    BOOST_CHECK(vChunks.empty());
+
+    // Other methods are left to execute
+    CJSONStreamWriter writer2(boost::bind(&AppendChunk, boost::ref(vChunks), _1));
+    BOOST_CHECK(!tableRPC.executeStream("getblockcount", UniValue(UniValue::VARR), id, writer2));
+    BOOST_CHECK(writer2.TakeBuffered().empty());
+
+    mempool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(rpc_maintenance_info)
+{
+    // The jobs can only be registered once per process, so the scheduler outlives the test
+    static CScheduler scheduler;
+    boost::thread_group threadGroup;
+    SchedulePrivateSendMaintenance(threadGroup, scheduler);
+
+    // Only the maintenance thread runs, it picks up the per-block job right away
+    UniValue r;
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK_NO_THROW(r = CallRPC("getmaintenanceinfo"));
+        if (!find_value(r.get_obj(), "worker").get_obj().empty())
+            break;
+        MilliSleep(50);
+    }
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    BOOST_CHECK(find_value(r.get_obj(), "scheduler").get_obj().empty());
+    UniValue job = find_value(find_value(r.get_obj(), "worker").get_obj(), "blockmaintenance");
+    BOOST_CHECK_EQUAL(find_value(job.get_obj(), "runs").get_int64(), 1);
+    BOOST_CHECK(find_value(job.get_obj(), "maxtime").get_int64() >= find_value(job.get_obj(), "lasttime").get_int64());
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(string("clearbanned")));
@@ -116,4 +116,38 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+static void countTask(boost::mutex& mutex, int& counter)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    counter++;
+}
+
+BOOST_AUTO_TEST_CASE(named_task_stats)
+{
+    CScheduler scheduler;
+    boost::mutex counterMutex;
+    int counter = 0;
+
+    CScheduler::Function f = boost::bind(&countTask, boost::ref(counterMutex), boost::ref(counter));
+    for (int i = 0; i < 3; i++)
+        scheduler.scheduleFromNow(f, 0, "a");
+    scheduler.scheduleFromNow(f, 0, "b");
+    // unnamed tasks are not tracked
+    scheduler.scheduleFromNow(f, 0);
+
+    boost::thread_group threads;
+    for (int i = 0; i < 2; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    scheduler.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(counter, 5);
+    std::map<std::string, CScheduler::TaskStats> mapStats = scheduler.getTaskStats();
+    BOOST_CHECK_EQUAL(mapStats.size(), 2U);
+    BOOST_CHECK_EQUAL(mapStats["a"].nRuns, 3);
+    BOOST_CHECK_EQUAL(mapStats["b"].nRuns, 1);
+    BOOST_CHECK(mapStats["a"].nMaxMicros >= mapStats["a"].nLastMicros);
+    BOOST_CHECK(mapStats["a"].nTotalMicros >= mapStats["a"].nMaxMicros);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
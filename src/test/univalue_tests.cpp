@@ -7,6 +7,7 @@
 #include <string>
 #include <map>
 #include <univalue.h>
+#include "tinyformat.h"
 #include "test/test_dynamic.h"
 
 #include <boost/test/unit_test.hpp>
@@ -331,5 +332,44 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+BOOST_AUTO_TEST_CASE(univalue_large_object)
+{
+    // Large enough to be looked up through the key index
+    UniValue obj(UniValue::VOBJ);
+    obj.reserve(200);
+    for (int i = 0; i < 200; i++)
+        BOOST_CHECK(obj.pushKV(strprintf("key%d", i), i));
+    // Duplicate keys resolve to the first one, like a linear scan
+    BOOST_CHECK(obj.pushKV("key7", 1000));
+    BOOST_CHECK(obj.push_back(Pair("extra", UniValue(UniValue::VARR))));
+
+    BOOST_CHECK_EQUAL(obj.size(), 202);
+    BOOST_CHECK_EQUAL(obj["key0"].get_int(), 0);
+    BOOST_CHECK_EQUAL(obj["key7"].get_int(), 7);
+    BOOST_CHECK_EQUAL(find_value(obj, "key199").get_int(), 199);
+    BOOST_CHECK(obj["extra"].isArray());
+    BOOST_CHECK(obj["key200"].isNull());
+    BOOST_CHECK(obj.exists("key150"));
+    BOOST_CHECK(!obj.exists("key-1"));
+
+    // Copies and parsed objects can be looked up the same way
+    UniValue copy(obj);
+    UniValue assigned;
+    assigned = obj;
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(obj.write()));
+    BOOST_CHECK_EQUAL(copy["key42"].get_int(), 42);
+    BOOST_CHECK_EQUAL(assigned["key7"].get_int(), 7);
+    BOOST_CHECK_EQUAL(parsed["key7"].get_int(), 7);
+    BOOST_CHECK_EQUAL(parsed["key199"].get_int(), 199);
+    BOOST_CHECK_EQUAL(parsed.write(), obj.write());
+
+    // Cleared objects forget their keys
+    copy.setObject();
+    BOOST_CHECK(copy["key42"].isNull());
+    BOOST_CHECK(copy.pushKV("key42", 1));
+    BOOST_CHECK_EQUAL(copy["key42"].get_int(), 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,93 @@
+// Copyright (c) 2016-2017 Duality Blockchain Solutions Ltd
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "consensus/merkle.h"
+#include "primitives/block.h"
+#include "validationinterface.h"
+
+#include "test/test_dynamic.h"
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, BasicTestingSetup)
+
+class CRecordingInterface : public CValidationInterface
+{
+public:
+    std::vector<int> vHeights;
+    std::vector<uint256> vTxHashes;
+    uint256 hashBlock;
+    boost::thread::id idThread;
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindex)
+    {
+        vHeights.push_back(pindex->nHeight);
+        idThread = boost::this_thread::get_id();
+    }
+
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+    {
+        vTxHashes.push_back(tx.GetHash());
+        if (pblock)
+            hashBlock = pblock->hashMerkleRoot;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(validationinterface_direct)
+{
+    CRecordingInterface listener;
+    CBlockIndex index;
+    index.nHeight = 7;
+
+    // Without the notification thread everything is delivered right away
+    RegisterValidationInterface(&listener);
+    QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().UpdatedBlockTip), &index));
+    UnregisterValidationInterface(&listener);
+    BOOST_CHECK_EQUAL(listener.vHeights.size(), 1U);
+    BOOST_CHECK(listener.idThread == boost::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_CASE(validationinterface_queue)
+{
+    CRecordingInterface listener;
+    std::vector<CBlockIndex> vIndex(50);
+    for (unsigned int i = 0; i < vIndex.size(); i++)
+        vIndex[i].nHeight = i;
+
+    RegisterValidationInterface(&listener);
+    StartValidationInterfaceQueue();
+    BOOST_FOREACH(const CBlockIndex& index, vIndex)
+        QueueValidationInterfaceEvent(boost::bind(boost::ref(GetMainSignals().UpdatedBlockTip), &index));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(GetValidationInterfaceQueueSize(), 0U);
+    BOOST_CHECK(listener.idThread != boost::this_thread::get_id());
+    BOOST_CHECK_EQUAL(listener.vHeights.size(), vIndex.size());
+    for (unsigned int i = 0; i < listener.vHeights.size(); i++)
+        BOOST_CHECK_EQUAL(listener.vHeights[i], (int)i);
+
+    // The listener sees its own copy of the block, whatever the caller does with it
+    uint256 hashMerkleRoot;
+    {
+        CBlock block;
+        CMutableTransaction tx;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 42;
+        block.vtx.push_back(tx);
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        hashMerkleRoot = block.hashMerkleRoot;
+        NotifyBlockConnected(block, &vIndex[0]);
+        SyncWithWallets(tx, &block);
+    }
+    StopValidationInterfaceQueue();
+    UnregisterValidationInterface(&listener);
+    BOOST_CHECK_EQUAL(listener.vTxHashes.size(), 2U);
+    BOOST_CHECK(listener.hashBlock == hashMerkleRoot);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -16,6 +16,8 @@
 
 #include <stdint.h>
 
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -35,30 +37,69 @@ static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, bool fAsyncWriteIn) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true),
+    fAsyncWrite(fAsyncWriteIn), fWriting(false), fWriteFailed(false), fShutdown(false)
 {
+    if (fAsyncWrite)
+        writerThread = boost::thread(boost::bind(&CCoinsViewDB::ThreadWriteCoins, this));
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (!fAsyncWrite)
+        return;
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        fShutdown = true;
+    }
+    condPending.notify_all();
+    // The writer commits any pending snapshot before it exits.
+    writerThread.join();
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
+    if (fAsyncWrite) {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        CCoinsMap::const_iterator it = mapPending.find(txid);
+        if (it != mapPending.end()) {
+            // Pruned entries are about to be erased from the database.
+            if (it->second.coins.IsPruned())
+                return false;
+            coins = it->second.coins;
+            return true;
+        }
+    }
     return db.Read(make_pair(DB_COINS, txid), coins);
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
+    if (fAsyncWrite) {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        CCoinsMap::const_iterator it = mapPending.find(txid);
+        if (it != mapPending.end())
+            return !it->second.coins.IsPruned();
+    }
     return db.Exists(make_pair(DB_COINS, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (fAsyncWrite) {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (!hashPending.IsNull())
+            return hashPending;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
     return hashBestChain;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(&db.GetObfuscateKey());
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             if (it->second.coins.IsPruned())
                 batch.Erase(make_pair(DB_COINS, it->first));
@@ -67,8 +108,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
     }
     if (!hashBlock.IsNull())
         batch.Write(DB_BEST_BLOCK, hashBlock);
@@ -77,6 +116,256 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (!fAsyncWrite) {
+        bool fOk = WriteCoins(mapCoins, hashBlock);
+        mapCoins.clear();
+        return fOk;
+    }
+
+    // Entries that are not dirty match the database already; don't keep them alive.
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            it++;
+        } else {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        }
+    }
+
+    boost::unique_lock<boost::mutex> lock(csPending);
+    // Snapshots must reach the database in order, so wait for the previous one.
+    while (fWriting)
+        condPending.wait(lock);
+    bool fOk = !fWriteFailed;
+    if (fWriteFailed) {
+        // The failed snapshot is still being served to readers. Layer the new
+        // entries on top of it and retry both in one batch, but report the
+        // earlier failure so the caller can shut down.
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it++)
+            mapPending[it->first].coins.swap(it->second.coins);
+        for (CCoinsMap::iterator it = mapPending.begin(); it != mapPending.end(); it++)
+            it->second.flags = CCoinsCacheEntry::DIRTY;
+        mapCoins.clear();
+        if (!hashBlock.IsNull())
+            hashPending = hashBlock;
+        fWriteFailed = false;
+    } else {
+        mapPending.swap(mapCoins);
+        hashPending = hashBlock;
+    }
+    fWriting = true;
+    condPending.notify_all();
+    return fOk;
+}
+
+bool CCoinsViewDB::WaitForWrite() const {
+    if (!fAsyncWrite)
+        return true;
+    boost::unique_lock<boost::mutex> lock(csPending);
+    while (fWriting)
+        condPending.wait(lock);
+    return !fWriteFailed;
+}
+
+void CCoinsViewDB::ThreadWriteCoins() {
+    RenameThread("dynamic-coinsflush");
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            while (!fWriting && !fShutdown)
+                condPending.wait(lock);
+            if (!fWriting)
+                return;
+        }
+
+        // mapPending is only read while fWriting is set, so no lock is needed here.
+        int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = WriteCoins(mapPending, hashPending);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("%s: error writing coin database: %s\n", __func__, e.what());
+        }
+        LogPrint("bench", "    - Background coin flush: %.2fms\n", 0.001 * (GetTimeMicros() - nStart));
+
+        CCoinsMap mapWritten;
+        {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            if (fOk) {
+                mapWritten.swap(mapPending);
+                hashPending.SetNull();
+            } else {
+                // Keep the snapshot: the database is missing it, so reads must still see it.
+                fWriteFailed = true;
+            }
+            fWriting = false;
+        }
+        condPending.notify_all();
+        // mapWritten is freed here, outside of csPending.
+    }
+}
+
+CCoinsViewPrefetch::CCoinsViewPrefetch(CCoinsView *viewIn, int nThreads, size_t nMaxEntriesIn) :
+    CCoinsViewBacked(viewIn), nMaxEntries(nMaxEntriesIn), nGeneration(0), fShutdown(false)
+{
+    for (int i = 0; i < nThreads; i++)
+        workers.create_thread(boost::bind(&CCoinsViewPrefetch::ThreadPrefetch, this));
+}
+
+CCoinsViewPrefetch::~CCoinsViewPrefetch()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fShutdown = true;
+    }
+    condQueue.notify_all();
+    workers.join_all();
+}
+
+bool CCoinsViewPrefetch::GetCoins(const uint256 &txid, CCoins &coins) const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        CCoinsMap::iterator it = mapPrefetched.find(txid);
+        if (it != mapPrefetched.end()) {
+            coins.swap(it->second.coins);
+            mapPrefetched.erase(it);
+            return true;
+        }
+    }
+    return base->GetCoins(txid, coins);
+}
+
+bool CCoinsViewPrefetch::HaveCoins(const uint256 &txid) const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (mapPrefetched.count(txid))
+            return true;
+    }
+    return base->HaveCoins(txid);
+}
+
+bool CCoinsViewPrefetch::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // Hold cs across the write so no worker can park a result read from the old state.
+    boost::unique_lock<boost::mutex> lock(cs);
+    nGeneration++;
+    if (!mapPrefetched.empty()) {
+        for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+                mapPrefetched.erase(it->first);
+        }
+    }
+    return base->BatchWrite(mapCoins, hashBlock);
+}
+
+void CCoinsViewPrefetch::Prefetch(const CBlock &block, int nHeight) {
+    std::set<uint256> setCreated;
+    std::set<uint256> setSpent;
+    BOOST_FOREACH(const CTransaction& tx, block.vtx) {
+        setCreated.insert(tx.GetHash());
+        if (tx.IsCoinBase())
+            continue;
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            if (!setCreated.count(txin.prevout.hash))
+                setSpent.insert(txin.prevout.hash);
+        }
+    }
+    if (setSpent.empty())
+        return;
+    const uint256 hashBlock = block.GetHash();
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        std::pair<std::map<uint256, std::pair<int, std::vector<uint256> > >::iterator, bool> ret =
+            mapBlocks.insert(std::make_pair(hashBlock, std::make_pair(nHeight, std::vector<uint256>())));
+        if (!ret.second)
+            return;
+        std::vector<uint256>& vTxids = ret.first->second.second;
+        BOOST_FOREACH(const uint256& txid, setSpent) {
+            if (queue.size() + mapPrefetched.size() >= nMaxEntries)
+                break;
+            vTxids.push_back(txid);
+            if (mapTxidRefs[txid]++ == 0)
+                queue.push_back(txid);
+        }
+    }
+    condQueue.notify_all();
+}
+
+void CCoinsViewPrefetch::ForgetBlock(std::map<uint256, std::pair<int, std::vector<uint256> > >::iterator it) {
+    bool fQueued = false;
+    BOOST_FOREACH(const uint256& txid, it->second.second) {
+        std::map<uint256, int>::iterator itRef = mapTxidRefs.find(txid);
+        if (--itRef->second > 0)
+            continue;
+        mapTxidRefs.erase(itRef);
+        if (!mapPrefetched.erase(txid))
+            fQueued = true;
+    }
+    mapBlocks.erase(it);
+    // Queued txids that no block wants any more
+    if (fQueued) {
+        std::deque<uint256>::iterator itEnd = queue.begin();
+        for (std::deque<uint256>::iterator itQueue = queue.begin(); itQueue != queue.end(); itQueue++) {
+            if (mapTxidRefs.count(*itQueue))
+                *itEnd++ = *itQueue;
+        }
+        queue.erase(itEnd, queue.end());
+    }
+}
+
+void CCoinsViewPrefetch::UpdatedTip(int nHeight) {
+    boost::unique_lock<boost::mutex> lock(cs);
+    for (std::map<uint256, std::pair<int, std::vector<uint256> > >::iterator it = mapBlocks.begin(); it != mapBlocks.end();) {
+        if (it->second.first <= nHeight)
+            ForgetBlock(it++);
+        else
+            it++;
+    }
+}
+
+void CCoinsViewPrefetch::BlockRejected(const uint256 &hashBlock) {
+    boost::unique_lock<boost::mutex> lock(cs);
+    std::map<uint256, std::pair<int, std::vector<uint256> > >::iterator it = mapBlocks.find(hashBlock);
+    if (it != mapBlocks.end())
+        ForgetBlock(it);
+}
+
+size_t CCoinsViewPrefetch::GetSize() const {
+    boost::unique_lock<boost::mutex> lock(cs);
+    return queue.size() + mapPrefetched.size();
+}
+
+void CCoinsViewPrefetch::ThreadPrefetch() {
+    RenameThread("dynamic-prefetch");
+    boost::unique_lock<boost::mutex> lock(cs);
+    while (true) {
+        while (queue.empty() && !fShutdown)
+            condQueue.wait(lock);
+        if (fShutdown)
+            return;
+        uint256 txid = queue.front();
+        queue.pop_front();
+        if (mapPrefetched.count(txid) || !mapTxidRefs.count(txid))
+            continue;
+        uint64_t nGenerationRead = nGeneration;
+
+        CCoins coins;
+        bool fFound = false;
+        lock.unlock();
+        try {
+            fFound = base->GetCoins(txid, coins);
+        } catch (const std::runtime_error& e) {
+            // Leave it to the regular lookup path to report database errors.
+        }
+        lock.lock();
+
+        // Drop it if a write raced with the read, or the block was forgotten meanwhile
+        if (fFound && nGenerationRead == nGeneration && mapTxidRefs.count(txid) && mapPrefetched.size() < nMaxEntries)
+            coins.swap(mapPrefetched[txid].coins);
+    }
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -101,6 +390,9 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    if (!WaitForWrite())
+        return error("CCoinsViewDB::GetStats() : background coin flush failed");
+
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -11,11 +11,17 @@
 #include "coins.h"
 #include "dbwrapper.h"
 
+#include <deque>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class CBlock;
 class CBlockFileInfo;
 class CBlockIndex;
 struct CDiskTxPos;
@@ -36,20 +42,117 @@ static const int64_t nDefaultDbCache = 100;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -asyncflush default
+static const bool DEFAULT_ASYNC_FLUSH = true;
+//! -utxoprefetch default (threads)
+static const int DEFAULT_UTXO_PREFETCH_THREADS = 4;
+//! Maximum number of -utxoprefetch threads
+static const int MAX_UTXO_PREFETCH_THREADS = 16;
+//! Maximum number of prefetched coins held at once
+static const size_t MAX_UTXO_PREFETCH_ENTRIES = 200000;
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With fAsyncWrite set, BatchWrite only takes ownership of the dirty entries
+ * and returns; a background thread commits them to the database. Until that
+ * commit finishes, reads are served from the pending snapshot. Coins and the
+ * best block marker go out in one LevelDB batch, so after a crash the database
+ * is at either the previous or the new best block. Only one snapshot is in
+ * flight at a time: a second BatchWrite waits for the first to be committed.
+ * A snapshot whose write failed keeps being served to readers, and is retried
+ * together with the next one.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+private:
+    bool fAsyncWrite;
+
+    //! Protects the pending snapshot state below
+    mutable boost::mutex csPending;
+    //! Signalled when a snapshot is handed over or committed
+    mutable boost::condition_variable condPending;
+    //! Snapshot not yet in the database. Not modified while fWriting is set.
+    CCoinsMap mapPending;
+    uint256 hashPending;
+    bool fWriting;
+    bool fWriteFailed;
+    bool fShutdown;
+    boost::thread writerThread;
+
+    void ThreadWriteCoins();
+
+protected:
+    //! Commit a snapshot in one batch. Virtual so tests can inject failures.
+    virtual bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool fAsyncWriteIn = false);
+    ~CCoinsViewDB();
 
     bool GetCoins(const uint256 &txid, CCoins &coins) const;
     bool HaveCoins(const uint256 &txid) const;
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
     bool GetStats(CCoinsStats &stats) const;
+
+    //! Block until any pending snapshot has been committed. Returns false if a background write failed.
+    bool WaitForWrite() const;
+};
+
+/**
+ * CCoinsView that looks up a block's inputs ahead of its connection.
+ *
+ * Prefetch() queues the txids spent by a block; worker threads read them from
+ * the backing view in parallel and park the results here, so the serial
+ * lookups done later by ConnectBlock are served from memory. A parked entry
+ * is handed out once and then forgotten, as the cache above keeps its own
+ * copy. The backing view must allow reads concurrent with BatchWrite.
+ *
+ * Lookups are tracked per block. Those of a block are dropped once the tip
+ * reaches its height, whether it was connected or went stale, or when it is
+ * found invalid, so blocks that are never connected don't use up the bound.
+ */
+class CCoinsViewPrefetch : public CCoinsViewBacked
+{
+private:
+    //! Protects everything below
+    mutable boost::mutex cs;
+    boost::condition_variable condQueue;
+    std::deque<uint256> queue;
+    mutable CCoinsMap mapPrefetched;
+    size_t nMaxEntries;
+    //! Height and queued txids of each block prefetched for
+    std::map<uint256, std::pair<int, std::vector<uint256> > > mapBlocks;
+    //! Number of tracked blocks that queued each txid
+    std::map<uint256, int> mapTxidRefs;
+    //! Bumped by every BatchWrite so reads that raced with it are discarded
+    uint64_t nGeneration;
+    bool fShutdown;
+    boost::thread_group workers;
+
+    void ThreadPrefetch();
+    void ForgetBlock(std::map<uint256, std::pair<int, std::vector<uint256> > >::iterator it);
+
+public:
+    CCoinsViewPrefetch(CCoinsView *viewIn, int nThreads, size_t nMaxEntriesIn = MAX_UTXO_PREFETCH_ENTRIES);
+    ~CCoinsViewPrefetch();
+
+    bool GetCoins(const uint256 &txid, CCoins &coins) const;
+    bool HaveCoins(const uint256 &txid) const;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+
+    //! Queue lookups for all coins spent by block, at nHeight, that it does not create itself.
+    void Prefetch(const CBlock &block, int nHeight);
+    //! Drop the lookups of blocks at or below the new tip height.
+    void UpdatedTip(int nHeight);
+    //! Drop the lookups of a block found invalid.
+    void BlockRejected(const uint256 &hashBlock);
+    //! Number of queued and parked lookups.
+    size_t GetSize() const;
 };
 
 /** Access to the block database (blocks/index/) */
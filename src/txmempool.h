@@ -25,9 +25,22 @@
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
 
+#include <boost/signals2/signal.hpp>
+
 class CAutoFile;
 class CBlockIndex;
 
+/** Reason why a transaction was removed from the mempool */
+enum MemPoolRemovalReason {
+    MPR_UNKNOWN = 0, //! manually removed or unknown reason
+    MPR_EXPIRY,      //! expired from mempool
+    MPR_SIZELIMIT,   //! removed in size limiting
+    MPR_REORG,       //! removed for reorganization
+    MPR_BLOCK,       //! removed for block
+    MPR_CONFLICT,    //! removed due to conflict with in-block transaction
+    MPR_REPLACED     //! removed for replacement
+};
+
 inline double AllowFreeThreshold()
 {
     return COIN * 144 / 250;
@@ -87,6 +100,7 @@ private:
     size_t nModSize; //! ... and modified size for priority
     size_t nUsageSize; //! ... and total memory usage
     int64_t nTime; //! Local time when entering the mempool
+    uint64_t nSequence; //! Order of entering the mempool, set by CTxMemPool::addUnchecked
     double entryPriority; //! Priority when entering the mempool
     unsigned int entryHeight; //! Chain height when entering the mempool
     bool hadNoDependencies; //! Not dependent on any other txs when it entered the mempool
@@ -121,6 +135,7 @@ public:
     const CAmount& GetFee() const { return nFee; }
     size_t GetTxSize() const { return nTxSize; }
     int64_t GetTime() const { return nTime; }
+    uint64_t GetSequence() const { return nSequence; }
     unsigned int GetHeight() const { return entryHeight; }
     bool WasClearAtEntry() const { return hadNoDependencies; }
     unsigned int GetSigOpCount() const { return sigOpCount; }
@@ -135,6 +150,7 @@ public:
     void UpdateFeeDelta(int64_t feeDelta);
     // Update the LockPoints after a reorg
     void UpdateLockPoints(const LockPoints& lp);
+    void SetSequence(uint64_t nSequenceIn) { nSequence = nSequenceIn; }
 
     /** We can set the entry to be dirty if doing the full calculation of in-
      *  mempool descendants will be too expensive, which can potentially happen
@@ -182,6 +198,16 @@ private:
     int64_t feeDelta;
 };
 
+struct update_sequence
+{
+    update_sequence(uint64_t _nSequence) : nSequence(_nSequence) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.SetSequence(nSequence); }
+
+private:
+    uint64_t nSequence;
+};
+
 struct update_lock_points
 {
     update_lock_points(const LockPoints& _lp) : lp(_lp) { }
@@ -364,9 +390,12 @@ class CTxMemPool
 private:
     uint32_t nCheckFrequency; //! Value n means that n times in 2^32 we check.
     unsigned int nTransactionsUpdated;
+    unsigned int nTransactionsRemoved; //! Removals and fee prioritisations, i.e. changes other than additions
+    uint64_t nTransactionsAdded; //! Sequence of the last transaction that entered
     CBlockPolicyEstimator* minerPolicyEstimator;
 
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
+    CAmount totalTxFees; //! sum of all mempool tx' fees (not including prioritisation)
     uint64_t cachedInnerUsage; //! sum of dynamic memory usage of all the map elements (NOT the maps themselves)
 
     CFeeRate minReasonableRelayFee;
@@ -479,7 +508,7 @@ public:
     bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool removeSpentIndex(const uint256 txhash);
 
-    void remove(const CTransaction &tx, std::list<CTransaction>& removed, bool fRecursive = false);
+    void remove(const CTransaction &tx, std::list<CTransaction>& removed, bool fRecursive = false, MemPoolRemovalReason reason = MPR_UNKNOWN);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx, std::list<CTransaction>& removed);
     void removeForBlock(const std::vector<CTransaction>& vtx, unsigned int nBlockHeight,
@@ -490,6 +519,17 @@ public:
     void pruneSpent(const uint256& hash, CCoins &coins);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
+    /**
+     * Counter that only moves when transactions leave the pool or their mining
+     * score is changed by PrioritiseTransaction. While it stays the same, the
+     * pool has at most gained transactions.
+     */
+    unsigned int GetTransactionsRemoved() const;
+    /**
+     * Sequence of the last transaction added, entries that come later have a
+     * higher CTxMemPoolEntry::GetSequence().
+     */
+    uint64_t GetTransactionsAdded() const;
     /**
      * Check that none of this transactions inputs are in the mempool, and thus
      * the tx is not dependent on other mempool transactions to be included in a block.
@@ -505,7 +545,7 @@ public:
     /** Remove a set of transactions from the mempool.
      *  If a transaction is in this set, then all in-mempool descendants must
      *  also be in the set.*/
-    void RemoveStaged(setEntries &stage);
+    void RemoveStaged(setEntries &stage, MemPoolRemovalReason reason = MPR_UNKNOWN);
 
     /** When adding transactions from a disconnected block back to the mempool,
      *  new mempool entries may have children in the mempool (which is generally
@@ -564,6 +604,12 @@ public:
         return totalTxSize;
     }
 
+    CAmount GetTotalTxFees() const
+    {
+        LOCK(cs);
+        return totalTxFees;
+    }
+
     bool exists(uint256 hash) const
     {
         LOCK(cs);
@@ -632,7 +678,11 @@ private:
      *  transactions in a chain before we've updated all the state for the
      *  removal.
      */
-    void removeUnchecked(txiter entry);
+    void removeUnchecked(txiter entry, MemPoolRemovalReason reason = MPR_UNKNOWN);
+
+public:
+    /** Notifies listeners of every transaction leaving the pool, called with cs held */
+    boost::signals2::signal<void (const CTransaction &, MemPoolRemovalReason)> NotifyEntryRemoved;
 };
 
 /** 
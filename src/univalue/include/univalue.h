@@ -47,7 +47,6 @@ public:
         std::string s(val_);
         setStr(s);
     }
-    ~UniValue() {}
 
     void clear();
 
@@ -67,6 +66,8 @@ public:
     bool empty() const { return (values.size() == 0); }
 
     size_t size() const { return values.size(); }
+    /** Make room for n array elements or object members */
+    void reserve(size_t n);
 
     bool getBool() const { return isTrue(); }
     bool checkObject(const std::map<std::string,UniValue::VType>& memberTypes);
@@ -84,6 +85,14 @@ public:
     bool isObject() const { return (typ == VOBJ); }
 
     bool push_back(const UniValue& val);
+#if __cplusplus >= 201103L
+    bool push_back(UniValue&& val_) {
+        if (typ != VARR)
+            return false;
+        values.push_back(std::move(val_));
+        return true;
+    }
+#endif
     bool push_back(const std::string& val_) {
         UniValue tmpVal(VSTR, val_);
         return push_back(tmpVal);
@@ -95,6 +104,16 @@ public:
     bool push_backV(const std::vector<UniValue>& vec);
 
     bool pushKV(const std::string& key, const UniValue& val);
+#if __cplusplus >= 201103L
+    bool pushKV(const std::string& key, UniValue&& val_) {
+        if (typ != VOBJ)
+            return false;
+        keys.push_back(key);
+        values.push_back(std::move(val_));
+        indexLastKey();
+        return true;
+    }
+#endif
     bool pushKV(const std::string& key, const std::string& val) {
         UniValue tmpVal(VSTR, val);
         return pushKV(key, tmpVal);
@@ -130,20 +149,57 @@ public:
     }
 
 private:
+    // Objects with at least this many members keep a KeyIndex
+    static const size_t KEY_INDEX_MIN_SIZE = 32;
+
+    // Map from key to its first position in keys, so that lookups in large
+    // objects don't scan all keys. Copies carry their own map.
+    class KeyIndex {
+    public:
+        std::map<std::string, size_t>* index;
+
+        KeyIndex() : index(NULL) {}
+        KeyIndex(const KeyIndex& other) :
+            index(other.index ? new std::map<std::string, size_t>(*other.index) : NULL) {}
+        KeyIndex& operator=(const KeyIndex& other) {
+            if (this != &other) {
+                KeyIndex tmp(other);
+                std::swap(index, tmp.index);
+            }
+            return *this;
+        }
+#if __cplusplus >= 201103L
+        KeyIndex(KeyIndex&& other) noexcept : index(other.index) { other.index = NULL; }
+        KeyIndex& operator=(KeyIndex&& other) noexcept {
+            if (this != &other) {
+                delete index;
+                index = other.index;
+                other.index = NULL;
+            }
+            return *this;
+        }
+#endif
+        ~KeyIndex() { delete index; }
+        void clear() { delete index; index = NULL; }
+    };
+
     UniValue::VType typ;
     std::string val;                       // numbers are stored as C++ strings
     std::vector<std::string> keys;
     std::vector<UniValue> values;
+    KeyIndex keyIndex;
 
     int findKey(const std::string& key) const;
+    void buildKeyIndex();
+    void indexLastKey();
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
 public:
     // Strict type-specific getters, these throw std::runtime_error if the
     // value is of unexpected type
-    std::vector<std::string> getKeys() const;
-    std::vector<UniValue> getValues() const;
+    const std::vector<std::string>& getKeys() const;
+    const std::vector<UniValue>& getValues() const;
     bool get_bool() const;
     std::string get_str() const;
     int get_int() const;
@@ -154,7 +210,11 @@ public:
 
     enum VType type() const { return getType(); }
     bool push_back(std::pair<std::string,UniValue> pear) {
+#if __cplusplus >= 201103L
+        return pushKV(pear.first, std::move(pear.second));
+#else
         return pushKV(pear.first, pear.second);
+#endif
     }
     friend const UniValue& find_value( const UniValue& obj, const std::string& name);
 };
@@ -83,6 +83,7 @@ void UniValue::clear()
     val.clear();
     keys.clear();
     values.clear();
+    keyIndex.clear();
 }
 
 bool UniValue::setNull()
@@ -182,6 +183,13 @@ bool UniValue::push_back(const UniValue& val)
     return true;
 }
 
+void UniValue::reserve(size_t n)
+{
+    if (typ == VOBJ)
+        keys.reserve(n);
+    values.reserve(n);
+}
+
 bool UniValue::push_backV(const std::vector<UniValue>& vec)
 {
     if (typ != VARR)
@@ -199,6 +207,7 @@ bool UniValue::pushKV(const std::string& key, const UniValue& val)
 
     keys.push_back(key);
     values.push_back(val);
+    indexLastKey();
     return true;
 }
 
@@ -207,16 +216,43 @@ bool UniValue::pushKVs(const UniValue& obj)
     if (typ != VOBJ || obj.typ != VOBJ)
         return false;
 
+    reserve(keys.size() + obj.keys.size());
     for (unsigned int i = 0; i < obj.keys.size(); i++) {
         keys.push_back(obj.keys[i]);
         values.push_back(obj.values.at(i));
+        indexLastKey();
     }
 
     return true;
 }
 
+void UniValue::buildKeyIndex()
+{
+    keyIndex.clear();
+    if (keys.size() < KEY_INDEX_MIN_SIZE)
+        return;
+
+    keyIndex.index = new std::map<std::string, size_t>();
+    // insert() keeps the first position of a duplicate key, like the linear scan
+    for (size_t i = 0; i < keys.size(); i++)
+        keyIndex.index->insert(std::make_pair(keys[i], i));
+}
+
+void UniValue::indexLastKey()
+{
+    if (keyIndex.index)
+        keyIndex.index->insert(std::make_pair(keys.back(), keys.size() - 1));
+    else if (keys.size() >= KEY_INDEX_MIN_SIZE)
+        buildKeyIndex();
+}
+
 int UniValue::findKey(const std::string& key) const
 {
+    if (keyIndex.index) {
+        std::map<std::string, size_t>::const_iterator it = keyIndex.index->find(key);
+        return it == keyIndex.index->end() ? -1 : (int) it->second;
+    }
+
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (keys[i] == key)
             return (int) i;
@@ -279,21 +315,21 @@ const char *uvTypeName(UniValue::VType t)
 
 const UniValue& find_value(const UniValue& obj, const std::string& name)
 {
-    for (unsigned int i = 0; i < obj.keys.size(); i++)
-        if (obj.keys[i] == name)
-            return obj.values.at(i);
+    int index = obj.findKey(name);
+    if (index < 0)
+        return NullUniValue;
 
-    return NullUniValue;
+    return obj.values.at(index);
 }
 
-std::vector<std::string> UniValue::getKeys() const
+const std::vector<std::string>& UniValue::getKeys() const
 {
     if (typ != VOBJ)
         throw std::runtime_error("JSON value is not an object as expected");
     return keys;
 }
 
-std::vector<UniValue> UniValue::getValues() const
+const std::vector<UniValue>& UniValue::getValues() const
 {
     if (typ != VOBJ && typ != VARR)
         throw std::runtime_error("JSON value is not an object or array as expected");
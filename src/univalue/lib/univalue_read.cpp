@@ -337,6 +337,9 @@ bool UniValue::read(const char *raw)
             if (utyp != top->getType())
                 return false;
 
+            // keys were pushed directly, index them in one go
+            if (utyp == VOBJ)
+                top->buildKeyIndex();
             stack.pop_back();
             clearExpect(OBJ_NAME);
             setExpect(NOT_VALUE);
@@ -7,8 +7,30 @@
 
 #include "validationinterface.h"
 
+#include "primitives/block.h"
+#include "sync.h"
+#include "util.h"
+
+#include <deque>
+
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+
 static CMainSignals g_signals;
 
+/** Notifications waiting for the notification thread, oldest first */
+static std::deque<boost::function<void ()> > validationQueue;
+static boost::mutex cs_validationQueue;
+/** Signalled when a notification is queued or delivered, or the thread is asked to stop */
+static boost::condition_variable condValidationQueue;
+static boost::thread threadValidationQueue;
+static bool fValidationQueueRunning = false;
+static bool fValidationQueueStopping = false;
+static uint64_t nValidationQueued = 0;
+static uint64_t nValidationDelivered = 0;
+/** Held while a notification is delivered, so unregistering can wait for a running callback */
+static CCriticalSection cs_validationDelivery;
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
@@ -25,9 +47,19 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.ScriptForMining.connect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockFound.connect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
+    g_signals.BlockConnected.connect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2));
+    g_signals.TransactionRemovedFromMempool.connect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2));
+    g_signals.NotifyDynodeListChanged.connect(boost::bind(&CValidationInterface::NotifyDynodeListChanged, pwalletIn, _1, _2));
+    g_signals.NotifyGovernanceObject.connect(boost::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, _1));
+    g_signals.NotifyGovernanceVote.connect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
+    g_signals.NotifyGovernanceVote.disconnect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
+    g_signals.NotifyGovernanceObject.disconnect(boost::bind(&CValidationInterface::NotifyGovernanceObject, pwalletIn, _1));
+    g_signals.NotifyDynodeListChanged.disconnect(boost::bind(&CValidationInterface::NotifyDynodeListChanged, pwalletIn, _1, _2));
+    g_signals.TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2));
+    g_signals.BlockConnected.disconnect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2));
     g_signals.BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
     g_signals.ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
@@ -38,9 +70,17 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.NotifyTransactionLock.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
     g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
     g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    // The notification thread may be inside one of pwalletIn's callbacks,
+    // let it return before the caller frees pwalletIn
+    LOCK(cs_validationDelivery);
 }
 
 void UnregisterAllValidationInterfaces() {
+    g_signals.NotifyGovernanceVote.disconnect_all_slots();
+    g_signals.NotifyGovernanceObject.disconnect_all_slots();
+    g_signals.NotifyDynodeListChanged.disconnect_all_slots();
+    g_signals.TransactionRemovedFromMempool.disconnect_all_slots();
+    g_signals.BlockConnected.disconnect_all_slots();
     g_signals.BlockFound.disconnect_all_slots();
     g_signals.ScriptForMining.disconnect_all_slots();
     g_signals.BlockChecked.disconnect_all_slots();
@@ -53,6 +93,133 @@ void UnregisterAllValidationInterfaces() {
     g_signals.UpdatedBlockTip.disconnect_all_slots();
 }
 
+static void ThreadValidationInterface()
+{
+    RenameThread("dynamic-notify");
+    while (true) {
+        boost::function<void ()> event;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+            while (validationQueue.empty() && !fValidationQueueStopping)
+                condValidationQueue.wait(lock);
+            if (validationQueue.empty())
+                return;
+            event.swap(validationQueue.front());
+            validationQueue.pop_front();
+        }
+        {
+            LOCK(cs_validationDelivery);
+            try {
+                event();
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "dynamic-notify");
+            } catch (...) {
+                PrintExceptionContinue(NULL, "dynamic-notify");
+            }
+        }
+        {
+            boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+            nValidationDelivered++;
+        }
+        condValidationQueue.notify_all();
+    }
+}
+
+/** True when the caller can't wait for the queue: it isn't running, or the caller is the notification thread */
+static bool ValidationQueueWaitIsNoop()
+{
+    return !fValidationQueueRunning || boost::this_thread::get_id() == threadValidationQueue.get_id();
+}
+
+void StartValidationInterfaceQueue()
+{
+    boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+    if (fValidationQueueRunning)
+        return;
+    fValidationQueueStopping = false;
+    threadValidationQueue = boost::thread(&ThreadValidationInterface);
+    fValidationQueueRunning = true;
+}
+
+void StopValidationInterfaceQueue()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+        if (!fValidationQueueRunning)
+            return;
+        fValidationQueueStopping = true;
+    }
+    condValidationQueue.notify_all();
+    threadValidationQueue.join();
+    boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+    fValidationQueueRunning = false;
+    fValidationQueueStopping = false;
+}
+
+void QueueValidationInterfaceEvent(const boost::function<void ()>& event)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+        if (fValidationQueueRunning) {
+            validationQueue.push_back(event);
+            nValidationQueued++;
+            lock.unlock();
+            condValidationQueue.notify_all();
+            return;
+        }
+    }
+    event();
+}
+
+void SyncWithValidationInterfaceQueue()
+{
+    boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+    if (ValidationQueueWaitIsNoop())
+        return;
+    uint64_t nTarget = nValidationQueued;
+    while (nValidationDelivered < nTarget)
+        condValidationQueue.wait(lock);
+}
+
+void LimitValidationInterfaceQueue()
+{
+    boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+    if (ValidationQueueWaitIsNoop())
+        return;
+    while (validationQueue.size() > MAX_VALIDATION_QUEUE_BACKLOG)
+        condValidationQueue.wait(lock);
+}
+
+size_t GetValidationInterfaceQueueSize()
+{
+    boost::unique_lock<boost::mutex> lock(cs_validationQueue);
+    return validationQueue.size();
+}
+
+static void SyncTransactionWithBlock(const CTransaction& tx, boost::shared_ptr<const CBlock> pblock)
+{
+    g_signals.SyncTransaction(tx, pblock.get());
+}
+
+static void BlockConnectedWithTransactions(boost::shared_ptr<const CBlock> pblock, const CBlockIndex* pindex)
+{
+    g_signals.BlockConnected(*pblock, pindex);
+    BOOST_FOREACH(const CTransaction& tx, pblock->vtx)
+        g_signals.SyncTransaction(tx, pblock.get());
+}
+
 void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
-    g_signals.SyncTransaction(tx, pblock);
+    if (pblock) {
+        // The block may be gone by the time the notification is delivered
+        boost::shared_ptr<const CBlock> pblockCopy(new CBlock(*pblock));
+        QueueValidationInterfaceEvent(boost::bind(&SyncTransactionWithBlock, tx, pblockCopy));
+    } else {
+        QueueValidationInterfaceEvent(boost::bind(boost::ref(g_signals.SyncTransaction), tx, static_cast<const CBlock*>(NULL)));
+    }
+}
+
+void NotifyBlockConnected(const CBlock& block, const CBlockIndex* pindex) {
+    // One copy of the block, shared by all its notifications
+    boost::shared_ptr<const CBlock> pblock(new CBlock(block));
+    QueueValidationInterfaceEvent(boost::bind(&BlockConnectedWithTransactions, pblock, pindex));
 }
@@ -8,18 +8,27 @@
 #ifndef DYNAMIC_VALIDATIONINTERFACE_H
 #define DYNAMIC_VALIDATIONINTERFACE_H
 
+#include "txmempool.h" // For MemPoolRemovalReason
+
+#include <boost/function.hpp>
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
 class CBlock;
 struct CBlockLocator;
 class CBlockIndex;
+class CGovernanceObject;
+class CGovernanceVote;
+class COutPoint;
 class CReserveScript;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
 class uint256;
 
+/** Notifications pending before ProcessNewBlock waits for the queue to catch up */
+static const unsigned int MAX_VALIDATION_QUEUE_BACKLOG = 100;
+
 // These functions dispatch to one or all registered wallets
 
 /** Register a wallet to receive updates from core */
@@ -30,6 +39,24 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 void UnregisterAllValidationInterfaces();
 /** Push an updated transaction to all registered wallets */
 void SyncWithWallets(const CTransaction& tx, const CBlock* pblock = NULL);
+/** Announce a block connected to the active chain: BlockConnected, then SyncTransaction for each of its transactions */
+void NotifyBlockConnected(const CBlock& block, const CBlockIndex* pindex);
+
+// Most notifications are delivered in order by a single thread, so block
+// connection and mempool acceptance don't wait for the listeners. Until that
+// thread is started, and after it is stopped, they are delivered right away.
+
+/** Start the thread delivering queued notifications */
+void StartValidationInterfaceQueue();
+/** Deliver all notifications still queued, then stop the thread */
+void StopValidationInterfaceQueue();
+/** Queue a notification; arguments bound into it must be copies, not references to the caller's data */
+void QueueValidationInterfaceEvent(const boost::function<void ()>& event);
+/** Wait until every notification queued so far has been delivered. Must not be called with cs_main held. */
+void SyncWithValidationInterfaceQueue();
+/** Wait while more than MAX_VALIDATION_QUEUE_BACKLOG notifications are pending. Must not be called with cs_main held. */
+void LimitValidationInterfaceQueue();
+size_t GetValidationInterfaceQueueSize();
 
 class CValidationInterface {
 protected:
@@ -43,11 +70,24 @@ protected:
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
     virtual void GetScriptForMining(boost::shared_ptr<CReserveScript>&) {};
     virtual void ResetRequestCount(const uint256 &hash) {};
+    virtual void BlockConnected(const CBlock &block, const CBlockIndex *pindex) {}
+    virtual void TransactionRemovedFromMempool(const CTransaction &tx, MemPoolRemovalReason reason) {}
+    virtual void NotifyDynodeListChanged(const COutPoint &outpoint, bool fAdded) {}
+    virtual void NotifyGovernanceObject(const CGovernanceObject &govobj) {}
+    virtual void NotifyGovernanceVote(const CGovernanceVote &vote) {}
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
 };
 
+/**
+ * UpdatedBlockTip, SyncTransaction, NotifyTransactionLock, SetBestChain,
+ * Inventory, BlockFound, BlockConnected, TransactionRemovedFromMempool and the
+ * Dynode and governance notifications are fired through the notification
+ * queue. UpdatedTransaction, BlockChecked and ScriptForMining are fired
+ * directly because their callers use the outcome, and so is Broadcast, which
+ * the message handler polls for every peer and the wallet throttles itself.
+ */
 struct CMainSignals {
     /** Notifies listeners of updated block chain tip */
     boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
@@ -69,6 +109,16 @@ struct CMainSignals {
     boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
     /** Notifies listeners that a block has been successfully mined */
     boost::signals2::signal<void (const uint256 &)> BlockFound;
+    /** Notifies listeners of a block connected to the active chain, while the block is still in memory */
+    boost::signals2::signal<void (const CBlock &, const CBlockIndex *)> BlockConnected;
+    /** Notifies listeners of a transaction leaving the mempool */
+    boost::signals2::signal<void (const CTransaction &, MemPoolRemovalReason)> TransactionRemovedFromMempool;
+    /** Notifies listeners of a dynode added to (fAdded) or removed from the list */
+    boost::signals2::signal<void (const COutPoint &, bool)> NotifyDynodeListChanged;
+    /** Notifies listeners of a new governance object */
+    boost::signals2::signal<void (const CGovernanceObject &)> NotifyGovernanceObject;
+    /** Notifies listeners of an accepted governance vote */
+    boost::signals2::signal<void (const CGovernanceVote &)> NotifyGovernanceVote;
 };
 
 CMainSignals& GetMainSignals();
@@ -20,14 +20,53 @@
 #endif
 
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 #include <boost/version.hpp>
 
+#include <leveldb/db.h>
+#include <leveldb/env.h>
+#include <leveldb/write_batch.h>
+#include <memenv.h>
+
 using namespace std;
 
 
 unsigned int nWalletDBUpdated;
 
+bool ParseWalletBackend(const std::string& strBackend, WalletDBBackend& backendRet)
+{
+    if (strBackend == "bdb")
+        backendRet = WALLET_BACKEND_BDB;
+    else if (strBackend == "leveldb")
+        backendRet = WALLET_BACKEND_LEVELDB;
+    else
+        return false;
+    return true;
+}
+
+WalletDBBackend GetWalletBackend()
+{
+    WalletDBBackend backend = WALLET_BACKEND_BDB;
+    ParseWalletBackend(GetArg("-walletbackend", DEFAULT_WALLET_BACKEND), backend);
+    return backend;
+}
+
+boost::filesystem::path GetWalletDBPath(const std::string& strFile, WalletDBBackend backend)
+{
+    if (backend == WALLET_BACKEND_LEVELDB)
+        return GetDataDir() / (strFile + ".ldb");
+    return GetDataDir() / strFile;
+}
+
+static bool LevelDbError(const leveldb::Status& status, const std::string& strFile)
+{
+    if (status.ok() || status.IsNotFound())
+        return false;
+    LogPrintf("LevelDB wallet %s: %s\n", strFile, status.ToString());
+    return true;
+}
+
 
 //
 // CDB
@@ -50,13 +89,18 @@ void CDBEnv::EnvShutdown()
 
 void CDBEnv::Reset()
 {
+    for (map<string, leveldb::DB*>::iterator it = mapLevelDb.begin(); it != mapLevelDb.end(); ++it)
+        delete it->second;
+    mapLevelDb.clear();
+    delete plevelenvMock;
+    plevelenvMock = NULL;
     delete dbenv;
     dbenv = new DbEnv(DB_CXX_NO_EXCEPTIONS);
     fDbEnvInit = false;
     fMockDb = false;
 }
 
-CDBEnv::CDBEnv() : dbenv(NULL)
+CDBEnv::CDBEnv() : plevelenvMock(NULL), dbenv(NULL)
 {
     Reset();
 }
@@ -64,6 +108,9 @@ CDBEnv::CDBEnv() : dbenv(NULL)
 CDBEnv::~CDBEnv()
 {
     EnvShutdown();
+    for (map<string, leveldb::DB*>::iterator it = mapLevelDb.begin(); it != mapLevelDb.end(); ++it)
+        delete it->second;
+    delete plevelenvMock;
     delete dbenv;
     dbenv = NULL;
 }
@@ -146,6 +193,7 @@ void CDBEnv::MakeMock()
     if (ret > 0)
         throw runtime_error(strprintf("CDBEnv::MakeMock: Error %d opening database environment.", ret));
 
+    plevelenvMock = leveldb::NewMemEnv(leveldb::Env::Default());
     fDbEnvInit = true;
     fMockDb = true;
 }
@@ -220,13 +268,142 @@ bool CDBEnv::Salvage(const std::string& strFile, bool fAggressive, std::vector<C
 void CDBEnv::CheckpointLSN(const std::string& strFile)
 {
     dbenv->txn_checkpoint(0, 0, 0);
-    if (fMockDb)
+    if (fMockDb || GetWalletBackend() == WALLET_BACKEND_LEVELDB)
         return;
     dbenv->lsn_reset(strFile.c_str(), 0);
 }
 
+Db* CDBEnv::OpenBerkeleyDb(const std::string& strFile, u_int32_t nFlags, int& ret)
+{
+    Db* pdb = new Db(dbenv, 0);
+
+    if (fMockDb) {
+        DbMpoolFile* mpf = pdb->get_mpf();
+        ret = mpf->set_flags(DB_MPOOL_NOFILE, 1);
+        if (ret != 0) {
+            delete pdb;
+            throw runtime_error(strprintf("CDB: Failed to configure for no temp file backing for database %s", strFile));
+        }
+    }
+
+    ret = pdb->open(NULL,                               // Txn pointer
+                    fMockDb ? NULL : strFile.c_str(),   // Filename
+                    fMockDb ? strFile.c_str() : "main", // Logical db name
+                    DB_BTREE,                           // Database type
+                    nFlags,                             // Flags
+                    0);
+    if (ret != 0) {
+        delete pdb;
+        return NULL;
+    }
+    return pdb;
+}
+
+leveldb::DB* CDBEnv::OpenLevelDb(const std::string& strFile, bool fCreate, bool fMustBeNew)
+{
+    AssertLockHeld(cs_db);
+    leveldb::DB*& pldb = mapLevelDb[strFile];
+    if (pldb)
+        return pldb;
+
+    leveldb::Options options;
+    options.create_if_missing = fCreate;
+    options.error_if_exists = fMustBeNew;
+    options.paranoid_checks = true;
+    options.compression = leveldb::kNoCompression;
+    options.max_open_files = 16;
+    std::string strPath = strFile;
+    if (fMockDb)
+        options.env = plevelenvMock;
+    else
+        strPath = GetWalletDBPath(strFile, WALLET_BACKEND_LEVELDB).string();
+
+    leveldb::Status status = leveldb::DB::Open(options, strPath, &pldb);
+    if (!status.ok()) {
+        LogPrintf("CDBEnv::OpenLevelDb: %s\n", status.ToString());
+        pldb = NULL;
+        mapLevelDb.erase(strFile);
+        return NULL;
+    }
+    return pldb;
+}
+
+
+int CDBCursor::close()
+{
+    int ret = 0;
+    if (pdbc)
+        ret = pdbc->close();
+    delete piter;
+    delete this;
+    return ret;
+}
+
+int CDBCursor::get(CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags)
+{
+    if (piter) {
+        if (fFlags == DB_SET_RANGE)
+            piter->Seek(leveldb::Slice(&ssKey[0], ssKey.size()));
+        else if (fFlags != DB_NEXT)
+            return EINVAL;
+        else if (!fPositioned)
+            piter->SeekToFirst();
+        else if (piter->Valid())
+            piter->Next();
+        fPositioned = true;
+        if (!piter->status().ok())
+            return 99999;
+        if (!piter->Valid())
+            return DB_NOTFOUND;
+
+        leveldb::Slice sliceKey = piter->key();
+        leveldb::Slice sliceValue = piter->value();
+        ssKey.SetType(SER_DISK);
+        ssKey.clear();
+        ssKey.write(sliceKey.data(), sliceKey.size());
+        ssValue.SetType(SER_DISK);
+        ssValue.clear();
+        ssValue.write(sliceValue.data(), sliceValue.size());
+        return 0;
+    }
 
-CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnCloseIn) : pdb(NULL), activeTxn(NULL)
+    // Read at cursor
+    Dbt datKey;
+    if (fFlags == DB_SET || fFlags == DB_SET_RANGE || fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
+        datKey.set_data(&ssKey[0]);
+        datKey.set_size(ssKey.size());
+    }
+    Dbt datValue;
+    if (fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
+        datValue.set_data(&ssValue[0]);
+        datValue.set_size(ssValue.size());
+    }
+    datKey.set_flags(DB_DBT_MALLOC);
+    datValue.set_flags(DB_DBT_MALLOC);
+    int ret = pdbc->get(&datKey, &datValue, fFlags);
+    if (ret != 0)
+        return ret;
+    else if (datKey.get_data() == NULL || datValue.get_data() == NULL)
+        return 99999;
+
+    // Convert to streams
+    ssKey.SetType(SER_DISK);
+    ssKey.clear();
+    ssKey.write((char*)datKey.get_data(), datKey.get_size());
+    ssValue.SetType(SER_DISK);
+    ssValue.clear();
+    ssValue.write((char*)datValue.get_data(), datValue.get_size());
+
+    // Clear and free memory
+    memset(datKey.get_data(), 0, datKey.get_size());
+    memset(datValue.get_data(), 0, datValue.get_size());
+    free(datKey.get_data());
+    free(datValue.get_data());
+    return 0;
+}
+
+
+CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnCloseIn) : pdb(NULL), pldb(NULL), activeTxn(NULL), fLevelDbTxn(false)
 {
     int ret;
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
@@ -246,48 +423,181 @@ CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnClose
 
         strFile = strFilename;
         ++bitdb.mapFileUseCount[strFile];
-        pdb = bitdb.mapDb[strFile];
-        if (pdb == NULL) {
-            pdb = new Db(bitdb.dbenv, 0);
-
-            bool fMockDb = bitdb.IsMock();
-            if (fMockDb) {
-                DbMpoolFile* mpf = pdb->get_mpf();
-                ret = mpf->set_flags(DB_MPOOL_NOFILE, 1);
-                if (ret != 0)
-                    throw runtime_error(strprintf("CDB: Failed to configure for no temp file backing for database %s", strFile));
-            }
-
-            ret = pdb->open(NULL,                               // Txn pointer
-                            fMockDb ? NULL : strFile.c_str(),   // Filename
-                            fMockDb ? strFile.c_str() : "main", // Logical db name
-                            DB_BTREE,                           // Database type
-                            nFlags,                             // Flags
-                            0);
 
-            if (ret != 0) {
-                delete pdb;
-                pdb = NULL;
+        if (GetWalletBackend() == WALLET_BACKEND_LEVELDB) {
+            pldb = bitdb.OpenLevelDb(strFile, fCreate);
+            if (pldb == NULL) {
                 --bitdb.mapFileUseCount[strFile];
                 strFile = "";
-                throw runtime_error(strprintf("CDB: Error %d, can't open database %s", ret, strFilename));
+                throw runtime_error(strprintf("CDB: Can't open LevelDB database %s", strFilename));
             }
-
-            if (fCreate && !Exists(string("version"))) {
-                bool fTmp = fReadOnly;
-                fReadOnly = false;
-                WriteVersion(CLIENT_VERSION);
-                fReadOnly = fTmp;
+        } else {
+            pdb = bitdb.mapDb[strFile];
+            if (pdb == NULL) {
+                pdb = bitdb.OpenBerkeleyDb(strFile, nFlags, ret);
+                if (pdb == NULL) {
+                    --bitdb.mapFileUseCount[strFile];
+                    strFile = "";
+                    throw runtime_error(strprintf("CDB: Error %d, can't open database %s", ret, strFilename));
+                }
+                bitdb.mapDb[strFile] = pdb;
             }
+        }
 
-            bitdb.mapDb[strFile] = pdb;
+        if (fCreate && !Exists(string("version"))) {
+            bool fTmp = fReadOnly;
+            fReadOnly = false;
+            WriteVersion(CLIENT_VERSION);
+            fReadOnly = fTmp;
         }
     }
 }
 
+bool CDB::LevelDbRead(const CDataStream& ssKey, CDataStream& ssValue)
+{
+    std::string strKey(ssKey.begin(), ssKey.end());
+    std::string strValue;
+    if (fLevelDbTxn) {
+        std::map<std::string, std::pair<bool, std::string> >::const_iterator it = mapLevelDbTxn.find(strKey);
+        if (it != mapLevelDbTxn.end()) {
+            if (it->second.first)
+                return false;
+            ssValue.write(it->second.second.data(), it->second.second.size());
+            return true;
+        }
+    }
+
+    leveldb::ReadOptions options;
+    options.verify_checksums = true;
+    leveldb::Status status = pldb->Get(options, strKey, &strValue);
+    memset(&strKey[0], 0, strKey.size());
+    if (!status.ok()) {
+        LevelDbError(status, strFile);
+        return false;
+    }
+    ssValue.write(strValue.data(), strValue.size());
+    memset(&strValue[0], 0, strValue.size());
+    return true;
+}
+
+bool CDB::LevelDbExists(const CDataStream& ssKey)
+{
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    return LevelDbRead(ssKey, ssValue);
+}
+
+bool CDB::LevelDbWrite(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite)
+{
+    if (!fOverwrite && LevelDbExists(ssKey))
+        return false;
+    std::string strKey(ssKey.begin(), ssKey.end());
+    if (fLevelDbTxn) {
+        std::pair<bool, std::string>& entry = mapLevelDbTxn[strKey];
+        memset(&entry.second[0], 0, entry.second.size());
+        entry.first = false;
+        entry.second.assign(ssValue.begin(), ssValue.end());
+        return true;
+    }
+    leveldb::Status status = pldb->Put(leveldb::WriteOptions(), strKey, leveldb::Slice(&ssValue[0], ssValue.size()));
+    return !LevelDbError(status, strFile);
+}
+
+bool CDB::LevelDbErase(const CDataStream& ssKey)
+{
+    std::string strKey(ssKey.begin(), ssKey.end());
+    if (fLevelDbTxn) {
+        std::pair<bool, std::string>& entry = mapLevelDbTxn[strKey];
+        memset(&entry.second[0], 0, entry.second.size());
+        entry.first = true;
+        entry.second.clear();
+        return true;
+    }
+    leveldb::Status status = pldb->Delete(leveldb::WriteOptions(), strKey);
+    return !LevelDbError(status, strFile);
+}
+
+CDBCursor* CDB::GetCursor()
+{
+    if (pldb) {
+        leveldb::ReadOptions options;
+        options.verify_checksums = true;
+        options.fill_cache = false;
+        return new CDBCursor(pldb->NewIterator(options));
+    }
+    if (!pdb)
+        return NULL;
+    Dbc* pcursor = NULL;
+    int ret = pdb->cursor(NULL, &pcursor, 0);
+    if (ret != 0)
+        return NULL;
+    return new CDBCursor(pcursor);
+}
+
+bool CDB::TxnBegin()
+{
+    if (pldb) {
+        if (fLevelDbTxn)
+            return false;
+        fLevelDbTxn = true;
+        return true;
+    }
+    if (!pdb || activeTxn)
+        return false;
+    DbTxn* ptxn = bitdb.TxnBegin();
+    if (!ptxn)
+        return false;
+    activeTxn = ptxn;
+    return true;
+}
+
+bool CDB::TxnCommit()
+{
+    if (pldb) {
+        if (!fLevelDbTxn)
+            return false;
+        // One atomic write, like a Berkeley transaction without sync
+        leveldb::WriteBatch batch;
+        for (std::map<std::string, std::pair<bool, std::string> >::iterator it = mapLevelDbTxn.begin(); it != mapLevelDbTxn.end(); ++it) {
+            if (it->second.first)
+                batch.Delete(it->first);
+            else
+                batch.Put(it->first, it->second.second);
+        }
+        leveldb::Status status = pldb->Write(leveldb::WriteOptions(), &batch);
+        TxnAbort();
+        return !LevelDbError(status, strFile);
+    }
+    if (!pdb || !activeTxn)
+        return false;
+    int ret = activeTxn->commit(0);
+    activeTxn = NULL;
+    return (ret == 0);
+}
+
+bool CDB::TxnAbort()
+{
+    if (pldb) {
+        if (!fLevelDbTxn)
+            return false;
+        for (std::map<std::string, std::pair<bool, std::string> >::iterator it = mapLevelDbTxn.begin(); it != mapLevelDbTxn.end(); ++it)
+            memset(&it->second.second[0], 0, it->second.second.size());
+        mapLevelDbTxn.clear();
+        fLevelDbTxn = false;
+        return true;
+    }
+    if (!pdb || !activeTxn)
+        return false;
+    int ret = activeTxn->abort();
+    activeTxn = NULL;
+    return (ret == 0);
+}
+
 void CDB::Flush()
 {
-    if (activeTxn)
+    if (activeTxn || fLevelDbTxn)
+        return;
+    // LevelDB writes go to its own log as they are made
+    if (pldb)
         return;
 
     // Flush database activity from memory pool to disk log
@@ -300,12 +610,15 @@ void CDB::Flush()
 
 void CDB::Close()
 {
-    if (!pdb)
+    if (!pdb && !pldb)
         return;
     if (activeTxn)
         activeTxn->abort();
     activeTxn = NULL;
+    if (fLevelDbTxn)
+        TxnAbort();
     pdb = NULL;
+    pldb = NULL;
 
     if (fFlushOnClose)
         Flush();
@@ -327,6 +640,11 @@ void CDBEnv::CloseDb(const string& strFile)
             delete pdb;
             mapDb[strFile] = NULL;
         }
+        map<string, leveldb::DB*>::iterator it = mapLevelDb.find(strFile);
+        if (it != mapLevelDb.end()) {
+            delete it->second;
+            mapLevelDb.erase(it);
+        }
     }
 }
 
@@ -335,10 +653,21 @@ bool CDBEnv::RemoveDb(const string& strFile)
     this->CloseDb(strFile);
 
     LOCK(cs_db);
+    if (GetWalletBackend() == WALLET_BACKEND_LEVELDB)
+        return DestroyLevelDb(strFile);
     int rc = dbenv->dbremove(NULL, strFile.c_str(), NULL, DB_AUTO_COMMIT);
     return (rc == 0);
 }
 
+bool CDBEnv::DestroyLevelDb(const string& strFile)
+{
+    AssertLockHeld(cs_db);
+    leveldb::Options options;
+    if (fMockDb)
+        options.env = plevelenvMock;
+    return leveldb::DestroyDB(fMockDb ? strFile : GetWalletDBPath(strFile, WALLET_BACKEND_LEVELDB).string(), options).ok();
+}
+
 bool CDB::Rewrite(const string& strFile, const char* pszSkip)
 {
     while (true) {
@@ -352,6 +681,36 @@ bool CDB::Rewrite(const string& strFile, const char* pszSkip)
 
                 bool fSuccess = true;
                 LogPrintf("CDB::Rewrite: Rewriting %s...\n", strFile);
+                if (GetWalletBackend() == WALLET_BACKEND_LEVELDB) {
+                    // Drop the skipped records, then compact so nothing of them stays behind in the files
+                    leveldb::DB* pldb = bitdb.OpenLevelDb(strFile, false);
+                    if (!pldb)
+                        return false;
+                    leveldb::WriteBatch batch;
+                    leveldb::Iterator* piter = pldb->NewIterator(leveldb::ReadOptions());
+                    for (piter->SeekToFirst(); piter->Valid(); piter->Next()) {
+                        leveldb::Slice key = piter->key();
+                        if (pszSkip && strncmp(key.data(), pszSkip, std::min(key.size(), strlen(pszSkip))) == 0)
+                            batch.Delete(key);
+                    }
+                    fSuccess = piter->status().ok();
+                    delete piter;
+                    if (fSuccess) {
+                        CDataStream ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION);
+                        ssKey << string("version");
+                        ssValue << CLIENT_VERSION;
+                        batch.Put(leveldb::Slice(&ssKey[0], ssKey.size()), leveldb::Slice(&ssValue[0], ssValue.size()));
+                        leveldb::WriteOptions options;
+                        options.sync = true;
+                        fSuccess = pldb->Write(options, &batch).ok();
+                    }
+                    if (fSuccess)
+                        pldb->CompactRange(NULL, NULL);
+                    bitdb.CloseDb(strFile);
+                    if (!fSuccess)
+                        LogPrintf("CDB::Rewrite: Failed to rewrite LevelDB database %s\n", strFile);
+                    return fSuccess;
+                }
                 string strFileRes = strFile + ".rewrite";
                 { // surround usage of db with extra {}
                     CDB db(strFile.c_str(), "r");
@@ -368,7 +727,7 @@ bool CDB::Rewrite(const string& strFile, const char* pszSkip)
                         fSuccess = false;
                     }
 
-                    Dbc* pcursor = db.GetCursor();
+                    CDBCursor* pcursor = db.GetCursor();
                     if (pcursor)
                         while (fSuccess) {
                             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
@@ -423,6 +782,109 @@ bool CDB::Rewrite(const string& strFile, const char* pszSkip)
 }
 
 
+bool CDB::Migrate(const std::string& strFile, WalletDBBackend backendTo)
+{
+    LOCK(bitdb.cs_db);
+    if (bitdb.mapFileUseCount.count(strFile) && bitdb.mapFileUseCount[strFile] != 0)
+        return error("CDB::Migrate: %s is in use", strFile);
+    if (!bitdb.Open(GetDataDir()))
+        return error("CDB::Migrate: Failed to open database environment");
+    bitdb.CloseDb(strFile);
+    bitdb.mapFileUseCount.erase(strFile);
+
+    int ret = 0;
+    unsigned int nRecords = 0;
+    bool fSuccess = true;
+    if (backendTo == WALLET_BACKEND_LEVELDB) {
+        Db* pdbFrom = bitdb.OpenBerkeleyDb(strFile, DB_THREAD | DB_RDONLY, ret);
+        if (!pdbFrom)
+            return error("CDB::Migrate: Error %d, can't open database %s", ret, strFile);
+        leveldb::DB* pldbTo = bitdb.OpenLevelDb(strFile, true, true);
+        Dbc* pcursor = NULL;
+        if (!pldbTo || pdbFrom->cursor(NULL, &pcursor, 0) != 0) {
+            pdbFrom->close(0);
+            delete pdbFrom;
+            bitdb.CloseDb(strFile);
+            return error("CDB::Migrate: Can't create LevelDB database for %s", strFile);
+        }
+
+        leveldb::WriteBatch batch;
+        while (true) {
+            Dbt datKey, datValue;
+            datKey.set_flags(DB_DBT_MALLOC);
+            datValue.set_flags(DB_DBT_MALLOC);
+            ret = pcursor->get(&datKey, &datValue, DB_NEXT);
+            if (ret == DB_NOTFOUND)
+                break;
+            if (ret != 0 || datKey.get_data() == NULL || datValue.get_data() == NULL) {
+                fSuccess = false;
+                break;
+            }
+            batch.Put(leveldb::Slice((const char*)datKey.get_data(), datKey.get_size()),
+                      leveldb::Slice((const char*)datValue.get_data(), datValue.get_size()));
+            memset(datValue.get_data(), 0, datValue.get_size());
+            free(datKey.get_data());
+            free(datValue.get_data());
+            nRecords++;
+        }
+        pcursor->close();
+        pdbFrom->close(0);
+        delete pdbFrom;
+
+        if (fSuccess) {
+            leveldb::WriteOptions options;
+            options.sync = true;
+            fSuccess = !LevelDbError(pldbTo->Write(options, &batch), strFile);
+        }
+        bitdb.CloseDb(strFile);
+        if (!fSuccess) {
+            // Don't leave a half written copy behind for the next start to pick up
+            bitdb.DestroyLevelDb(strFile);
+        }
+    } else {
+        leveldb::DB* pldbFrom = bitdb.OpenLevelDb(strFile, false);
+        if (!pldbFrom)
+            return error("CDB::Migrate: Can't open LevelDB database %s", strFile);
+        Db* pdbTo = bitdb.OpenBerkeleyDb(strFile, DB_THREAD | DB_CREATE | DB_EXCL, ret);
+        if (!pdbTo) {
+            bitdb.CloseDb(strFile);
+            return error("CDB::Migrate: Error %d, can't create database %s", ret, strFile);
+        }
+
+        DbTxn* ptxn = bitdb.TxnBegin();
+        leveldb::Iterator* piter = pldbFrom->NewIterator(leveldb::ReadOptions());
+        for (piter->SeekToFirst(); fSuccess && piter->Valid(); piter->Next()) {
+            Dbt datKey(const_cast<char*>(piter->key().data()), piter->key().size());
+            Dbt datValue(const_cast<char*>(piter->value().data()), piter->value().size());
+            if (pdbTo->put(ptxn, &datKey, &datValue, DB_NOOVERWRITE) != 0)
+                fSuccess = false;
+            nRecords++;
+        }
+        if (!piter->status().ok())
+            fSuccess = false;
+        delete piter;
+        if (ptxn && fSuccess)
+            fSuccess = ptxn->commit(0) == 0;
+        else if (ptxn)
+            ptxn->abort();
+        else
+            fSuccess = false;
+        if (pdbTo->close(0) != 0)
+            fSuccess = false;
+        delete pdbTo;
+        bitdb.CloseDb(strFile);
+        if (fSuccess)
+            bitdb.CheckpointLSN(strFile);
+        else
+            bitdb.dbenv->dbremove(NULL, strFile.c_str(), NULL, DB_AUTO_COMMIT);
+    }
+
+    if (!fSuccess)
+        return error("CDB::Migrate: Failed to copy %s to the %s backend", strFile, backendTo == WALLET_BACKEND_LEVELDB ? "leveldb" : "bdb");
+    LogPrintf("CDB::Migrate: Copied %u records of %s to the %s backend\n", nRecords, strFile, backendTo == WALLET_BACKEND_LEVELDB ? "leveldb" : "bdb");
+    return true;
+}
+
 void CDBEnv::Flush(bool fShutdown)
 {
     int64_t nStart = GetTimeMillis();
@@ -443,7 +905,7 @@ void CDBEnv::Flush(bool fShutdown)
                 LogPrint("db", "CDBEnv::Flush: %s checkpoint\n", strFile);
                 dbenv->txn_checkpoint(0, 0, 0);
                 LogPrint("db", "CDBEnv::Flush: %s detach\n", strFile);
-                if (!fMockDb)
+                if (!fMockDb && GetWalletBackend() == WALLET_BACKEND_BDB)
                     dbenv->lsn_reset(strFile.c_str(), 0);
                 LogPrint("db", "CDBEnv::Flush: %s closed\n", strFile);
                 mapFileUseCount.erase(mi++);
@@ -22,16 +22,39 @@
 
 #include <db_cxx.h>
 
+namespace leveldb {
+class DB;
+class Env;
+class Iterator;
+}
+
 static const unsigned int DEFAULT_WALLET_DBLOGSIZE = 100;
 static const bool DEFAULT_WALLET_PRIVDB = true;
+static const char* const DEFAULT_WALLET_BACKEND = "bdb";
 
 extern unsigned int nWalletDBUpdated;
 
+/** Storage behind CDB, chosen with -walletbackend */
+enum WalletDBBackend
+{
+    WALLET_BACKEND_BDB,     //! one BerkeleyDB file in the shared environment
+    WALLET_BACKEND_LEVELDB, //! one LevelDB directory per wallet, named after the file with .ldb appended
+};
+
+/** Parse a -walletbackend value, returns false for unknown names */
+bool ParseWalletBackend(const std::string& strBackend, WalletDBBackend& backendRet);
+/** The backend selected with -walletbackend */
+WalletDBBackend GetWalletBackend();
+/** Where a wallet file is stored by the given backend */
+boost::filesystem::path GetWalletDBPath(const std::string& strFile, WalletDBBackend backend);
+
 class CDBEnv
 {
 private:
     bool fDbEnvInit;
     bool fMockDb;
+    //! In memory storage for LevelDB wallets of a mock environment
+    leveldb::Env* plevelenvMock;
     // Don't change into boost::filesystem::path, as that can result in
     // shutdown problems/crashes caused by a static initialized internal pointer.
     std::string strPath;
@@ -43,6 +66,7 @@ public:
     DbEnv *dbenv;
     std::map<std::string, int> mapFileUseCount;
     std::map<std::string, Db*> mapDb;
+    std::map<std::string, leveldb::DB*> mapLevelDb;
 
     CDBEnv();
     ~CDBEnv();
@@ -79,6 +103,13 @@ public:
     void CloseDb(const std::string& strFile);
     bool RemoveDb(const std::string& strFile);
 
+    /** Open a BerkeleyDB wallet file, or a mock one, returns NULL and the error in ret on failure */
+    Db* OpenBerkeleyDb(const std::string& strFile, u_int32_t nFlags, int& ret);
+    /** Handle of a LevelDB wallet, opened on first use and kept until CloseDb. Call with cs_db held. */
+    leveldb::DB* OpenLevelDb(const std::string& strFile, bool fCreate, bool fMustBeNew = false);
+    /** Delete the files of a closed LevelDB wallet. Call with cs_db held. */
+    bool DestroyLevelDb(const std::string& strFile);
+
     DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC)
     {
         DbTxn* ptxn = NULL;
@@ -91,14 +122,42 @@ public:
 
 extern CDBEnv bitdb;
 
+/**
+ * Position in a wallet database, of either backend. Closing frees it, like
+ * the Berkeley Dbc it wraps.
+ */
+class CDBCursor
+{
+private:
+    Dbc* pdbc;
+    leveldb::Iterator* piter;
+    bool fPositioned;
+
+    ~CDBCursor() {}
+    CDBCursor(const CDBCursor&);
+    void operator=(const CDBCursor&);
+
+public:
+    explicit CDBCursor(Dbc* pdbcIn) : pdbc(pdbcIn), piter(NULL), fPositioned(false) {}
+    explicit CDBCursor(leveldb::Iterator* piterIn) : pdbc(NULL), piter(piterIn), fPositioned(false) {}
+
+    int close();
+    /** Same flags and results as Dbc::get, LevelDB cursors know DB_NEXT and DB_SET_RANGE */
+    int get(CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags);
+};
+
 
-/** RAII class that provides access to a Berkeley database */
+/** RAII class that provides access to a Berkeley database, or a LevelDB one with -walletbackend=leveldb */
 class CDB
 {
 protected:
     Db* pdb;
+    leveldb::DB* pldb;
     std::string strFile;
     DbTxn* activeTxn;
+    //! Writes of the open LevelDB transaction by key, (false, value) or (true, "") for an erase. Reads see them, cursors don't.
+    std::map<std::string, std::pair<bool, std::string> > mapLevelDbTxn;
+    bool fLevelDbTxn;
     bool fReadOnly;
     bool fFlushOnClose;
 
@@ -113,17 +172,34 @@ private:
     CDB(const CDB&);
     void operator=(const CDB&);
 
+    bool LevelDbRead(const CDataStream& ssKey, CDataStream& ssValue);
+    bool LevelDbWrite(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite);
+    bool LevelDbErase(const CDataStream& ssKey);
+    bool LevelDbExists(const CDataStream& ssKey);
+
 protected:
     template <typename K, typename T>
     bool Read(const K& key, T& value)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (pldb) {
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            if (!LevelDbRead(ssKey, ssValue))
+                return false;
+            try {
+                ssValue >> value;
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Read
@@ -151,7 +227,7 @@ protected:
     template <typename K, typename T>
     bool Write(const K& key, const T& value, bool fOverwrite = true)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
         if (fReadOnly)
             assert(!"Write called on database in read-only mode");
@@ -160,12 +236,15 @@ protected:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
-        Dbt datKey(&ssKey[0], ssKey.size());
 
         // Value
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
         ssValue.reserve(10000);
         ssValue << value;
+
+        if (pldb)
+            return LevelDbWrite(ssKey, ssValue, fOverwrite);
+        Dbt datKey(&ssKey[0], ssKey.size());
         Dbt datValue(&ssValue[0], ssValue.size());
 
         // Write
@@ -180,7 +259,7 @@ protected:
     template <typename K>
     bool Erase(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
         if (fReadOnly)
             assert(!"Erase called on database in read-only mode");
@@ -189,6 +268,9 @@ protected:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (pldb)
+            return LevelDbErase(ssKey);
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Erase
@@ -202,13 +284,16 @@ protected:
     template <typename K>
     bool Exists(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !pldb)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (pldb)
+            return LevelDbExists(ssKey);
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Exists
@@ -219,83 +304,17 @@ protected:
         return (ret == 0);
     }
 
-    Dbc* GetCursor()
-    {
-        if (!pdb)
-            return NULL;
-        Dbc* pcursor = NULL;
-        int ret = pdb->cursor(NULL, &pcursor, 0);
-        if (ret != 0)
-            return NULL;
-        return pcursor;
-    }
+    CDBCursor* GetCursor();
 
-    int ReadAtCursor(Dbc* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
+    int ReadAtCursor(CDBCursor* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
     {
-        // Read at cursor
-        Dbt datKey;
-        if (fFlags == DB_SET || fFlags == DB_SET_RANGE || fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
-            datKey.set_data(&ssKey[0]);
-            datKey.set_size(ssKey.size());
-        }
-        Dbt datValue;
-        if (fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
-            datValue.set_data(&ssValue[0]);
-            datValue.set_size(ssValue.size());
-        }
-        datKey.set_flags(DB_DBT_MALLOC);
-        datValue.set_flags(DB_DBT_MALLOC);
-        int ret = pcursor->get(&datKey, &datValue, fFlags);
-        if (ret != 0)
-            return ret;
-        else if (datKey.get_data() == NULL || datValue.get_data() == NULL)
-            return 99999;
-
-        // Convert to streams
-        ssKey.SetType(SER_DISK);
-        ssKey.clear();
-        ssKey.write((char*)datKey.get_data(), datKey.get_size());
-        ssValue.SetType(SER_DISK);
-        ssValue.clear();
-        ssValue.write((char*)datValue.get_data(), datValue.get_size());
-
-        // Clear and free memory
-        memset(datKey.get_data(), 0, datKey.get_size());
-        memset(datValue.get_data(), 0, datValue.get_size());
-        free(datKey.get_data());
-        free(datValue.get_data());
-        return 0;
+        return pcursor->get(ssKey, ssValue, fFlags);
     }
 
 public:
-    bool TxnBegin()
-    {
-        if (!pdb || activeTxn)
-            return false;
-        DbTxn* ptxn = bitdb.TxnBegin();
-        if (!ptxn)
-            return false;
-        activeTxn = ptxn;
-        return true;
-    }
-
-    bool TxnCommit()
-    {
-        if (!pdb || !activeTxn)
-            return false;
-        int ret = activeTxn->commit(0);
-        activeTxn = NULL;
-        return (ret == 0);
-    }
-
-    bool TxnAbort()
-    {
-        if (!pdb || !activeTxn)
-            return false;
-        int ret = activeTxn->abort();
-        activeTxn = NULL;
-        return (ret == 0);
-    }
+    bool TxnBegin();
+    bool TxnCommit();
+    bool TxnAbort();
 
     bool ReadVersion(int& nVersion)
     {
@@ -309,6 +328,12 @@ public:
     }
 
     bool static Rewrite(const std::string& strFile, const char* pszSkip = NULL);
+    /**
+     * Copy every record of a wallet file from the other backend into a new
+     * one of backendTo. The old file is left alone. Fails if the target
+     * exists already or the file is open.
+     */
+    bool static Migrate(const std::string& strFile, WalletDBBackend backendTo);
 };
 
 #endif // DYNAMIC_WALLET_DB_H
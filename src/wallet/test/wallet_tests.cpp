@@ -4,6 +4,9 @@
 
 #include "wallet/wallet.h"
 
+#include "main.h"
+#include "privatesend.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -361,4 +364,369 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     BOOST_CHECK_EQUAL(setCoinsRet.size(), 101);
 }
 
+
+BOOST_AUTO_TEST_CASE(coin_selection_exact_match)
+{
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+
+    LOCK(wallet.cs_wallet);
+
+    // test multiple times to allow for differences in the shuffle order
+    for (int i = 0; i < RUN_TESTS; i++)
+    {
+        empty_wallet();
+        add_coin(10 * COIN);
+        add_coin(7 * COIN);
+        add_coin(5 * COIN);
+        add_coin(4 * COIN);
+        add_coin(3 * COIN);
+
+        // 12 = 7 + 5, nothing with the 10 adds up
+        BOOST_CHECK(wallet.SelectCoinsMinConf(12 * COIN, 1, 6, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 12 * COIN);
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+
+        // an exact match beats a single larger coin
+        add_coin(20 * COIN);
+        BOOST_CHECK(wallet.SelectCoinsMinConf(12 * COIN, 1, 6, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 12 * COIN);
+
+        // 13 = 10 + 3 takes the largest and the smallest coin below it
+        BOOST_CHECK(wallet.SelectCoinsMinConf(13 * COIN, 1, 6, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 13 * COIN);
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+    }
+
+    // No exact match: fall back to the closest subset above the target
+    for (int i = 0; i < RUN_TESTS; i++)
+    {
+        empty_wallet();
+        add_coin(10 * COIN);
+        add_coin(7 * COIN);
+        add_coin(5 * COIN);
+
+        BOOST_CHECK(wallet.SelectCoinsMinConf(13 * COIN, 1, 6, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 15 * COIN);
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+    }
+
+    // Even coins never make an odd target. The search gives up after its tries
+    // and the approximation still comes up with enough.
+    empty_wallet();
+    for (int i = 1; i <= 60; i++)
+        add_coin(2 * i * COIN);
+    BOOST_CHECK(wallet.SelectCoinsMinConf(301 * COIN, 1, 6, vCoins, setCoinsRet, nValueRet));
+    BOOST_CHECK(nValueRet > 301 * COIN);
+
+    empty_wallet();
+}
+
+BOOST_AUTO_TEST_CASE(wallet_txs_with_unspent)
+{
+    CWallet testWallet;
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+
+    LOCK2(cs_main, testWallet.cs_wallet);
+    BOOST_CHECK(testWallet.AddKeyPubKey(key, pubkey));
+
+    CMutableTransaction txCredit;
+    txCredit.vout.resize(1);
+    txCredit.vout[0].nValue = 1 * COIN;
+    txCredit.vout[0].scriptPubKey = GetScriptForDestination(pubkey.GetID());
+    CWalletTx wtxCredit(&testWallet, txCredit);
+    BOOST_CHECK(testWallet.AddToWallet(wtxCredit, true, NULL));
+
+    std::vector<const CWalletTx*> vWalletTxs;
+    testWallet.GetWalletTxsWithUnspent(vWalletTxs);
+    BOOST_CHECK_EQUAL(vWalletTxs.size(), 1U);
+    BOOST_CHECK(vWalletTxs[0]->GetHash() == wtxCredit.GetHash());
+
+    // Spending the only output drops the credit from the candidate set
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(1);
+    txSpend.vin[0].prevout = COutPoint(wtxCredit.GetHash(), 0);
+    txSpend.vout.resize(1);
+    txSpend.vout[0].nValue = 1 * COIN;
+    CWalletTx wtxSpend(&testWallet, txSpend);
+    BOOST_CHECK(testWallet.AddToWallet(wtxSpend, true, NULL));
+
+    testWallet.GetWalletTxsWithUnspent(vWalletTxs);
+    BOOST_CHECK(vWalletTxs.empty());
+
+    // Abandoning the spend and dirtying the credit brings it back
+    testWallet.mapWallet[wtxSpend.GetHash()].setAbandoned();
+    testWallet.mapWallet[wtxCredit.GetHash()].MarkDirty();
+    testWallet.GetWalletTxsWithUnspent(vWalletTxs);
+    BOOST_CHECK_EQUAL(vWalletTxs.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_db_batch)
+{
+    const std::string strFile = "wallet_batch.dat";
+    std::vector<std::string> vAddresses;
+    for (int i = 0; i < 3; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        vAddresses.push_back(CDynamicAddress(key.GetPubKey().GetID()).ToString());
+    }
+
+    bool fFirstRun;
+    {
+        CWallet wallet(strFile);
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        // The whole keypool goes in one batch
+        BOOST_CHECK(wallet.TopUpKeyPool(20));
+        BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), 21U);
+
+        // A batch opened inside another one joins it
+        CWalletDB walletdb(strFile);
+        CWalletDBBatch batch(&walletdb);
+        BOOST_CHECK(walletdb.WriteName(vAddresses[0], "a"));
+        {
+            CWalletDBBatch batchInner(&walletdb);
+            BOOST_CHECK(walletdb.WriteName(vAddresses[1], "b"));
+            BOOST_CHECK(batchInner.Commit());
+        }
+        BOOST_CHECK(walletdb.WriteName(vAddresses[2], "c"));
+        BOOST_CHECK(batch.Commit());
+        BOOST_CHECK(batch.Commit());
+    }
+
+    // Everything written in the batches is there after a reload
+    CWallet wallet(strFile);
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), 21U);
+    CWalletDB walletdb(strFile, "r");
+    for (int64_t nIndex = 1; nIndex <= 21; nIndex++) {
+        CKeyPool keypool;
+        BOOST_CHECK(walletdb.ReadPool(nIndex, keypool));
+        BOOST_CHECK(wallet.HaveKey(keypool.vchPubKey.GetID()));
+    }
+    BOOST_CHECK_EQUAL(wallet.mapAddressBook[CDynamicAddress(vAddresses[0]).Get()].name, "a");
+    BOOST_CHECK_EQUAL(wallet.mapAddressBook[CDynamicAddress(vAddresses[1]).Get()].name, "b");
+    BOOST_CHECK_EQUAL(wallet.mapAddressBook[CDynamicAddress(vAddresses[2]).Get()].name, "c");
+}
+
+BOOST_AUTO_TEST_CASE(wallet_leveldb_backend)
+{
+    const std::string strFile = "wallet_leveldb.dat";
+    mapArgs["-walletbackend"] = "leveldb";
+    CKey key;
+    key.MakeNewKey(true);
+    CDynamicAddress address(key.GetPubKey().GetID());
+
+    bool fFirstRun;
+    {
+        CWallet wallet(strFile);
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        BOOST_CHECK(fFirstRun);
+        BOOST_CHECK(wallet.TopUpKeyPool(10));
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+
+        // Reads inside a batch see what it wrote before it is committed, an aborted one is dropped
+        CWalletDB walletdb(strFile);
+        CWalletDBBatch batch(&walletdb);
+        BOOST_CHECK(walletdb.WriteName(address.ToString(), "kept"));
+        BOOST_CHECK(walletdb.WritePurpose(address.ToString(), "receive"));
+        BOOST_CHECK(walletdb.ErasePurpose(address.ToString()));
+        BOOST_CHECK(batch.Commit());
+        BOOST_CHECK(walletdb.TxnBegin());
+        BOOST_CHECK(walletdb.WriteName(address.ToString(), "dropped"));
+        BOOST_CHECK(walletdb.TxnAbort());
+    }
+
+    // The cursor loads everything back
+    {
+        CWallet wallet(strFile);
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        BOOST_CHECK(!fFirstRun);
+        BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), 11U);
+        BOOST_CHECK(wallet.HaveKey(key.GetPubKey().GetID()));
+        BOOST_CHECK_EQUAL(wallet.mapAddressBook[address.Get()].name, "kept");
+        BOOST_CHECK_EQUAL(wallet.mapAddressBook[address.Get()].purpose, "");
+    }
+    mapArgs.erase("-walletbackend");
+}
+
+BOOST_AUTO_TEST_CASE(wallet_migrate_backend)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CDynamicAddress address(key.GetPubKey().GetID());
+
+    // BerkeleyDB to LevelDB
+    bool fFirstRun;
+    {
+        CWallet wallet("wallet_migrate.dat");
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+        BOOST_CHECK(wallet.SetAddressBook(address.Get(), "migrated", "receive"));
+
+        // Not while the file is open
+        CWalletDB walletdb("wallet_migrate.dat");
+        BOOST_CHECK(!CDB::Migrate("wallet_migrate.dat", WALLET_BACKEND_LEVELDB));
+    }
+    BOOST_CHECK(CDB::Migrate("wallet_migrate.dat", WALLET_BACKEND_LEVELDB));
+    // An existing copy is never overwritten
+    BOOST_CHECK(!CDB::Migrate("wallet_migrate.dat", WALLET_BACKEND_LEVELDB));
+
+    mapArgs["-walletbackend"] = "leveldb";
+    {
+        CWallet wallet("wallet_migrate.dat");
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        BOOST_CHECK(!fFirstRun);
+        BOOST_CHECK(wallet.HaveKey(key.GetPubKey().GetID()));
+        BOOST_CHECK_EQUAL(wallet.mapAddressBook[address.Get()].name, "migrated");
+        BOOST_CHECK_EQUAL(wallet.mapAddressBook[address.Get()].purpose, "receive");
+
+        // And back from LevelDB, under a name BerkeleyDB doesn't have yet
+        CWallet walletLevelDb("wallet_migrate_back.dat");
+        BOOST_CHECK_EQUAL(walletLevelDb.LoadWallet(fFirstRun), DB_LOAD_OK);
+        LOCK(walletLevelDb.cs_wallet);
+        BOOST_CHECK(walletLevelDb.AddKeyPubKey(key, key.GetPubKey()));
+        BOOST_CHECK(walletLevelDb.SetAddressBook(address.Get(), "back", "send"));
+    }
+    BOOST_CHECK(CDB::Migrate("wallet_migrate_back.dat", WALLET_BACKEND_BDB));
+    mapArgs.erase("-walletbackend");
+
+    CWallet wallet("wallet_migrate_back.dat");
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    BOOST_CHECK(!fFirstRun);
+    BOOST_CHECK(wallet.HaveKey(key.GetPubKey().GetID()));
+    BOOST_CHECK_EQUAL(wallet.mapAddressBook[address.Get()].name, "back");
+    BOOST_CHECK_EQUAL(wallet.mapAddressBook[address.Get()].purpose, "send");
+}
+
+BOOST_AUTO_TEST_CASE(wallet_privatesend_rounds_cache)
+{
+    privateSendPool.InitDenominations();
+    const CAmount nDenom = COIN + 1000;
+
+    // Transactions have to arrive the way new ones do, not the way they are loaded
+    bool fFirstRun;
+    CWallet testWallet("wallet_rounds.dat");
+    BOOST_CHECK_EQUAL(testWallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    CWalletDB walletdb("wallet_rounds.dat");
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    LOCK2(cs_main, testWallet.cs_wallet);
+    BOOST_CHECK(testWallet.AddKeyPubKey(key, key.GetPubKey()));
+
+    // A pays us a denomination from outside, B and C pass it on
+    CMutableTransaction txA;
+    txA.vin.resize(1);
+    txA.vin[0].prevout = COutPoint(uint256S("0x1"), 0);
+    txA.vout.push_back(CTxOut(nDenom, scriptPubKey));
+    CMutableTransaction txB;
+    txB.vin.resize(1);
+    txB.vin[0].prevout = COutPoint(txA.GetHash(), 0);
+    txB.vout.push_back(CTxOut(nDenom, scriptPubKey));
+    CMutableTransaction txC;
+    txC.vin.resize(1);
+    txC.vin[0].prevout = COutPoint(txB.GetHash(), 0);
+    txC.vout.push_back(CTxOut(nDenom, scriptPubKey));
+    CTxIn txinB(COutPoint(txB.GetHash(), 0));
+    CTxIn txinC(COutPoint(txC.GetHash(), 0));
+
+    // Without its parent B starts a chain
+    CWalletTx wtxB(&testWallet, txB);
+    BOOST_CHECK(testWallet.AddToWallet(wtxB, false, &walletdb));
+    BOOST_CHECK_EQUAL(testWallet.GetRealInputPrivateSendRounds(txinB, 0), 0);
+    BOOST_CHECK(!testWallet.mapWallet[txB.GetHash()].vPrivateSendRoundsCached.empty());
+
+    // A new parent drops the cached rounds of what spends it
+    CWalletTx wtxA(&testWallet, txA);
+    BOOST_CHECK(testWallet.AddToWallet(wtxA, false, &walletdb));
+    BOOST_CHECK(testWallet.mapWallet[txB.GetHash()].vPrivateSendRoundsCached.empty());
+    BOOST_CHECK_EQUAL(testWallet.GetRealInputPrivateSendRounds(txinB, 0), 1);
+
+    // Spending B builds on its cached rounds and leaves them alone
+    CWalletTx wtxC(&testWallet, txC);
+    BOOST_CHECK(testWallet.AddToWallet(wtxC, false, &walletdb));
+    BOOST_CHECK(!testWallet.mapWallet[txB.GetHash()].vPrivateSendRoundsCached.empty());
+    BOOST_CHECK_EQUAL(testWallet.GetRealInputPrivateSendRounds(txinC, 0), 2);
+    BOOST_CHECK_EQUAL(testWallet.GetRealInputPrivateSendRounds(txinB, 0), 1);
+
+    // A transaction marked dirty computes them again
+    testWallet.mapWallet[txB.GetHash()].MarkDirty();
+    BOOST_CHECK(testWallet.mapWallet[txB.GetHash()].vPrivateSendRoundsCached.empty());
+    BOOST_CHECK_EQUAL(testWallet.GetRealInputPrivateSendRounds(txinB, 0), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(wallet_rescan, TestChain100Setup)
+{
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    CScript otherScript = GetScriptForDestination(otherKey.GetPubKey().GetID());
+    CScript coinbaseScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Spend the first coinbase to somebody else, in a block that pays somebody else too
+    std::vector<CMutableTransaction> spends(1);
+    spends[0].vin.resize(1);
+    spends[0].vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spends[0].vout.push_back(CTxOut(11 * CENT, otherScript));
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbaseScript, spends[0], 0, SIGHASH_ALL);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spends[0].vin[0].scriptSig << vchSig;
+    CBlock block = CreateAndProcessBlock(spends, otherScript);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    int nCoinbases = coinbaseTxns.size();
+
+    // The coinbases pay to our key, the spend is only found through its input
+    bool fFirstRun;
+    CWallet testWallet("wallet_rescan.dat");
+    BOOST_CHECK_EQUAL(testWallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    {
+        LOCK(testWallet.cs_wallet);
+        BOOST_CHECK(testWallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey()));
+    }
+    BOOST_CHECK_EQUAL(testWallet.ScanForWalletTransactions(chainActive.Genesis()), nCoinbases + 1);
+    {
+        LOCK(testWallet.cs_wallet);
+        BOOST_FOREACH(const CTransaction& tx, coinbaseTxns)
+            BOOST_CHECK(testWallet.mapWallet.count(tx.GetHash()));
+        BOOST_CHECK(testWallet.mapWallet.count(spends[0].GetHash()));
+        BOOST_CHECK(!testWallet.mapWallet.count(block.vtx[0].GetHash()));
+    }
+
+    // Known transactions are only counted again when updating, with a single reader too
+    BOOST_CHECK_EQUAL(testWallet.ScanForWalletTransactions(chainActive.Genesis()), 0);
+    int nScriptCheckThreadsPrev = nScriptCheckThreads;
+    nScriptCheckThreads = 0;
+    BOOST_CHECK_EQUAL(testWallet.ScanForWalletTransactions(chainActive.Genesis(), true), nCoinbases + 1);
+    nScriptCheckThreads = nScriptCheckThreadsPrev;
+
+    // Starting later skips the blocks before
+    CWallet laterWallet("wallet_rescan_later.dat");
+    BOOST_CHECK_EQUAL(laterWallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    {
+        LOCK(laterWallet.cs_wallet);
+        BOOST_CHECK(laterWallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey()));
+    }
+    BOOST_CHECK_EQUAL(laterWallet.ScanForWalletTransactions(chainActive[nCoinbases]), 1);
+
+    // Watch-only scripts are looked for as well
+    CWallet watchWallet("wallet_rescan_watch.dat");
+    BOOST_CHECK_EQUAL(watchWallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    {
+        LOCK(watchWallet.cs_wallet);
+        BOOST_CHECK(watchWallet.AddWatchOnly(otherScript));
+    }
+    BOOST_CHECK_EQUAL(watchWallet.ScanForWalletTransactions(chainActive.Genesis()), 2);
+    {
+        LOCK(watchWallet.cs_wallet);
+        BOOST_CHECK(watchWallet.mapWallet.count(spends[0].GetHash()));
+        BOOST_CHECK(watchWallet.mapWallet.count(block.vtx[0].GetHash()));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
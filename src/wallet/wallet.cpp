@@ -110,7 +110,7 @@ CPubKey CWallet::GenerateNewKey()
 
     // Compressed public keys were introduced in version 0.6.0
     if (fCompressed)
-        SetMinVersion(FEATURE_COMPRPUBKEY);
+        SetMinVersion(FEATURE_COMPRPUBKEY, pwalletdbBatch);
 
     CPubKey pubkey = secret.GetPubKey();
     assert(secret.VerifyPubKey(pubkey));
@@ -144,6 +144,10 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     if (!fFileBacked)
         return true;
     if (!IsCrypted()) {
+        if (pwalletdbBatch)
+            return pwalletdbBatch->WriteKey(pubkey,
+                                            secret.GetPrivKey(),
+                                            mapKeyMetadata[pubkey.GetID()]);
         return CWalletDB(strWalletFile).WriteKey(pubkey,
                                                  secret.GetPrivKey(),
                                                  mapKeyMetadata[pubkey.GetID()]);
@@ -164,6 +168,10 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey,
             return pwalletdbEncryption->WriteCryptedKey(vchPubKey,
                                                         vchCryptedSecret,
                                                         mapKeyMetadata[vchPubKey.GetID()]);
+        else if (pwalletdbBatch)
+            return pwalletdbBatch->WriteCryptedKey(vchPubKey,
+                                                   vchCryptedSecret,
+                                                   mapKeyMetadata[vchPubKey.GetID()]);
         else
             return CWalletDB(strWalletFile).WriteCryptedKey(vchPubKey,
                                                             vchCryptedSecret,
@@ -455,6 +463,31 @@ bool CWallet::Verify(const string& walletFile, string& warningString, string& er
         }
     }
     
+    // A wallet kept by the other backend is only copied over when asked to
+    WalletDBBackend backend = GetWalletBackend();
+    WalletDBBackend backendOther = (backend == WALLET_BACKEND_BDB ? WALLET_BACKEND_LEVELDB : WALLET_BACKEND_BDB);
+    if (!boost::filesystem::exists(GetWalletDBPath(walletFile, backend)) && boost::filesystem::exists(GetWalletDBPath(walletFile, backendOther)))
+    {
+        if (!GetBoolArg("-migratewallet", false)) {
+            errorString += strprintf(_("%s is stored with the other wallet backend, restart with -migratewallet to copy it to this one"), walletFile);
+            return true;
+        }
+        if (!CDB::Migrate(walletFile, backend)) {
+            errorString += strprintf(_("Error copying %s to the new wallet backend, see debug.log for details"), walletFile);
+            return true;
+        }
+        warningString += strprintf(_("Warning: %s was copied to the new wallet backend. The old copy at %s was left in place."),
+                                   walletFile, GetWalletDBPath(walletFile, backendOther).string());
+    }
+
+    // Salvage and verification are BerkeleyDB's, LevelDB checks its files itself when opening them
+    if (backend != WALLET_BACKEND_BDB)
+    {
+        if (GetBoolArg("-salvagewallet", false))
+            errorString += _("-salvagewallet only works with -walletbackend=bdb");
+        return true;
+    }
+
     if (GetBoolArg("-salvagewallet", false))
     {
         // Recover readable keypairs:
@@ -687,6 +720,39 @@ void CWallet::MarkDirty()
     fAnonymizableTallyCachedNonDenom = false;
 }
 
+void CWallet::MarkWalletTxUnspent(const uint256& wtxid) const
+{
+    LOCK(cs_wallet);
+    setWalletTxsWithUnspent.insert(wtxid);
+}
+
+void CWallet::GetWalletTxsWithUnspent(std::vector<const CWalletTx*>& vWalletTxs) const
+{
+    AssertLockHeld(cs_wallet);
+    vWalletTxs.clear();
+    std::set<uint256>::iterator it = setWalletTxsWithUnspent.begin();
+    while (it != setWalletTxsWithUnspent.end())
+    {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(*it);
+        if (mit == mapWallet.end()) {
+            setWalletTxsWithUnspent.erase(it++);
+            continue;
+        }
+
+        const CWalletTx& wtx = mit->second;
+        bool fUnspent = false;
+        for (unsigned int i = 0; i < wtx.vout.size() && !fUnspent; i++)
+            fUnspent = IsMine(wtx.vout[i]) != ISMINE_NO && !IsSpent(*it, i);
+
+        if (fUnspent) {
+            vWalletTxs.push_back(&wtx);
+            ++it;
+        } else {
+            setWalletTxsWithUnspent.erase(it++);
+        }
+    }
+}
+
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb)
 {
     uint256 hash = wtxIn.GetHash();
@@ -710,6 +776,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
     else
     {
         LOCK(cs_wallet);
+        // order position and transaction are written together
+        CWalletDBBatch batch(pwalletdb);
         // Inserts only if not already there, returns tx inserted or tx found
         pair<map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.insert(make_pair(hash, wtxIn));
         CWalletTx& wtx = (*ret.first).second;
@@ -766,6 +834,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
                              wtxIn.hashBlock.ToString());
             }
             AddToSpends(hash);
+            // wallet transactions spending this one may have been counted without it
+            ResetPrivateSendRounds(hash);
         }
 
         bool fUpdated = false;
@@ -802,6 +872,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         if (fInsertedNew || fUpdated)
             if (!wtx.WriteToDisk(pwalletdb))
                 return false;
+        if (!batch.Commit())
+            return false;
 
         // Break debit/credit balance caches:
         wtx.MarkDirty();
@@ -1046,8 +1118,6 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
 // Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
 int CWallet::GetRealInputPrivateSendRounds(CTxIn txin, int nRounds) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
-
     if(nRounds >= 16) return 15; // 16 rounds max
 
     uint256 hash = txin.prevout.hash;
@@ -1056,17 +1126,6 @@ int CWallet::GetRealInputPrivateSendRounds(CTxIn txin, int nRounds) const
     const CWalletTx* wtx = GetWalletTx(hash);
     if(wtx != NULL)
     {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
-
-
         // bounds check
         if (nout >= wtx->vout.size()) {
             // should never actually hit this
@@ -1074,54 +1133,85 @@ int CWallet::GetRealInputPrivateSendRounds(CTxIn txin, int nRounds) const
             return -4;
         }
 
-        if (IsCollateralAmount(wtx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
-
-        //make sure the final output is non-denominate
-        if (!IsDenominatedAmount(wtx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
-
-        bool fAllDenoms = true;
-        BOOST_FOREACH(CTxOut out, wtx->vout) {
-            fAllDenoms = fAllDenoms && IsDenominatedAmount(out.nValue);
+        if (wtx->vPrivateSendRoundsCached.empty()) {
+            // not known yet, let's add it
+            LogPrint("privatesend", "GetRealInputPrivateSendRounds INSERTING %s\n", hash.ToString());
+            wtx->vPrivateSendRoundsCached.assign(wtx->vout.size(), -10);
+        } else if (wtx->vPrivateSendRoundsCached[nout] != -10) {
+            // found and it's not an initial value, just return it
+            return wtx->vPrivateSendRoundsCached[nout];
         }
 
-        // this one is denominated but there is another non-denominated output found in the same tx
-        if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+        int nRoundsRet;
+        if (IsCollateralAmount(wtx->vout[nout].nValue)) {
+            nRoundsRet = -3;
+        } else if (!IsDenominatedAmount(wtx->vout[nout].nValue)) { //NOT DENOM
+            //make sure the final output is non-denominate
+            nRoundsRet = -2;
+        } else {
+            bool fAllDenoms = true;
+            BOOST_FOREACH(const CTxOut& out, wtx->vout) {
+                fAllDenoms = fAllDenoms && IsDenominatedAmount(out.nValue);
+            }
 
-        int nShortest = -10; // an initial value, should be no way to get this by calculations
-        bool fDenomFound = false;
-        // only denoms here so let's look up
-        BOOST_FOREACH(CTxIn txinNext, wtx->vin) {
-            if (IsMine(txinNext)) {
-                int n = GetRealInputPrivateSendRounds(txinNext, nRounds + 1);
-                // denom found, find the shortest chain or initially assign nShortest with the first found value
-                if(n >= 0 && (n < nShortest || nShortest == -10)) {
-                    nShortest = n;
-                    fDenomFound = true;
+            if (!fAllDenoms) {
+                // this one is denominated but there is another non-denominated output found in the same tx
+                nRoundsRet = 0;
+            } else {
+                int nShortest = -10; // an initial value, should be no way to get this by calculations
+                bool fDenomFound = false;
+                // only denoms here so let's look up, parents answer from their own cache
+                BOOST_FOREACH(const CTxIn& txinNext, wtx->vin) {
+                    if (IsMine(txinNext)) {
+                        int n = GetRealInputPrivateSendRounds(txinNext, nRounds + 1);
+                        // denom found, find the shortest chain or initially assign nShortest with the first found value
+                        if(n >= 0 && (n < nShortest || nShortest == -10)) {
+                            nShortest = n;
+                            fDenomFound = true;
+                        }
+                    }
                 }
+                nRoundsRet = fDenomFound
+                        ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
+                        : 0;            // too bad, we are the fist one in that chain
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
-                ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
-                : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
+
+        wtx->vPrivateSendRoundsCached[nout] = nRoundsRet;
+        LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRoundsRet);
+        return nRoundsRet;
     }
 
     return nRounds - 1;
 }
 
+void CWallet::ResetPrivateSendRounds(const uint256& hashTx)
+{
+    AssertLockHeld(cs_wallet);
+
+    // Rounds are derived from the inputs, so everything downstream may change too
+    std::set<uint256> done;
+    std::vector<uint256> todo(1, hashTx);
+    while (!todo.empty())
+    {
+        uint256 hash = todo.back();
+        todo.pop_back();
+        if (!done.insert(hash).second)
+            continue;
+
+        std::map<uint256, CWalletTx>::iterator mi = mapWallet.find(hash);
+        if (mi == mapWallet.end())
+            continue;
+        mi->second.vPrivateSendRoundsCached.clear();
+
+        for (unsigned int i = 0; i < mi->second.vout.size(); i++) {
+            std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, i));
+            for (TxSpends::const_iterator it = range.first; it != range.second; ++it)
+                todo.push_back(it->second);
+        }
+    }
+}
+
 // respect current settings
 int CWallet::GetInputPrivateSendRounds(CTxIn txin) const
 {
@@ -1385,6 +1475,175 @@ bool CWalletTx::WriteToDisk(CWalletDB *pwalletdb)
     return pwalletdb->WriteTx(GetHash(), *this);
 }
 
+// P2PKH and P2PK of every key, P2SH of every redeem script and the watch-only scripts
+void CWallet::GetRescanScripts(std::set<CScript>& setScripts) const
+{
+    setScripts.clear();
+
+    std::set<CKeyID> setKeyIDs;
+    GetKeys(setKeyIDs);
+    BOOST_FOREACH(const CKeyID& keyID, setKeyIDs)
+    {
+        setScripts.insert(GetScriptForDestination(keyID));
+        CPubKey pubkey;
+        if (GetPubKey(keyID, pubkey))
+            setScripts.insert(GetScriptForRawPubKey(pubkey));
+    }
+
+    LOCK(cs_KeyStore);
+    BOOST_FOREACH(const PAIRTYPE(CScriptID, CScript)& item, mapScripts)
+        setScripts.insert(GetScriptForDestination(item.first));
+    BOOST_FOREACH(const CScript& script, setWatchOnly)
+        setScripts.insert(script);
+}
+
+bool CWallet::IsRescanCandidate(const CTransaction& tx) const
+{
+    AssertLockHeld(cs_wallet);
+    if (mapWallet.count(tx.GetHash()))
+        return true;
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Reads the blocks of a rescan on worker threads, a bounded number of blocks
+ * ahead of the thread that applies them. Workers get the block positions and
+ * headers up front so they never take cs_main, and flag the transactions with
+ * an output paying to one of the wallet's scripts.
+ */
+class CWalletRescanReader
+{
+public:
+    struct CRescanBlock
+    {
+        CBlockIndex* pindex;
+        CDiskBlockPos pos;
+        CBlockHeader header;
+    };
+
+private:
+    struct CSlot
+    {
+        boost::shared_ptr<CBlock> pblock;
+        std::vector<bool> vMatch;
+        bool fRead;
+        bool fDone;
+
+        CSlot() : fRead(false), fDone(false) {}
+    };
+
+    const std::vector<CRescanBlock>& vBlocks;
+    const std::set<CScript>& setScripts;
+    std::vector<CSlot> vSlots;
+    boost::mutex mutex;
+    boost::condition_variable condRead;
+    boost::condition_variable condFree;
+    size_t nNext;
+    size_t nConsumed;
+    bool fQuit;
+    boost::thread_group threadGroup;
+
+    bool IsCandidate(const CScript& scriptPubKey) const
+    {
+        if (setScripts.count(scriptPubKey))
+            return true;
+        // Bare multisig is ours when we hold all of its keys, which no single script in the set covers
+        std::vector<std::vector<unsigned char> > vSolutions;
+        txnouttype whichType;
+        return !scriptPubKey.IsPayToScriptHash() && Solver(scriptPubKey, whichType, vSolutions) && whichType == TX_MULTISIG;
+    }
+
+    void ThreadRead()
+    {
+        RenameThread("dynamic-rescan");
+        while (true)
+        {
+            size_t nPos;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (!fQuit && nNext < vBlocks.size() && nNext >= nConsumed + vSlots.size())
+                    condFree.wait(lock);
+                if (fQuit || nNext >= vBlocks.size())
+                    return;
+                nPos = nNext++;
+            }
+
+            boost::shared_ptr<CBlock> pblock(new CBlock());
+            std::vector<bool> vMatch;
+            bool fRead = ReadIndexedBlockFromDisk(*pblock, vBlocks[nPos].pos, vBlocks[nPos].header);
+            if (fRead) {
+                vMatch.resize(pblock->vtx.size(), false);
+                for (unsigned int i = 0; i < pblock->vtx.size(); i++) {
+                    BOOST_FOREACH(const CTxOut& txout, pblock->vtx[i].vout) {
+                        if (IsCandidate(txout.scriptPubKey)) {
+                            vMatch[i] = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                CSlot& slot = vSlots[nPos % vSlots.size()];
+                slot.pblock = pblock;
+                slot.vMatch.swap(vMatch);
+                slot.fRead = fRead;
+                slot.fDone = true;
+            }
+            condRead.notify_all();
+        }
+    }
+
+public:
+    CWalletRescanReader(const std::vector<CRescanBlock>& vBlocksIn, const std::set<CScript>& setScriptsIn, int nThreads) :
+        vBlocks(vBlocksIn), setScripts(setScriptsIn), vSlots(16 * nThreads), nNext(0), nConsumed(0), fQuit(false)
+    {
+        for (int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind(&CWalletRescanReader::ThreadRead, this));
+    }
+
+    ~CWalletRescanReader()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fQuit = true;
+        }
+        condFree.notify_all();
+        threadGroup.join_all();
+    }
+
+    /**
+     * Wait for the next block in chain order, with vMatch flagging the
+     * transactions that pay to the wallet. Returns false if the block
+     * could not be read.
+     */
+    bool Next(boost::shared_ptr<CBlock>& pblock, std::vector<bool>& vMatch)
+    {
+        bool fRead;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            assert(nConsumed < vBlocks.size());
+            CSlot& slot = vSlots[nConsumed % vSlots.size()];
+            while (!slot.fDone)
+                condRead.wait(lock);
+            pblock.swap(slot.pblock);
+            slot.pblock.reset();
+            vMatch.swap(slot.vMatch);
+            fRead = slot.fRead;
+            slot.fDone = false;
+            nConsumed++;
+        }
+        condFree.notify_all();
+        return fRead;
+    }
+};
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1396,38 +1655,83 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
     int64_t nNow = GetTime();
     const CChainParams& chainParams = Params();
 
+    std::set<CScript> setScripts;
+    GetRescanScripts(setScripts);
+
     CBlockIndex* pindex = pindexStart;
+    double dProgressTip;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex)
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
+    }
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+    int nThreads = std::max(nScriptCheckThreads, 1);
+    while (pindex)
+    {
+        // Scan up to the tip as it is now, blocks connected meanwhile are taken in the next round
+        std::vector<CWalletRescanReader::CRescanBlock> vBlocks;
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+            LOCK(cs_main);
+            for (; pindex; pindex = chainActive.Next(pindex)) {
+                CWalletRescanReader::CRescanBlock item;
+                item.pindex = pindex;
+                item.pos = pindex->GetBlockPos();
+                item.header = pindex->GetBlockHeader();
+                vBlocks.push_back(item);
+            }
+        }
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex, Params().GetConsensus());
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
-            {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                    ret++;
+        CWalletRescanReader reader(vBlocks, setScripts, nThreads);
+        BOOST_FOREACH(const CWalletRescanReader::CRescanBlock& item, vBlocks)
+        {
+            if (item.pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), item.pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+            boost::shared_ptr<CBlock> pblock;
+            std::vector<bool> vMatch;
+            if (reader.Next(pblock, vMatch)) {
+                bool fCandidate = std::find(vMatch.begin(), vMatch.end(), true) != vMatch.end();
+                if (!fCandidate) {
+                    LOCK(cs_wallet);
+                    for (unsigned int i = 0; i < pblock->vtx.size() && !fCandidate; i++)
+                        fCandidate = IsRescanCandidate(pblock->vtx[i]);
+                }
+
+                // Apply the whole block in order, so transactions spending
+                // outputs found earlier in the same block are caught too
+                if (fCandidate) {
+                    LOCK2(cs_main, cs_wallet);
+                    // The block may have been disconnected while it was read
+                    if (chainActive.Contains(item.pindex)) {
+                        for (unsigned int i = 0; i < pblock->vtx.size(); i++)
+                        {
+                            if (!vMatch[i] && !IsRescanCandidate(pblock->vtx[i]))
+                                continue;
+                            if (AddToWalletIfInvolvingMe(pblock->vtx[i], pblock.get(), fUpdate))
+                                ret++;
+                        }
+                    }
+                }
             }
-            pindex = chainActive.Next(pindex);
+
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
+                LogPrintf("Still rescanning. At block %d. Progress=%f\n", item.pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), item.pindex));
             }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+        LOCK(cs_main);
+        pindex = chainActive.Next(chainActive.FindFork(vBlocks.back().pindex));
     }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -1495,6 +1799,26 @@ set<uint256> CWalletTx::GetConflicts() const
     return result;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fAnonymizedCreditCached = false;
+    fDenomUnconfCreditCached = false;
+    fDenomConfCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+    vPrivateSendRoundsCached.clear();
+
+    // whatever made this dirty may have unspent some of its outputs
+    if (pwallet)
+        pwallet->MarkWalletTxUnspent(GetHash());
+}
+
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
 {
     if (vin.empty())
@@ -1846,9 +2170,10 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -1882,9 +2207,10 @@ CAmount CWallet::GetAnonymizedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
 
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAnonymizedCredit();
@@ -1905,11 +2231,11 @@ double CWallet::GetAverageAnonymizedRounds() const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
-
-            uint256 hash = (*it).first;
+            uint256 hash = pcoin->GetHash();
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
 
@@ -1939,11 +2265,11 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
-
-            uint256 hash = (*it).first;
+            uint256 hash = pcoin->GetHash();
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
 
@@ -1992,9 +2318,10 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
 
             nTotal += pcoin->GetDenominatedCredit(unconfirmed);
         }
@@ -2008,9 +2335,10 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2037,9 +2365,10 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2053,9 +2382,10 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2083,10 +2413,11 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        std::vector<const CWalletTx*> vWalletTxs;
+        GetWalletTxsWithUnspent(vWalletTxs);
+        BOOST_FOREACH(const CWalletTx* pcoin, vWalletTxs)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -2126,9 +2457,9 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
                 isminetype mine = IsMine(pcoin->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000) &&
+                    (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_1000) &&
                     (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected((*it).first, i)))
+                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(wtxid, i)))
                         vCoins.push_back(COutput(pcoin, i, nDepth,
                                                  ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
                                                   (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO)));
@@ -2137,7 +2468,7 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
     }
 }
 
-static void ApproximateBestSubset(vector<pair<CAmount, pair<const CWalletTx*,unsigned int> > >vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
+static void ApproximateBestSubset(const vector<pair<CAmount, pair<const CWalletTx*,unsigned int> > >& vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
                                   vector<char>& vfBest, CAmount& nBest, int iterations = 1000)
 {
     vector<char> vfIncluded;
@@ -2193,22 +2524,62 @@ static void ApproximateBestSubset(vector<pair<CAmount, pair<const CWalletTx*,uns
     }
 }
 
-// move denoms down
-bool less_then_denom (const COutput& out1, const COutput& out2)
+/**
+ * Depth first search for a subset of vValue (sorted by descending value) that
+ * adds up to exactly nTargetValue, so the transaction needs no change output.
+ * A branch is cut as soon as it overshoots or the coins left can't reach the
+ * target anymore, and a coin isn't tried in place of an excluded coin of the
+ * same value. Gives up after nMaxTries steps.
+ */
+static bool SelectCoinsBnB(const vector<pair<CAmount, pair<const CWalletTx*,unsigned int> > >& vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
+                           vector<char>& vfBest, int nMaxTries = 100000)
 {
-    const CWalletTx *pcoin1 = out1.tx;
-    const CWalletTx *pcoin2 = out2.tx;
+    vector<char> vfIncluded(vValue.size(), false);
+    CAmount nSelected = 0;
+    CAmount nRemaining = nTotalLower; // value of the coins from position i on
+    unsigned int i = 0;
 
-    bool found1 = false;
-    bool found2 = false;
-    BOOST_FOREACH(CAmount d, vecPrivateSendDenominations) // loop through predefined denoms
+    for (int nTries = 0; nTries < nMaxTries; nTries++)
     {
-        if(pcoin1->vout[out1.i].nValue == d) found1 = true;
-        if(pcoin2->vout[out2.i].nValue == d) found2 = true;
+        if (nSelected == nTargetValue)
+        {
+            vfBest = vfIncluded;
+            return true;
+        }
+
+        if (nSelected > nTargetValue || nSelected + nRemaining < nTargetValue)
+        {
+            // backtrack to the last included coin and exclude it
+            while (i > 0 && !vfIncluded[i - 1])
+                nRemaining += vValue[--i].first;
+            if (i == 0)
+                return false;
+            vfIncluded[i - 1] = false;
+            nSelected -= vValue[i - 1].first;
+            continue;
+        }
+
+        bool fSkip = i > 0 && !vfIncluded[i - 1] && vValue[i].first == vValue[i - 1].first;
+        if (!fSkip)
+        {
+            vfIncluded[i] = true;
+            nSelected += vValue[i].first;
+        }
+        nRemaining -= vValue[i].first;
+        i++;
     }
-    return (!found1 && found2);
+    return false;
 }
 
+// non-denominated outputs first, so mixed coins are only spent when needed
+struct IsNonDenominatedOutput
+{
+    bool operator()(const COutput& out) const
+    {
+        return std::find(vecPrivateSendDenominations.begin(), vecPrivateSendDenominations.end(), out.tx->vout[out.i].nValue) == vecPrivateSendDenominations.end();
+    }
+};
+
 bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, vector<COutput> vCoins,
                                  set<pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const
 {
@@ -2225,7 +2596,7 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     random_shuffle(vCoins.begin(), vCoins.end(), GetRandInt);
 
     // move denoms down on the list
-    sort(vCoins.begin(), vCoins.end(), less_then_denom);
+    stable_partition(vCoins.begin(), vCoins.end(), IsNonDenominatedOutput());
 
     // try to find nondenom first to prevent unneeded spending of mixed coins
     for (unsigned int tryDenom = 0; tryDenom < 2; tryDenom++)
@@ -2303,9 +2674,16 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     vector<char> vfBest;
     CAmount nBest;
 
-    ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
-    if (nBest != nTargetValue && nTotalLower >= nTargetValue + MIN_CHANGE)
-        ApproximateBestSubset(vValue, nTotalLower, nTargetValue + MIN_CHANGE, vfBest, nBest);
+    // An exact match is the best there is, and the search usually ends long
+    // before the stochastic approximation has gone through all of vValue
+    if (SelectCoinsBnB(vValue, nTotalLower, nTargetValue, vfBest))
+        nBest = nTargetValue;
+    else
+    {
+        ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
+        if (nBest != nTargetValue && nTotalLower >= nTargetValue + MIN_CHANGE)
+            ApproximateBestSubset(vValue, nTotalLower, nTargetValue + MIN_CHANGE, vfBest, nBest);
+    }
 
     // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
     //                                   or the next bigger coin is closer), return the bigger coin
@@ -2362,13 +2740,18 @@ bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*
     //if we're doing only denominated, we need to round up to the nearest smallest denomination
     if(nCoinType == ONLY_DENOMINATED) {
         CAmount nSmallestDenom = vecPrivateSendDenominations.back();
+        // bucket the coins by value once instead of walking all of them for every denomination
+        std::map<CAmount, std::vector<const COutput*> > mapCoinsByValue;
+        BOOST_FOREACH(const COutput& out, vCoins)
+            mapCoinsByValue[out.tx->vout[out.i].nValue].push_back(&out);
         // Make outputs by looping through denominations, from large to small
         BOOST_FOREACH(CAmount nDenom, vecPrivateSendDenominations)
         {
-            BOOST_FOREACH(const COutput& out, vCoins)
+            BOOST_FOREACH(const COutput* pout, mapCoinsByValue[nDenom])
             {
-                //make sure it's the denom we're looking for, round the amount up to smallest denom
-                if(out.tx->vout[out.i].nValue == nDenom && nValueRet + nDenom < nTargetValue + nSmallestDenom) {
+                const COutput& out = *pout;
+                //round the amount up to smallest denom
+                if(nValueRet + nDenom < nTargetValue + nSmallestDenom) {
                     CTxIn txin = CTxIn(out.tx->GetHash(),out.i);
                     int nRounds = GetInputPrivateSendRounds(txin);
                     // make sure it's actually anonymized
@@ -2568,8 +2951,10 @@ bool CWallet::SelectCoinsGrouppedByAddresses(std::vector<CompactTallyItem>& vecT
 
     // Tally
     map<CDynamicAddress, CompactTallyItem> mapTally;
-    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-        const CWalletTx& wtx = (*it).second;
+    std::vector<const CWalletTx*> vWalletTxs;
+    GetWalletTxsWithUnspent(vWalletTxs);
+    BOOST_FOREACH(const CWalletTx* pwtx, vWalletTxs) {
+        const CWalletTx& wtx = *pwtx;
 
         if(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0) continue;
         if(!fAnonymizable && !wtx.IsTrusted()) continue;
@@ -3242,6 +3627,8 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std:
             // duration of this scope.  This is the only place where this optimization
             // maybe makes sense; please don't do it anywhere else.
             CWalletDB* pwalletdb = fFileBacked ? new CWalletDB(strWalletFile,"r+") : NULL;
+            // The keypool entry and the transaction are written in one batch
+            CWalletDBBatch batch(pwalletdb, &pwalletdbBatch);
 
             // Take key pair from key pool so it won't be used again
             reservekey.KeepKey();
@@ -3249,6 +3636,8 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std:
             // Add tx to wallet, because if it has change it's also ours,
             // otherwise just for transaction history.
             AddToWallet(wtxNew, false, pwalletdb);
+            if (!batch.Commit())
+                LogPrintf("CommitTransaction(): Error: committing the transaction to the wallet database failed\n");
 
             // Notify that old coins are spent
             set<uint256> updated_hahes;
@@ -3440,6 +3829,7 @@ bool CWallet::NewKeyPool()
     {
         LOCK(cs_wallet);
         CWalletDB walletdb(strWalletFile);
+        CWalletDBBatch batch(&walletdb, &pwalletdbBatch);
         BOOST_FOREACH(int64_t nIndex, setKeyPool)
             walletdb.ErasePool(nIndex);
         setKeyPool.clear();
@@ -3456,6 +3846,8 @@ bool CWallet::NewKeyPool()
             walletdb.WritePool(nIndex, CKeyPool(GenerateNewKey()));
             setKeyPool.insert(nIndex);
         }
+        if (!batch.Commit())
+            throw runtime_error("NewKeyPool(): committing generated keys failed");
         LogPrintf("CWallet::NewKeyPool wrote %d new keys\n", nKeys);
     }
     return true;
@@ -3470,6 +3862,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             return false;
 
         CWalletDB walletdb(strWalletFile);
+        // keys and pool entries are written in one batch instead of a transaction and checkpoint per key
+        CWalletDBBatch batch(&walletdb, &pwalletdbBatch);
 
         // Top up key pool
         unsigned int nTargetSize;
@@ -3491,6 +3885,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
             uiInterface.InitMessage(strMsg);
         }
+        if (!batch.Commit())
+            throw runtime_error("TopUpKeyPool(): committing generated keys failed");
     }
     return true;
 }
@@ -3527,8 +3923,11 @@ void CWallet::KeepKey(int64_t nIndex)
     // Remove from key pool
     if (fFileBacked)
     {
-        CWalletDB walletdb(strWalletFile);
-        walletdb.ErasePool(nIndex);
+        LOCK(cs_wallet);
+        if (pwalletdbBatch)
+            pwalletdbBatch->ErasePool(nIndex);
+        else
+            CWalletDB(strWalletFile).ErasePool(nIndex);
         nKeysLeftSinceAutoBackup = nWalletBackups ? nKeysLeftSinceAutoBackup - 1 : 0;
     }
     LogPrintf("keypool keep %d\n", nIndex);
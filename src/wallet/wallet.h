@@ -291,6 +291,8 @@ public:
     mutable CAmount nImmatureWatchCreditCached;
     mutable CAmount nAvailableWatchCreditCached;
     mutable CAmount nChangeCached;
+    //! PrivateSend rounds per output, -10 where not computed yet (see CWallet::GetRealInputPrivateSendRounds)
+    mutable std::vector<int> vPrivateSendRoundsCached;
 
     CWalletTx()
     {
@@ -334,6 +336,7 @@ public:
         fImmatureWatchCreditCached = false;
         fAvailableWatchCreditCached = false;
         fChangeCached = false;
+        vPrivateSendRoundsCached.clear();
         nDebitCached = 0;
         nCreditCached = 0;
         nImmatureCreditCached = 0;
@@ -394,20 +397,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -522,6 +512,8 @@ private:
     bool SelectCoins(const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = NULL, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = true) const;
 
     CWalletDB *pwalletdbEncryption;
+    //! Handle of the open CWalletDBBatch that key and keypool records are written through, if any
+    CWalletDB *pwalletdbBatch;
 
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
@@ -533,6 +525,15 @@ private:
     int64_t nLastResend;
     bool fBroadcastTransactions;
 
+    /**
+     * Transactions in mapWallet that may still have unspent outputs of ours.
+     * Fully spent ones are dropped by GetWalletTxsWithUnspent, so balances and
+     * AvailableCoins don't visit the whole history. A transaction is added back
+     * whenever it is marked dirty, which is what happens when something
+     * spending it is added, conflicted or abandoned, or on key imports.
+     */
+    mutable std::set<uint256> setWalletTxsWithUnspent;
+
     mutable bool fAnonymizableTallyCached;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCached;
     mutable bool fAnonymizableTallyCachedNonDenom;
@@ -553,6 +554,14 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /* Drop the cached PrivateSend rounds of a transaction and of everything in the wallet spending from it. */
+    void ResetPrivateSendRounds(const uint256& hashTx);
+
+    //! Output scripts a rescan looks for: our keys, redeem scripts and watch-only scripts
+    void GetRescanScripts(std::set<CScript>& setScripts) const;
+    //! Whether a rescanned transaction is already known or spends from the wallet
+    bool IsRescanCandidate(const CTransaction& tx) const;
+
 public:
     /*
      * Main wallet lock.
@@ -599,6 +608,7 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        pwalletdbBatch = NULL;
         nOrderPosNext = 0;
         nNextResend = 0;
         nLastResend = 0;
@@ -726,9 +736,19 @@ public:
     int64_t IncOrderPosNext(CWalletDB *pwalletdb = NULL);
 
     void MarkDirty();
+    //! Consider wtxid again in GetWalletTxsWithUnspent, its outputs may have become unspent
+    void MarkWalletTxUnspent(const uint256& wtxid) const;
+    //! Wallet transactions that may have unspent outputs of ours, in txid order
+    void GetWalletTxsWithUnspent(std::vector<const CWalletTx*>& vWalletTxs) const;
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
+    /**
+     * Scan the active chain from pindexStart for wallet transactions. Blocks
+     * are read and filtered on worker threads; cs_main and cs_wallet are only
+     * held while a block with possible wallet transactions is applied. Callers
+     * holding either lock across the call keep the node locked for the whole scan.
+     */
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
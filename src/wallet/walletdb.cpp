@@ -214,7 +214,7 @@ void CWalletDB::ListAccountCreditDebit(const string& strAccount, list<CAccountin
 {
     bool fAllAccounts = (strAccount == "*");
 
-    Dbc* pcursor = GetCursor();
+    CDBCursor* pcursor = GetCursor();
     if (!pcursor)
         throw runtime_error("CWalletDB::ListAccountCreditDebit(): cannot create DB cursor");
     unsigned int fFlags = DB_SET_RANGE;
@@ -631,7 +631,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
         }
 
         // Get cursor
-        Dbc* pcursor = GetCursor();
+        CDBCursor* pcursor = GetCursor();
         if (!pcursor)
         {
             LogPrintf("Error getting wallet database cursor\n");
@@ -741,7 +741,7 @@ DBErrors CWalletDB::FindWalletTx(CWallet* pwallet, vector<uint256>& vTxHash, vec
         }
 
         // Get cursor
-        Dbc* pcursor = GetCursor();
+        CDBCursor* pcursor = GetCursor();
         if (!pcursor)
         {
             LogPrintf("Error getting wallet database cursor\n");
@@ -869,6 +869,56 @@ void ThreadFlushWalletDB(const string& strFile)
     }
 }
 
+CWalletDBBatch::CWalletDBBatch(CWalletDB* pwalletdbIn, CWalletDB** ppwalletdbActiveIn) :
+    pwalletdb(pwalletdbIn), ppwalletdbActive(ppwalletdbActiveIn), pwalletdbPrevActive(NULL), fOwnsTxn(false)
+{
+    if (!pwalletdb)
+        return;
+    // TxnBegin fails if a transaction is already open on this handle, we then just join it
+    fOwnsTxn = pwalletdb->TxnBegin();
+    if (ppwalletdbActive) {
+        pwalletdbPrevActive = *ppwalletdbActive;
+        *ppwalletdbActive = pwalletdb;
+    }
+}
+
+CWalletDBBatch::~CWalletDBBatch()
+{
+    if (!Commit())
+        LogPrintf("CWalletDBBatch: committing wallet database batch failed\n");
+}
+
+bool CWalletDBBatch::Commit()
+{
+    if (ppwalletdbActive) {
+        *ppwalletdbActive = pwalletdbPrevActive;
+        ppwalletdbActive = NULL;
+    }
+    if (!fOwnsTxn)
+        return true;
+    fOwnsTxn = false;
+    return pwalletdb->TxnCommit();
+}
+
+/** Copy a wallet file, or the directory of a LevelDB wallet, throws filesystem_error */
+static void CopyWalletDB(const boost::filesystem::path& pathSrc, const boost::filesystem::path& pathDest)
+{
+    if (boost::filesystem::is_directory(pathSrc)) {
+        boost::filesystem::create_directories(pathDest);
+        boost::filesystem::directory_iterator end;
+        for (boost::filesystem::directory_iterator it(pathSrc); it != end; ++it)
+            CopyWalletDB(it->path(), pathDest / it->path().filename());
+        return;
+    }
+#if BOOST_VERSION >= 104000
+    boost::filesystem::copy_file(pathSrc, pathDest, boost::filesystem::copy_option::overwrite_if_exists);
+#else
+    if (boost::filesystem::exists(pathDest))
+        boost::filesystem::remove(pathDest);
+    boost::filesystem::copy_file(pathSrc, pathDest);
+#endif
+}
+
 bool BackupWallet(const CWallet& wallet, const string& strDest)
 {
     if (!wallet.fFileBacked)
@@ -885,17 +935,13 @@ bool BackupWallet(const CWallet& wallet, const string& strDest)
                 bitdb.mapFileUseCount.erase(wallet.strWalletFile);
 
                 // Copy wallet.dat
-                boost::filesystem::path pathSrc = GetDataDir() / wallet.strWalletFile;
+                boost::filesystem::path pathSrc = GetWalletDBPath(wallet.strWalletFile, GetWalletBackend());
                 boost::filesystem::path pathDest(strDest);
                 if (boost::filesystem::is_directory(pathDest))
                     pathDest /= wallet.strWalletFile;
 
                 try {
-#if BOOST_VERSION >= 104000
-                    boost::filesystem::copy_file(pathSrc, pathDest, boost::filesystem::copy_option::overwrite_if_exists);
-#else
-                    boost::filesystem::copy_file(pathSrc, pathDest);
-#endif
+                    CopyWalletDB(pathSrc, pathDest);
                     LogPrintf("copied wallet.dat to %s\n", pathDest.string());
                     return true;
                 } catch (const boost::filesystem::filesystem_error& e) {
@@ -959,7 +1005,7 @@ bool AutoBackupWallet (CWallet* wallet, std::string strWalletFile, std::string&
             }
         } else {
             // ... strWalletFile file
-            fs::path sourceFile = GetDataDir() / strWalletFile;
+            fs::path sourceFile = GetWalletDBPath(strWalletFile, GetWalletBackend());
             fs::path backupFile = backupsDir / (strWalletFile + dateTimeStr);
             sourceFile.make_preferred();
             backupFile.make_preferred();
@@ -971,7 +1017,7 @@ bool AutoBackupWallet (CWallet* wallet, std::string strWalletFile, std::string&
             }
             if(fs::exists(sourceFile)) {
                 try {
-                    fs::copy_file(sourceFile, backupFile);
+                    CopyWalletDB(sourceFile, backupFile);
                     LogPrintf("Creating backup of %s -> %s\n", sourceFile.string(), backupFile.string());
                 } catch(fs::filesystem_error &error) {
                     strBackupWarning = strprintf(_("Failed to create backup, error: %s"), error.what());
@@ -991,8 +1037,8 @@ bool AutoBackupWallet (CWallet* wallet, std::string strWalletFile, std::string&
         fs::path currentFile;
         for (fs::directory_iterator dir_iter(backupsDir); dir_iter != end_iter; ++dir_iter)
         {
-            // Only check regular files
-            if ( fs::is_regular_file(dir_iter->status()))
+            // Only check regular files, and the directories of LevelDB wallets
+            if ( fs::is_regular_file(dir_iter->status()) || fs::is_directory(dir_iter->status()))
             {
                 currentFile = dir_iter->path().filename();
                 // Only add the backups for the current wallet, e.g. wallet.dat.*
@@ -1012,7 +1058,7 @@ bool AutoBackupWallet (CWallet* wallet, std::string strWalletFile, std::string&
             {
                 // More than nWalletBackups backups: delete oldest one(s)
                 try {
-                    fs::remove(file.second);
+                    fs::remove_all(file.second);
                     LogPrintf("Old backup deleted: %s\n", file.second);
                 } catch(fs::filesystem_error &error) {
                     strBackupWarning = strprintf(_("Failed to delete backup, error: %s"), error.what());
@@ -142,6 +142,36 @@ private:
     bool WriteAccountingEntry(const uint64_t nAccEntryNum, const CAccountingEntry& acentry);
 };
 
+/**
+ * Groups the records written through a CWalletDB into one database transaction.
+ * Without it every record is a transaction of its own, and every write handle
+ * checkpoints the environment when it is closed. The transaction is committed
+ * by Commit() or when the batch goes out of scope, so what was written stays
+ * written just like before. A batch opened while another one is active on the
+ * same handle joins it.
+ *
+ * Code that would open its own handle (key and keypool writes) must use the
+ * batch handle instead, or it will wait on the batch's locks forever; pass
+ * ppwalletdbActive to publish the handle for the duration of the batch.
+ */
+class CWalletDBBatch
+{
+private:
+    CWalletDB* pwalletdb;
+    CWalletDB** ppwalletdbActive;
+    CWalletDB* pwalletdbPrevActive;
+    bool fOwnsTxn;
+
+    CWalletDBBatch(const CWalletDBBatch&);
+    void operator=(const CWalletDBBatch&);
+
+public:
+    CWalletDBBatch(CWalletDB* pwalletdbIn, CWalletDB** ppwalletdbActiveIn = NULL);
+    ~CWalletDBBatch();
+
+    bool Commit();
+};
+
 bool BackupWallet(const CWallet& wallet, const std::string& strDest);
 void ThreadFlushWalletDB(const std::string& strFile);
 
@@ -6,8 +6,12 @@
 #define DYNAMIC_ZMQ_ZMQABSTRACTNOTIFIER_H
 
 #include "zmqconfig.h"
+#include "txmempool.h"
 
 class CBlockIndex;
+class CGovernanceObject;
+class CGovernanceVote;
+class COutPoint;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -33,8 +37,13 @@ public:
     virtual void Shutdown() = 0;
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
+    virtual bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason);
+    virtual bool NotifyDynodeListChanged(const COutPoint &outpoint, bool fAdded);
+    virtual bool NotifyGovernanceObject(const CGovernanceObject &govobj);
+    virtual bool NotifyGovernanceVote(const CGovernanceVote &vote);
 
 protected:
     void *psocket;
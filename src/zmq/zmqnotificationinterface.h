@@ -6,6 +6,7 @@
 #define DYNAMIC_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
+#include "zmqpublishnotifier.h"
 #include <string>
 #include <map>
 
@@ -27,11 +28,17 @@ protected:
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void NotifyTransactionLock(const CTransaction &tx);
+    void BlockConnected(const CBlock &block, const CBlockIndex *pindex);
+    void TransactionRemovedFromMempool(const CTransaction &tx, MemPoolRemovalReason reason);
+    void NotifyDynodeListChanged(const COutPoint &outpoint, bool fAdded);
+    void NotifyGovernanceObject(const CGovernanceObject &govobj);
+    void NotifyGovernanceVote(const CGovernanceVote &vote);
 
 private:
     CZMQNotificationInterface();
 
     void *pcontext;
+    size_t nMaxPublishQueue;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
 
@@ -4,17 +4,46 @@
 
 #include "chainparams.h"
 #include "zmqpublishnotifier.h"
+#include "governance-object.h"
+#include "governance-vote.h"
 #include "main.h"
 #include "util.h"
 
+#include <deque>
+
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
+/** A message waiting for the publisher thread */
+struct CZMQPublishMessage
+{
+    void *psocket;
+    const char *command;
+    std::vector<unsigned char> data;
+    uint32_t nSequence;
+};
+
+//! Messages of all publish notifiers, in the order they were notified
+static std::deque<CZMQPublishMessage> publishQueue;
+static size_t nMaxPublishQueue = DEFAULT_ZMQ_PUBLISH_QUEUE;
+static bool fPublisherRunning = false;
+static CWaitableCriticalSection cs_publishQueue;
+static CConditionVariable condPublishQueue;
+static boost::thread threadPublisher;
+
 static const char *MSG_HASHBLOCK  = "hashblock";
 static const char *MSG_HASHTX     = "hashtx";
 static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_HASHTXREMOVED = "hashtxremoved";
+static const char *MSG_HASHTXEVICTED = "hashtxevicted";
+static const char *MSG_DYNODE = "dynode";
+static const char *MSG_HASHGOVERNANCEOBJECT = "hashgovernanceobject";
+static const char *MSG_HASHGOVERNANCEVOTE = "hashgovernancevote";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -56,6 +85,53 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+/** Send everything that gets queued, in batches, until StopPublisher */
+static void ThreadZMQPublish()
+{
+    RenameThread("dynamic-zmqpub");
+    std::deque<CZMQPublishMessage> batch;
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_publishQueue);
+            while (fPublisherRunning && publishQueue.empty())
+                condPublishQueue.wait(lock);
+            if (publishQueue.empty())
+                return;
+            batch.swap(publishQueue);
+        }
+
+        // Slow subscribers only hold up this thread, the notifying threads keep queueing
+        BOOST_FOREACH(const CZMQPublishMessage& msg, batch) {
+            /* send three parts, command & data & a LE 4byte sequence number */
+            unsigned char msgseq[sizeof(uint32_t)];
+            WriteLE32(&msgseq[0], msg.nSequence);
+            zmq_send_multipart(msg.psocket, msg.command, strlen(msg.command), &msg.data[0], msg.data.size(), msgseq, (size_t)sizeof(uint32_t), (void*)0);
+        }
+        batch.clear();
+    }
+}
+
+void CZMQAbstractPublishNotifier::StartPublisher(size_t nMaxQueue)
+{
+    boost::unique_lock<boost::mutex> lock(cs_publishQueue);
+    assert(!fPublisherRunning);
+    nMaxPublishQueue = nMaxQueue;
+    fPublisherRunning = true;
+    threadPublisher = boost::thread(&ThreadZMQPublish);
+}
+
+void CZMQAbstractPublishNotifier::StopPublisher()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_publishQueue);
+        if (!fPublisherRunning)
+            return;
+        fPublisherRunning = false;
+        condPublishQueue.notify_all();
+    }
+    threadPublisher.join();
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -128,20 +204,37 @@ void CZMQAbstractPublishNotifier::Shutdown()
 bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
 {
     assert(psocket);
+    assert(size > 0);
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
+    boost::unique_lock<boost::mutex> lock(cs_publishQueue);
+    if (!fPublisherRunning)
         return false;
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    /* the sequence number is used up even if the message is dropped */
+    uint32_t nMsgSequence = nSequence++;
+    if (publishQueue.size() >= nMaxPublishQueue) {
+        LogPrint("zmq", "zmq: Publish queue full, dropping %s %u\n", command, nMsgSequence);
+        return true;
+    }
+
+    publishQueue.push_back(CZMQPublishMessage());
+    CZMQPublishMessage& msg = publishQueue.back();
+    msg.psocket = psocket;
+    msg.command = command;
+    msg.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+    msg.nSequence = nMsgSequence;
+    condPublishQueue.notify_one();
 
     return true;
 }
 
+/** Copy hash to data the way the hash topics have always sent it, most significant byte first */
+static void WriteReversedHash(unsigned char *data, const uint256 &hash)
+{
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -172,10 +265,35 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     return SendMessage(MSG_HASHTXLOCK, data, 32);
 }
 
+bool CZMQPublishRawBlockNotifier::NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex)
+{
+    // The tip is only published after initial block download, see UpdatedBlockTip
+    if (IsInitialBlockDownload())
+        return true;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+
+    LOCK(cs);
+    hashLastBlock = pindex->GetBlockHash();
+    vchLastBlock.assign(ss.begin(), ss.end());
+    return true;
+}
+
 bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
+    // Normally the tip is the block that was connected last, no need to read it back
+    std::vector<unsigned char> vchBlock;
+    {
+        LOCK(cs);
+        if (hashLastBlock == pindex->GetBlockHash())
+            vchBlock.swap(vchLastBlock);
+    }
+    if (!vchBlock.empty())
+        return SendMessage(MSG_RAWBLOCK, &vchBlock[0], vchBlock.size());
+
     const Consensus::Params& consensusParams = Params().GetConsensus();
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     {
@@ -210,3 +328,56 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashTransactionRemovedNotifier::NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    // Leaving for a block is announced by hashtx, evictions by hashtxevicted
+    if (reason == MPR_BLOCK || reason == MPR_EXPIRY || reason == MPR_SIZELIMIT)
+        return true;
+    uint256 hash = transaction.GetHash();
+    LogPrint("zmq", "zmq: Publish hashtxremoved %s\n", hash.GetHex());
+    unsigned char data[33];
+    WriteReversedHash(data, hash);
+    data[32] = (unsigned char)reason;
+    return SendMessage(MSG_HASHTXREMOVED, data, 33);
+}
+
+bool CZMQPublishHashTransactionEvictedNotifier::NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    if (reason != MPR_EXPIRY && reason != MPR_SIZELIMIT)
+        return true;
+    uint256 hash = transaction.GetHash();
+    LogPrint("zmq", "zmq: Publish hashtxevicted %s\n", hash.GetHex());
+    unsigned char data[33];
+    WriteReversedHash(data, hash);
+    data[32] = (unsigned char)reason;
+    return SendMessage(MSG_HASHTXEVICTED, data, 33);
+}
+
+bool CZMQPublishDynodeNotifier::NotifyDynodeListChanged(const COutPoint &outpoint, bool fAdded)
+{
+    LogPrint("zmq", "zmq: Publish dynode %s %s\n", outpoint.ToStringShort(), fAdded ? "added" : "removed");
+    unsigned char data[37];
+    WriteReversedHash(data, outpoint.hash);
+    WriteLE32(&data[32], outpoint.n);
+    data[36] = fAdded ? 1 : 0;
+    return SendMessage(MSG_DYNODE, data, 37);
+}
+
+bool CZMQPublishHashGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &govobj)
+{
+    uint256 hash = govobj.GetHash();
+    LogPrint("zmq", "zmq: Publish hashgovernanceobject %s\n", hash.GetHex());
+    unsigned char data[32];
+    WriteReversedHash(data, hash);
+    return SendMessage(MSG_HASHGOVERNANCEOBJECT, data, 32);
+}
+
+bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
+{
+    uint256 hash = vote.GetHash();
+    LogPrint("zmq", "zmq: Publish hashgovernancevote %s\n", hash.GetHex());
+    unsigned char data[32];
+    WriteReversedHash(data, hash);
+    return SendMessage(MSG_HASHGOVERNANCEVOTE, data, 32);
+}
@@ -6,26 +6,41 @@
 #define DYNAMIC_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <vector>
 
 class CBlockIndex;
 
+/** Default for -zmqpubqueue, notifications waiting for the publisher thread */
+static const unsigned int DEFAULT_ZMQ_PUBLISH_QUEUE = 10000;
+
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; // upcounting per message sequence number
+    uint32_t nSequence; // upcounting per message sequence number, guarded by the publish queue lock
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0) { }
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the publisher thread
        parts:
           * command
           * data
           * message sequence number
+       a message that doesn't fit in the queue is dropped, its sequence
+       number is still used up so subscribers can tell
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
     bool Initialize(void *pcontext);
     void Shutdown();
+
+    /** Start the thread that sends the queued messages of all publish notifiers */
+    static void StartPublisher(size_t nMaxQueue);
+    /** Send what is still queued and stop the publisher thread */
+    static void StopPublisher();
 };
 
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
@@ -48,7 +63,14 @@ public:
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
+private:
+    // Last connected block, serialized while it was still in memory
+    CCriticalSection cs;
+    uint256 hashLastBlock;
+    std::vector<unsigned char> vchLastBlock;
+
 public:
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex);
     bool NotifyBlock(const CBlockIndex *pindex);
 };
 
@@ -64,4 +86,34 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+class CZMQPublishHashTransactionRemovedNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason);
+};
+
+class CZMQPublishHashTransactionEvictedNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason);
+};
+
+class CZMQPublishDynodeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyDynodeListChanged(const COutPoint &outpoint, bool fAdded);
+};
+
+class CZMQPublishHashGovernanceObjectNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceObject(const CGovernanceObject &govobj);
+};
+
+class CZMQPublishHashGovernanceVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceVote(const CGovernanceVote &vote);
+};
+
 #endif // DYNAMIC_ZMQ_ZMQPUBLISHNOTIFIER_H